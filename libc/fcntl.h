@@ -0,0 +1,10 @@
+// <fcntl.h> GCC header simplified, basically everything removed
+
+#ifndef _FCNTL_H
+#define _FCNTL_H 1
+
+#define O_RDONLY 0
+
+extern int open(const char* __file, int __oflag);
+
+#endif /* fcntl.h  */
@@ -24,5 +24,7 @@ struct option
 
 extern int getopt_long (int ___argc, char **___argv,
 			char *__shortopts, struct option *__longopts, int *__longind);
+extern int getopt_long_only (int ___argc, char **___argv,
+			char *__shortopts, struct option *__longopts, int *__longind);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,13 @@
+// <sys/mman.h> GCC header simplified, only read-only file mappings
+
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H 1
+
+#define PROT_READ 1 /* Page can be read.  */
+#define MAP_PRIVATE 2 /* Changes are private.  */
+
+extern void* mmap(void* __addr, long __len, int __prot, int __flags, int __fd, long __offset);
+
+extern int munmap(void* __addr, long __len);
+
+#endif /* sys/mman.h  */
@@ -0,0 +1,10 @@
+// <sys/wait.h> GCC header simplified, only waiting for child processes
+
+#ifndef _SYS_WAIT_H
+#define _SYS_WAIT_H 1
+
+extern int wait(int* __stat_loc);
+
+extern int waitpid(int __pid, int* __stat_loc, int __options);
+
+#endif /* sys/wait.h  */
@@ -0,0 +1,15 @@
+// <time.h> GCC header simplified, only the clocks used for timing
+
+#ifndef _TIME_H
+#define _TIME_H 1
+
+#define CLOCK_MONOTONIC 1
+
+struct timespec {
+    long tv_sec; /* Seconds.  */
+    long tv_nsec; /* Nanoseconds.  */
+};
+
+extern int clock_gettime(int __clock_id, struct timespec* __tp);
+
+#endif /* time.h  */
@@ -7,4 +7,14 @@ extern int usleep(int usec);
 
 extern int sleep(unsigned int seconds);
 
+extern long lseek(int __fd, long __offset, int __whence);
+
+extern int close(int __fd);
+
+extern long read(int __fd, void* __buf, long __nbytes);
+
+extern int getpid(void);
+
+extern int fork(void);
+
 #endif /* unistd.h  */
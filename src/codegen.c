@@ -35,7 +35,7 @@ void asm_add(StrVector* src, char* str) {
 void asm_addf(AsmContext* ctx, char* format_string, ...) {
     va_list vl;
     va_start(vl, format_string);
-    static char buf[256];
+    char buf[256];
     vsnprintf(buf, 255, format_string, vl);
     va_end(vl);
     asm_add_newline(ctx, ctx->asm_text_src);
@@ -45,7 +45,7 @@ void asm_addf(AsmContext* ctx, char* format_string, ...) {
 void asm_add_sectionf(AsmContext* ctx, StrVector* section, char* format_string, ...) {
     va_list vl;
     va_start(vl, format_string);
-    static char buf[256];
+    char buf[256];
     vsnprintf(buf, 255, format_string, vl);
     va_end(vl);
     asm_add_newline(ctx, section);
@@ -55,7 +55,7 @@ void asm_add_sectionf(AsmContext* ctx, StrVector* section, char* format_string,
 void asm_add_wn_sectionf(AsmContext* ctx, StrVector* section, char* format_string, ...) {
     va_list vl;
     va_start(vl, format_string);
-    static char buf[256];
+    char buf[256];
     vsnprintf(buf, 255, format_string, vl);
     va_end(vl);
     asm_add(section, buf);
@@ -89,7 +89,7 @@ void codegen_error(char* error_message) {
 }
 
 char* offset_to_stack_ptr(int offset, char* prefix) {
-    static char buf[64];
+    char buf[64];
     snprintf(buf, 63, "%s [rbp-%d]", prefix, offset);
     return str_copy(buf);
 }
@@ -154,7 +154,7 @@ char* get_float_move_for_byte_size(int bytes) {
 }
 
 char* var_to_stack_ptr(Variable* var) {
-    static char buf[64];
+    char buf[64];
     if (var->type.is_static) {
         char* addr_width_str = bytes_to_addr_width(var->type.bytes);
         snprintf(buf, 63, "%s [%s.%ds]", addr_width_str, var->name, var->unique_id);
@@ -213,36 +213,51 @@ char* get_move_instr_for_var_type(VarType var_type) {
     return NULL;
 }
 
-char* get_label_str(int label) {
-    static char result[64];
-    snprintf(result, 63, ".L%d", label);
-    return result;
+char* get_label_str(AsmContext* ctx, int label) {
+    snprintf(ctx->label_str, ASM_LABEL_STR_SIZE - 1, ".L%d", label);
+    return ctx->label_str;
 }
 
-char* get_case_label_str(ValueLabel* label) {
-    static char result[64];
+char* get_case_label_str(AsmContext* ctx, ValueLabel* label) {
     if (label->is_default_case) {
-        snprintf(result, 63, ".LC%d_D", label->id);
+        snprintf(ctx->label_str, ASM_LABEL_STR_SIZE - 1, ".LC%d_D", label->id);
     }
     else {
-        snprintf(result, 63, ".LC%d", label->id);
+        snprintf(ctx->label_str, ASM_LABEL_STR_SIZE - 1, ".LC%d", label->id);
     }
-    return result;
+    return ctx->label_str;
 }
 
 char* get_next_label_str(AsmContext* ctx) {
     (*ctx->label_count)++;
-    return get_label_str(*ctx->label_count);
+    return get_label_str(ctx, *ctx->label_count);
 }
 
 char* get_next_cstring_label_str(AsmContext* ctx) {
     (*ctx->cstring_label_count)++;
-    static char result[64];
-    snprintf(result, 63, "G_STR%d", *ctx->cstring_label_count);
-    return result;
+    if (ctx->cstring_label_prefix != NULL) {
+        snprintf(ctx->label_str, ASM_LABEL_STR_SIZE - 1, "%s.S%d",
+                 ctx->cstring_label_prefix, *ctx->cstring_label_count);
+    }
+    else {
+        snprintf(ctx->label_str, ASM_LABEL_STR_SIZE - 1, "G_STR%d",
+                 *ctx->cstring_label_count);
+    }
+    return ctx->label_str;
 }
 
 AsmContext asm_context_new() {
+    AsmContext ctx = asm_context_new_func(NULL, NULL);
+    str_vec_push(ctx.asm_rodata_src, "\nsection .rodata\n");
+    str_vec_push(ctx.asm_data_src, "\nsection .data\n");
+    str_vec_push(ctx.asm_bss_src, "\nsection .bss\n");
+    str_vec_push(ctx.asm_text_src, "\nsection .text\n");
+    ctx.funcs = malloc(sizeof(Vec));
+    *ctx.funcs = vec_new(sizeof(ASTNode*), 16);
+    return ctx;
+}
+
+AsmContext asm_context_new_func(AsmContext* program_ctx, ASTNode* node) {
     AsmContext ctx;
     ctx.last_start_label = NULL;
     ctx.last_end_label = NULL;
@@ -258,17 +273,28 @@ AsmContext asm_context_new() {
     ctx.asm_data_src = str_vec_new_ptr(16);
     ctx.asm_bss_src = str_vec_new_ptr(16);
     ctx.asm_text_src = str_vec_new_ptr(16);
-    str_vec_push(ctx.asm_rodata_src, "\nsection .rodata\n");
-    str_vec_push(ctx.asm_data_src, "\nsection .data\n");
-    str_vec_push(ctx.asm_bss_src, "\nsection .bss\n");
-    str_vec_push(ctx.asm_text_src, "\nsection .text\n");
     ctx.label_count = calloc(1, sizeof(int));
     ctx.cstring_label_count = calloc(1, sizeof(int));
+    ctx.cstring_label_prefix = NULL;
+    ctx.label_str = malloc(ASM_LABEL_STR_SIZE);
+    ctx.funcs = NULL;
     ctx.prev_filename_str = NULL;
     ctx.prev_line = calloc(1, sizeof(int));
+    ctx.include_comments = false;
+    if (program_ctx != NULL) {
+        ctx.include_comments = program_ctx->include_comments;
+        ctx.cstring_label_prefix = node->func->name;
+    }
     return ctx;
 }
 
+void asm_context_append(AsmContext* ctx, AsmContext* func_ctx) {
+    str_vec_push_no_copy(ctx->asm_rodata_src, str_vec_join(func_ctx->asm_rodata_src));
+    str_vec_push_no_copy(ctx->asm_data_src, str_vec_join(func_ctx->asm_data_src));
+    str_vec_push_no_copy(ctx->asm_bss_src, str_vec_join(func_ctx->asm_bss_src));
+    str_vec_push_no_copy(ctx->asm_text_src, str_vec_join(func_ctx->asm_text_src));
+}
+
 void asm_context_free(AsmContext* ctx) {
     str_vec_free(ctx->asm_rodata_src);
     str_vec_free(ctx->asm_data_src);
@@ -282,7 +308,12 @@ void asm_context_free(AsmContext* ctx) {
     free(ctx->asm_indent_str);
     free(ctx->label_count);
     free(ctx->cstring_label_count);
+    free(ctx->label_str);
     free(ctx->prev_line);
+    if (ctx->funcs != NULL) {
+        vec_free(ctx->funcs);
+        free(ctx->funcs);
+    }
 }
 
 char* asm_context_join_srcs(AsmContext* ctx) {
@@ -304,6 +335,11 @@ char* asm_context_join_srcs(AsmContext* ctx) {
 }
 
 char* generate_assembly(AST* ast, SymbolTable* symbols, bool include_asm_comments) {
+    return generate_assembly_threaded(ast, symbols, include_asm_comments, 1);
+}
+
+char* generate_assembly_threaded(AST* ast, SymbolTable* symbols,
+                                 bool include_asm_comments, int thread_count) {
     // Setup context object
     AsmContext ctx = asm_context_new();
     ctx.include_comments = include_asm_comments;
@@ -312,7 +348,9 @@ char* generate_assembly(AST* ast, SymbolTable* symbols, bool include_asm_comment
     asm_set_indent(&ctx, 0);
     gen_asm_global_symbols(symbols, ctx);
 
+    // The functions are collected and generated after the other top-level nodes
     gen_asm(ast->program, ctx);
+    gen_asm_funcs(&ctx, thread_count);
 
     asm_add_newline(&ctx, ctx.asm_data_src);
 
@@ -325,14 +363,19 @@ char* generate_assembly(AST* ast, SymbolTable* symbols, bool include_asm_comment
 }
 
 void gen_asm(ASTNode* node, AsmContext ctx) {
+    if (node->type == AST_FUNC) {
+        // Functions are tagged and generated in their own contexts by gen_asm_funcs
+        if (!node->func->is_builtin) { // These are virtual
+            vec_push(ctx.funcs, &node);
+        }
+        gen_asm(node->next, ctx);
+        return;
+    }
     gen_asm_debug_tagging(node, &ctx);
     switch (node->type) {
         case AST_PROGRAM:
             gen_asm(node->body, ctx);
             break;
-        case AST_FUNC:
-            gen_asm_func(node, ctx);
-            break;
         case AST_EXPR:
             gen_asm_expr(node, ctx);
             break;
@@ -392,6 +435,94 @@ void gen_asm(ASTNode* node, AsmContext ctx) {
     }
 }
 
+// Thread pool of gen_asm_funcs, not available when bootstrapping
+#ifndef CCIC
+#include <pthread.h>
+
+// Functions which are handed out to the threads one at a time
+struct CodegenQueue {
+    pthread_mutex_t mutex;
+    ASTNode** funcs;
+    AsmContext* func_ctxs;
+    int count;
+    int next; // Index of the next function to generate
+};
+
+typedef struct CodegenQueue CodegenQueue;
+
+static void* gen_asm_funcs_worker(void* arg) {
+    CodegenQueue* queue = arg;
+    while (true) {
+        pthread_mutex_lock(&queue->mutex);
+        int index = queue->next;
+        queue->next++;
+        pthread_mutex_unlock(&queue->mutex);
+        if (index >= queue->count) {
+            return NULL;
+        }
+        gen_asm_func_in_context(queue->funcs[index], queue->func_ctxs[index]);
+    }
+}
+
+static void gen_asm_funcs_threaded(ASTNode** funcs, AsmContext* func_ctxs, int count,
+                                   int thread_count) {
+    CodegenQueue queue;
+    pthread_mutex_init(&queue.mutex, NULL);
+    queue.funcs = funcs;
+    queue.func_ctxs = func_ctxs;
+    queue.count = count;
+    queue.next = 0;
+    // The calling thread is one of the workers. If a thread can not be started, the
+    // started ones take its share
+    pthread_t* threads = malloc(sizeof(pthread_t) * thread_count);
+    int started = 0;
+    while (started < thread_count - 1 &&
+           pthread_create(&threads[started], NULL, gen_asm_funcs_worker, &queue) == 0) {
+        started++;
+    }
+    gen_asm_funcs_worker(&queue);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&queue.mutex);
+}
+#endif
+
+void gen_asm_funcs(AsmContext* ctx, int thread_count) {
+    int count = ctx->funcs->size;
+    ASTNode** funcs = ctx->funcs->elems;
+    AsmContext* func_ctxs = malloc(sizeof(AsmContext) * (count + 1));
+    for (int i = 0; i < count; i++) {
+        func_ctxs[i] = asm_context_new_func(ctx, funcs[i]);
+    }
+    if (thread_count > count) {
+        thread_count = count;
+    }
+    bool is_generated = false;
+#ifndef CCIC
+    if (thread_count > 1) {
+        gen_asm_funcs_threaded(funcs, func_ctxs, count, thread_count);
+        is_generated = true;
+    }
+#endif
+    if (!is_generated) {
+        for (int i = 0; i < count; i++) {
+            gen_asm_func_in_context(funcs[i], func_ctxs[i]);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        asm_context_append(ctx, &func_ctxs[i]);
+        asm_context_free(&func_ctxs[i]);
+    }
+    free(func_ctxs);
+}
+
+void gen_asm_func_in_context(ASTNode* node, AsmContext ctx) {
+    gen_asm_debug_tagging(node, &ctx);
+    gen_asm_func(node, ctx);
+}
+
 // Generate assembly for a function call
 void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
     /* 
@@ -403,7 +534,7 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
     Return: RAX 
     */
 
-    if (node->func.is_builtin) {
+    if (node->func->is_builtin) {
         gen_asm_builtin_func_call(node, ctx);
         return;
     }
@@ -413,18 +544,18 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
                                        "xmm4", "xmm5", "xmm6", "xmm7" };
     asm_add_com(&ctx, "; Expression function call");
 
-    bool has_struct_ret_val = node->func.return_type.type == TY_STRUCT &&
-                              node->func.return_type.ptr_level == 0;
+    bool has_struct_ret_val = node->func->return_type.type == TY_STRUCT &&
+                              node->func->return_type.ptr_level == 0;
 
     // Count general and floating point parameters
-    Variable* current_func_def_arg = node->func.params;
-    ASTNode* current_arg = node->args;
+    Variable** current_func_def_arg = node->func->params;
+    ASTNode* current_arg = node->args->first;
     int float_arg_count = 0;
     int int_arg_count = 0;
-    for (int i = 0; i < node->func.call_param_count; i++) {
-        VarType arg_type = current_func_def_arg->type;
-        if (i >= node->func.def_param_count) { // Variadic, use argument type
-            arg_type = current_arg->cast_type;
+    for (int i = 0; i < node->args->count; i++) {
+        VarType arg_type = current_func_def_arg[0]->type;
+        if (i >= node->func->def_param_count) { // Variadic, use argument type
+            arg_type = *ast_node_cast_type(current_arg);
         }
         if (arg_type.type == TY_FLOAT && arg_type.ptr_level == 0) {
             float_arg_count++;
@@ -433,7 +564,7 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
             int_arg_count++;
         }
         current_arg = current_arg->next;
-        if (i < (node->func.def_param_count - 1)) {
+        if (i < (node->func->def_param_count - 1)) {
             current_func_def_arg++;
         }
     }
@@ -446,25 +577,25 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
     if (has_struct_ret_val) {
         // We need to return a struct by value,
         // Pass a pointer to the local temp struct as the bottom of the stack
-        asm_addf(&ctx, "lea rax, [rbp-%d]", node->var.stack_offset);
+        asm_addf(&ctx, "lea rax, [rbp-%d]", ast_node_get_var(node)->stack_offset);
         asm_addf(&ctx, "push rax");
     }
 
     // Add non-register arguments to the stack
-    current_arg = node->args_end->prev;
-    current_func_def_arg = node->func.params + node->func.def_param_count - 1;
+    current_arg = node->args->end->prev;
+    current_func_def_arg = node->func->params + node->func->def_param_count - 1;
     int temp_float_param_count = float_arg_count;
     int temp_int_param_count = int_arg_count;
-    for (int i = node->func.call_param_count; i > 0; i--) {
-        VarType arg_type = current_func_def_arg->type;
-        if (i > node->func.def_param_count) {
+    for (int i = node->args->count; i > 0; i--) {
+        VarType arg_type = current_func_def_arg[0]->type;
+        if (i > node->func->def_param_count) {
             // Variadic argument, we don't want to cast to the function def args anymore
-            arg_type = promote_type(current_arg->cast_type);
+            arg_type = promote_type(*ast_node_cast_type(current_arg));
         }
         if (arg_type.type == TY_FLOAT && arg_type.ptr_level == 0) {
             if (temp_float_param_count > 8) {
                 gen_asm(current_arg, ctx);
-                gen_asm_unary_op_cast(ctx, arg_type, current_arg->cast_type);
+                gen_asm_unary_op_cast(ctx, &arg_type, ast_node_cast_type(current_arg));
                 char* move_instr = get_float_move_for_byte_size(arg_type.bytes);
                 if (arg_type.bytes == 4) {
                     asm_addf(&ctx, "cvtsd2ss xmm0, xmm0");
@@ -481,31 +612,31 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
             if (temp_int_param_count > 6) {
                 // Cast function parameter if necessary
                 gen_asm(current_arg, ctx);
-                gen_asm_unary_op_cast(ctx, arg_type, current_arg->cast_type);
+                gen_asm_unary_op_cast(ctx, &arg_type, ast_node_cast_type(current_arg));
                 asm_addf(&ctx, "push rax");
             }
             temp_int_param_count--;
         }
-        if (current_func_def_arg > node->func.params) {
+        if (current_func_def_arg > node->func->params) {
             current_func_def_arg--;
         }
         current_arg = current_arg->prev;
     }
 
     // Push up to 8 floating point args, used for passing to regs
-    current_arg = node->args_end->prev;
-    current_func_def_arg = node->func.params + node->func.def_param_count - 1;
+    current_arg = node->args->end->prev;
+    current_func_def_arg = node->func->params + node->func->def_param_count - 1;
     temp_float_param_count = float_arg_count;
-    for (int i = node->func.call_param_count; i > 0; i--) {
-        VarType arg_type = current_func_def_arg->type;
-        if (i > node->func.def_param_count) {
+    for (int i = node->args->count; i > 0; i--) {
+        VarType arg_type = current_func_def_arg[0]->type;
+        if (i > node->func->def_param_count) {
             // Variadic argument, we don't want to cast to the function def args anymore
-            arg_type = promote_type(current_arg->cast_type);
+            arg_type = promote_type(*ast_node_cast_type(current_arg));
         }
         if (arg_type.type == TY_FLOAT && arg_type.ptr_level == 0) {
             if (temp_float_param_count <= 8) {
                 gen_asm(current_arg, ctx);
-                gen_asm_unary_op_cast(ctx, arg_type, current_arg->cast_type);
+                gen_asm_unary_op_cast(ctx, &arg_type, ast_node_cast_type(current_arg));
                 char* move_instr = get_float_move_for_byte_size(arg_type.bytes);
                 if (arg_type.bytes == 4) {
                     asm_addf(&ctx, "cvtsd2ss xmm0, xmm0");
@@ -518,31 +649,31 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
             }
             temp_float_param_count--;
         }
-        if (current_func_def_arg > node->func.params) {
+        if (current_func_def_arg > node->func->params) {
             current_func_def_arg--;
         }
         current_arg = current_arg->prev;
     }
 
     // Push up to 6 int args, used for passing to regs
-    current_arg = node->args_end->prev;
-    current_func_def_arg = node->func.params + node->func.def_param_count - 1;
+    current_arg = node->args->end->prev;
+    current_func_def_arg = node->func->params + node->func->def_param_count - 1;
     temp_int_param_count = int_arg_count;
-    for (int i = node->func.call_param_count; i > 0; i--) {
-        VarType arg_type = current_func_def_arg->type;
-        if (i > node->func.def_param_count) {
+    for (int i = node->args->count; i > 0; i--) {
+        VarType arg_type = current_func_def_arg[0]->type;
+        if (i > node->func->def_param_count) {
             // Variadic argument, we don't want to cast
-            arg_type = current_arg->cast_type;
+            arg_type = *ast_node_cast_type(current_arg);
         }
         if (!(arg_type.type == TY_FLOAT && arg_type.ptr_level == 0)) {
             if (temp_int_param_count <= 6) {
                 gen_asm(current_arg, ctx);
-                gen_asm_unary_op_cast(ctx, arg_type, current_arg->cast_type);
+                gen_asm_unary_op_cast(ctx, &arg_type, ast_node_cast_type(current_arg));
                 asm_addf(&ctx, "push rax");
             }
             temp_int_param_count--;
         }
-        if (current_func_def_arg > node->func.params) {
+        if (current_func_def_arg > node->func->params) {
             current_func_def_arg--;
         }
         current_arg = current_arg->prev;
@@ -571,7 +702,7 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
         asm_addf(&ctx, "movq %s, rax", float_reg_strs[i]);
     }
 
-    if (node->func.is_variadic) {
+    if (node->func->is_variadic) {
         // Pass floating point reg count in AL in variadic functions
         asm_addf(
             &ctx,
@@ -579,7 +710,7 @@ void gen_asm_func_call(ASTNode* node, AsmContext ctx) {
             min_float_pop);
     }
 
-    asm_addf(&ctx, "call %s", node->func.name);
+    asm_addf(&ctx, "call %s", node->func->name);
 
     // Restore the stack space used by REST OF ARGS
     int pop_count = max(int_arg_count - 6, 0) + max(float_arg_count - 8, 0) +
@@ -613,26 +744,22 @@ void gen_asm_func(ASTNode* node, AsmContext ctx) {
     Callee-saved RBX, RSP, RBP, and R12–R15
     Return: RAX 
     */
-    if (node->func.is_builtin) { // These are virtual
-        return;
-    }
     static RegisterEnum arg_regs[6] = { RDI, RSI, RDX, RCX, R8, R9 };
     static char* float_reg_strs[8] = { "xmm0", "xmm1", "xmm2", "xmm3",
                                        "xmm4", "xmm5", "xmm6", "xmm7" };
-    Variable* param = node->func.params;
     ctx.func_return_label = str_copy(get_next_label_str(&ctx));
     asm_set_indent(&ctx, 0);
     asm_add_newline(&ctx, ctx.asm_text_src);
-    asm_addf(&ctx, "%s:", node->func.name);
+    asm_addf(&ctx, "%s:", node->func->name);
     asm_set_indent(&ctx, 1);
 
-    bool has_struct_ret_val = node->func.return_type.type == TY_STRUCT &&
-                              node->func.return_type.ptr_level == 0;
+    bool has_struct_ret_val = node->func->return_type.type == TY_STRUCT &&
+                              node->func->return_type.ptr_level == 0;
 
     asm_add_com(&ctx, "; Setting up function stack pointer");
     asm_addf(&ctx, "push rbp");
     asm_addf(&ctx, "mov rbp, rsp");
-    int stack_space = func_get_aligned_stack_usage(node->func);
+    int stack_space = func_get_aligned_stack_usage(*node->func);
     asm_addf(&ctx, "sub rsp, %d ; Allocate the stack space used by the function",
              stack_space);
     // Evaluate arguments
@@ -640,7 +767,8 @@ void gen_asm_func(ASTNode* node, AsmContext ctx) {
     int int_arg_count = 0;
     int float_arg_count = 0;
     int stack_arg_count = 0;
-    for (int i = 0; i < node->func.def_param_count; i++) {
+    for (int i = 0; i < node->func->def_param_count; i++) {
+        Variable* param = node->func->params[i];
         char* param_ptr = var_to_stack_ptr(param);
         if (param->type.type == TY_INT || param->type.ptr_level > 0) {
             if (int_arg_count < 6) { // Pass by register
@@ -703,11 +831,10 @@ void gen_asm_func(ASTNode* node, AsmContext ctx) {
             codegen_error("Unsupported function argument type in function definition");
         }
         free(param_ptr);
-        param++;
     }
 
-    if (node->func.is_variadic) { // Store function parameters on stack
-        gen_asm_push_future_call_regs(node->func.def_param_count, &ctx);
+    if (node->func->is_variadic) { // Store function parameters on stack
+        gen_asm_push_future_call_regs(node->func->def_param_count, &ctx);
     }
 
     asm_add_com(&ctx, "; Function code start");
@@ -726,22 +853,21 @@ void gen_asm_func(ASTNode* node, AsmContext ctx) {
                  "; Return struct by value, memcpy rax into bottom value of stack args");
         asm_addf(&ctx, "mov rdi, [rbp+%d]", 8 * (stack_arg_count + 2));
         asm_addf(&ctx, "mov rsi, rax");
-        asm_addf(&ctx, "mov rdx, %d", node->func.return_type.bytes);
+        asm_addf(&ctx, "mov rdx, %d", node->func->return_type.bytes);
         gen_asm_align_stack_for_func_call(0, &ctx);
         asm_addf(&ctx, "call memcpy");
         asm_addf(&ctx, "pop rsp");
         asm_addf(&ctx, "mov rax, [rbp+%d]", 8 * (stack_arg_count + 2));
     }
 
-    if (node->func.is_variadic) { // Restore variadic pushes
-        asm_addf(&ctx, "add rsp, %d", 48 - node->func.def_param_count * 8);
+    if (node->func->is_variadic) { // Restore variadic pushes
+        asm_addf(&ctx, "add rsp, %d", 48 - node->func->def_param_count * 8);
     }
 
     asm_addf(&ctx, "add rsp, %d ; Restore function stack allocation", stack_space);
     asm_addf(&ctx, "pop rbp");
     asm_addf(&ctx, "ret");
     free(ctx.func_return_label);
-    gen_asm(node->next, ctx);
 }
 
 void gen_asm_push_future_call_regs(int current_reg, AsmContext* ctx) {
@@ -785,8 +911,8 @@ void gen_asm_pop_future_call_regs(int current_reg, AsmContext* ctx) {
 
 // Generate assembly for a compiler built-in function call
 void gen_asm_builtin_func_call(ASTNode* node, AsmContext ctx) {
-    asm_addf(&ctx, "; Builtin %s function called", node->func.name);
-    switch (node->func.builtin_type) {
+    asm_addf(&ctx, "; Builtin %s function called", node->func->name);
+    switch (node->func->builtin_type) {
         case BUILTIN_VA_BEGIN:
             gen_asm_builtin_va_begin(node, ctx);
             break;
@@ -801,7 +927,8 @@ void gen_asm_builtin_va_begin(ASTNode* node, AsmContext ctx) {
     // arg1 is va_list, arg2 is the last argument before the variadic dots
     // gp_offset = +0, fp_offset = +4, overflow_area = +8, save_area = +16
     // move va_list into memory
-    asm_addf(&ctx, "lea rax, [rbp-%d]", node->args->var.stack_offset);
+    Variable* va_list_var = ast_node_get_var(node->args->first);
+    asm_addf(&ctx, "lea rax, [rbp-%d]", va_list_var->stack_offset);
     asm_addf(&ctx, "mov dword [rax+0], 0");
     asm_addf(&ctx, "mov dword [rax+4], 6");
     // This does not quite work, need to offset into rbp for stack values
@@ -816,9 +943,9 @@ void gen_asm_if(ASTNode* node, AsmContext ctx) {
     char* else_label;
     asm_add_newline(&ctx, ctx.asm_text_src);
     asm_add_com(&ctx, "; Calculating if statement conditional");
-    gen_asm(node->cond, ctx); // Value now in RAX
+    gen_asm(node->control->cond, ctx); // Value now in RAX
     asm_addf(&ctx, "cmp rax, 0");
-    if (node->els != NULL) { // There is an else statement
+    if (node->control->els != NULL) { // There is an else statement
         else_label = str_copy(get_next_label_str(&ctx));
         asm_addf(&ctx, "je %s, ; Conditional false -> Jump to Else", else_label);
         gen_asm(node->body, ctx); // If body
@@ -826,7 +953,7 @@ void gen_asm_if(ASTNode* node, AsmContext ctx) {
         asm_addf(&ctx, "jmp %s ; Jump to end of if/else after if", after_label);
         asm_add_com(&ctx, "; Label: Else statement");
         asm_addf(&ctx, "%s: ; Else statement", else_label);
-        gen_asm(node->els, ctx); // Else body
+        gen_asm(node->control->els, ctx); // Else body
         asm_add_newline(&ctx, ctx.asm_text_src);
         free(else_label);
     }
@@ -850,21 +977,21 @@ void gen_asm_loop(ASTNode* node, AsmContext ctx) {
     // Setup ctx for break/continues
     ctx.last_start_label = loop_start_label;
     ctx.last_end_label = loop_end_label;
-    if (node->incr != NULL) { // For loop, jump needs to be near incr
+    if (node->control->incr != NULL) { // For loop, jump needs to be near incr
         ctx.last_start_label = str_copy(get_next_label_str(&ctx));
     }
     // Add asm
     asm_add_newline(&ctx, ctx.asm_text_src);
     asm_addf(&ctx, "%s:", loop_start_label);
     asm_add_com(&ctx, "; Calculating loop statement conditional");
-    gen_asm(node->cond, ctx); // Value now in RAX
+    gen_asm(node->control->cond, ctx); // Value now in RAX
     asm_addf(&ctx, "cmp rax, 0");
     asm_addf(&ctx, "je %s ; Jump to after loop if conditional is false", loop_end_label);
     asm_add_com(&ctx, "; Else, evaluate loop body");
     gen_asm(node->body, ctx);
-    if (node->incr != NULL) { // For loop increment
+    if (node->control->incr != NULL) { // For loop increment
         asm_addf(&ctx, "%s: ; For continue label", ctx.last_start_label);
-        gen_asm(node->incr, ctx);
+        gen_asm(node->control->incr, ctx);
         free(ctx.last_start_label);
     }
     asm_addf(&ctx, "jmp %s ; Jump to beginning of loop", loop_start_label);
@@ -883,7 +1010,7 @@ void gen_asm_do_loop(ASTNode* node, AsmContext ctx) {
     asm_add_com(&ctx, "; Evaluate do while body");
     gen_asm(node->body, ctx);
     asm_add_com(&ctx, "; Calculating while statement conditional at end");
-    gen_asm(node->cond, ctx); // Value now in RAX
+    gen_asm(node->control->cond, ctx); // Value now in RAX
     asm_addf(&ctx, "cmp rax, 0");
     asm_addf(&ctx, "jne %s ; Jump to start if conditional is true, otherwise keep going",
              while_start_label);
@@ -898,12 +1025,12 @@ void gen_asm_switch(ASTNode* node, AsmContext ctx) {
     asm_add_com(&ctx, "; Switch statement");
 
     // Get switch value into rax
-    gen_asm(node->cond, ctx);
+    gen_asm(node->control->cond, ctx);
     // Save it on rbx
     asm_addf(&ctx, "mov rbx, rax");
 
     // Iterate over the linked list of cases
-    ValueLabel* case_labels = node->switch_cases;
+    ValueLabel* case_labels = node->control->switch_cases;
     ValueLabel* default_label = NULL;
     while (case_labels != NULL) {
         // We need to do a comparison here, and jump if true
@@ -911,7 +1038,7 @@ void gen_asm_switch(ASTNode* node, AsmContext ctx) {
             default_label = case_labels;
         }
         else { // Normal cases
-            char* case_label_str = get_case_label_str(case_labels);
+            char* case_label_str = get_case_label_str(&ctx, case_labels);
             asm_addf(&ctx, "cmp rax, %d", case_labels->value);
             asm_addf(&ctx, "je %s ; Jump to the case label if value is equal",
                      case_label_str);
@@ -922,7 +1049,7 @@ void gen_asm_switch(ASTNode* node, AsmContext ctx) {
     char* switch_break_label = str_copy(get_next_label_str(&ctx));
     ctx.last_end_label = switch_break_label;
     if (default_label != NULL) { // We found a default case
-        char* default_label_str = get_case_label_str(default_label);
+        char* default_label_str = get_case_label_str(&ctx, default_label);
         asm_addf(&ctx, "jmp %s ; Jump to the default case label", default_label_str);
     }
     else { // No default case, jump to end
@@ -940,14 +1067,14 @@ void gen_asm_switch(ASTNode* node, AsmContext ctx) {
 // Generate assembly for a switch case
 void gen_asm_case(ASTNode* node, AsmContext ctx) {
     char* case_label_str;
-    if (node->label.is_default_case) { // Default case
-        case_label_str = get_case_label_str(&node->label);
+    if (node->label->is_default_case) { // Default case
+        case_label_str = get_case_label_str(&ctx, node->label);
         asm_addf(&ctx, "%s: ; Switch default case", case_label_str);
     }
     else {
-        case_label_str = get_case_label_str(&node->label);
+        case_label_str = get_case_label_str(&ctx, node->label);
         asm_addf(&ctx, "%s: ; Switch case for val %s", case_label_str,
-                 node->label.str_value);
+                 node->label->str_value);
     }
     gen_asm(node->next, ctx);
 }
@@ -956,24 +1083,31 @@ void gen_asm_case(ASTNode* node, AsmContext ctx) {
 void gen_asm_return(ASTNode* node, AsmContext ctx) {
     asm_add_newline(&ctx, ctx.asm_text_src);
     asm_add_com(&ctx, "; Evaluating return expr");
-    gen_asm(node->ret, ctx); // Expr is now in RAX
+    gen_asm(node->control->ret, ctx); // Expr is now in RAX
     // Cast to return type
-    gen_asm_unary_op_cast(ctx, node->cast_type, node->ret->cast_type);
+    gen_asm_unary_op_cast(ctx, ast_node_cast_type(node),
+                          ast_node_cast_type(node->control->ret));
     asm_addf(&ctx, "jmp %s ; Function return", ctx.func_return_label);
     gen_asm(node->next, ctx);
 }
 
 // Generate assembly comment which tags the assembly with the corresponding C code line
 void gen_asm_debug_tagging(ASTNode* node, AsmContext* ctx) {
-    if (node->debug_src_line_str != NULL) {
+    if (!node->debug_src_tagged) {
+        return;
+    }
+    char* line_str = source_file_get_line_str(node->debug_src_file_id, node->debug_src_offset);
+    if (line_str != NULL) {
+        char* filename_str = source_file_get(node->debug_src_file_id)->filename;
+        int line = source_file_get_line(node->debug_src_file_id, node->debug_src_offset);
         asm_add_newline(ctx, ctx->asm_text_src);
-        if (ctx->prev_filename_str != node->debug_src_filename_str) {
-            asm_addf(ctx, "; FILE | %s ", node->debug_src_filename_str);
-            ctx->prev_filename_str = node->debug_src_filename_str;
+        if (ctx->prev_filename_str != filename_str) {
+            asm_addf(ctx, "; FILE | %s ", filename_str);
+            ctx->prev_filename_str = filename_str;
         }
-        if (*ctx->prev_line != node->debug_src_line) {
-            asm_addf(ctx, "; L%d | %s ", node->debug_src_line, node->debug_src_line_str);
-            *ctx->prev_line = node->debug_src_line;
+        if (*ctx->prev_line != line) {
+            asm_addf(ctx, "; L%d | %s ", line, line_str);
+            *ctx->prev_line = line;
         }
     }
 }
\ No newline at end of file
@@ -12,6 +12,8 @@ and operations, and codegen.c file does everything else
 #include "parser.h"
 #include "util/string_helpers.h"
 
+#define ASM_LABEL_STR_SIZE 256
+
 // Contains various context data required
 struct AsmContext {
     // Global state
@@ -21,8 +23,13 @@ struct AsmContext {
     StrVector* asm_text_src;
     char** asm_indent_str;
     int indent_level;
+    // Each function has its own label counters. Jump labels are NASM local labels, so
+    // they belong to the function label, and string labels start with the function name
     int* label_count;
     int* cstring_label_count;
+    char* cstring_label_prefix; // Function name, NULL for the G_STR labels of globals
+    char* label_str; // Buffer of the label string functions, overwritten by each call
+    Vec* funcs; // AST_FUNC nodes found by gen_asm, NULL inside a function
     // Used by break and continue
     char* last_start_label; // Latest start label for loops
     char* last_end_label; // Latest end label for loops and switch
@@ -79,15 +86,20 @@ void asm_set_indent(AsmContext* ctx, int indent);
 
 // Create a new AsmContext object
 AsmContext asm_context_new();
+// Create the context of a function. It has no section headers, as its sections are
+// appended to the sections of the program context
+AsmContext asm_context_new_func(AsmContext* program_ctx, ASTNode* node);
+// Append the sections of a function context to the program context
+void asm_context_append(AsmContext* ctx, AsmContext* func_ctx);
 // Free memory used by an AsmContext object
 void asm_context_free(AsmContext* ctx);
 // Join the four assembly sections into a single string
 char* asm_context_join_srcs(AsmContext* ctx);
 
 // Get a C string representing a jump label
-char* get_label_str(int label);
+char* get_label_str(AsmContext* ctx, int label);
 // Get a C string representing a switch case jump label
-char* get_case_label_str(ValueLabel* label);
+char* get_case_label_str(AsmContext* ctx, ValueLabel* label);
 // Get the next jump label and increment the global label counter
 char* get_next_label_str(AsmContext* ctx);
 // Get the next label for constant c-strings, used for string literals
@@ -115,9 +127,21 @@ VarType promote_type(VarType type);
 // Generate NASM assembly from the AST
 char* generate_assembly(AST* ast, SymbolTable* symbols, bool include_asm_comments);
 
+// Generate NASM assembly, with the functions generated on up to thread_count threads.
+// The output does not depend on the thread count. A CCIC build always uses one thread
+char* generate_assembly_threaded(AST* ast, SymbolTable* symbols,
+                                 bool include_asm_comments, int thread_count);
+
 // Generate assembly from the node. Used recursively
 void gen_asm(ASTNode* node, AsmContext ctx);
 
+// Generate the functions collected by gen_asm, each in its own context, and append
+// them to the program context in source order
+void gen_asm_funcs(AsmContext* ctx, int thread_count);
+
+// Generate a function in its own context
+void gen_asm_func_in_context(ASTNode* node, AsmContext ctx);
+
 // Generate assembly for a function definition
 void gen_asm_func(ASTNode* node, AsmContext ctx);
 
@@ -235,7 +259,7 @@ void gen_asm_setup_short_circuiting(ASTNode* node, AsmContext* ctx);
 void gen_asm_add_short_circuit_jumps(ASTNode* node, AsmContext ctx);
 
 // Casting between any types
-void gen_asm_unary_op_cast(AsmContext ctx, VarType to_type, VarType from_type);
+void gen_asm_unary_op_cast(AsmContext ctx, VarType* to_type, VarType* from_type);
 
 // Generate assembly comment which tags the assembly with the corresponding C code line
 void gen_asm_debug_tagging(ASTNode* node, AsmContext* ctx);
\ No newline at end of file
@@ -12,7 +12,7 @@ void gen_asm_global_symbols(SymbolTable* symbols, AsmContext ctx) {
 
     asm_add_sectionf(&ctx, ctx.asm_data_src, "; External or global functions");
     for (size_t i = 0; i < symbols->func_count; i++) {
-        Function func = symbols->funcs[i];
+        Function func = *symbols->funcs[i];
         if (func.is_defined) {
             asm_add_sectionf(&ctx, ctx.asm_data_src, "global %s", func.name);
         }
@@ -27,7 +27,7 @@ void gen_asm_global_symbols(SymbolTable* symbols, AsmContext ctx) {
     // .data section, globals with constants
     asm_add_sectionf(&ctx, ctx.asm_data_src, "; Global variables");
     for (size_t i = 0; i < symbols->var_count; i++) {
-        Variable var = symbols->vars[i];
+        Variable var = *symbols->vars[i];
         if (!var.type.is_static) {
             gen_asm_global_variable(var, &ctx);
         }
@@ -39,7 +39,7 @@ void gen_asm_global_symbols(SymbolTable* symbols, AsmContext ctx) {
 void gen_asm_symbols(SymbolTable* symbols, AsmContext ctx) {
     // Handle static variables
     for (size_t i = 0; i < symbols->var_count; i++) {
-        Variable var = symbols->vars[i];
+        Variable var = *symbols->vars[i];
         if (var.type.is_static) {
             gen_asm_static_variable(var, &ctx);
         }
@@ -116,21 +116,22 @@ void gen_asm_static_variable(Variable var, AsmContext* ctx) {
 void gen_asm_array_initializer(ASTNode* node, AsmContext ctx) {
     // If this is a global or a static initializer, we can initialize when defining the asm variable
     int prev_indent_level = ctx.indent_level;
-    if (node->var.is_global || node->var.type.is_static) {
+    Variable* var = ast_node_get_var(node);
+    if (var->is_global || var->type.is_static) {
         asm_set_indent(&ctx, 0);
         asm_add_newline(&ctx, ctx.asm_data_src);
-        ASTNode* arg_node = node->args;
-        if (node->var.type.is_static) {
+        ASTNode* arg_node = node->args->first;
+        if (var->type.is_static) {
             asm_add_wn_sectionf(
-                &ctx, ctx.asm_data_src, "%s.%ds: %s ", node->var.name, node->var.unique_id,
-                bytes_to_data_width(get_deref_var_type(node->var.type).bytes));
+                &ctx, ctx.asm_data_src, "%s.%ds: %s ", var->name, var->unique_id,
+                bytes_to_data_width(get_deref_var_type(var->type).bytes));
         }
         else {
             asm_add_wn_sectionf(
-                &ctx, ctx.asm_data_src, "G_%s: %s ", node->var.name,
-                bytes_to_data_width(get_deref_var_type(node->var.type).bytes));
+                &ctx, ctx.asm_data_src, "G_%s: %s ", var->name,
+                bytes_to_data_width(get_deref_var_type(var->type).bytes));
         }
-        for (size_t i = 0; i < node->var.type.array_size; i++) {
+        for (size_t i = 0; i < var->type.array_size; i++) {
             if (arg_node->type != AST_END) { // Grab the argument value
                 if (arg_node->expr_type == EXPR_LITERAL) {
                     if (arg_node->literal_type == LT_STRING) {
@@ -144,18 +145,19 @@ void gen_asm_array_initializer(ASTNode* node, AsmContext ctx) {
                                             arg_node->literal);
                     }
                 }
-                else if (arg_node->expr_type == EXPR_VAR && arg_node->var.is_global) {
-                    if (arg_node->var.type.is_static) {
+                else if (arg_node->expr_type == EXPR_VAR && arg_node->var->is_global) {
+                    if (arg_node->var->type.is_static) {
+                        Variable* arg_var = arg_node->var;
                         asm_add_wn_sectionf(&ctx, ctx.asm_data_src, "%s.%ds, ",
-                                            arg_node->var.name, arg_node->var.unique_id);
+                                            arg_var->name, arg_var->unique_id);
                     }
-                    else if (arg_node->var.type.is_const) {
+                    else if (arg_node->var->type.is_const) {
                         asm_add_wn_sectionf(&ctx, ctx.asm_data_src, "%s, ",
-                                            arg_node->var.const_expr);
+                                            arg_node->var->const_expr);
                     }
                     else {
                         asm_add_wn_sectionf(&ctx, ctx.asm_data_src, "G_%s, ",
-                                            arg_node->var.name);
+                                            arg_node->var->name);
                     }
                 }
                 arg_node = arg_node->next;
@@ -168,11 +170,11 @@ void gen_asm_array_initializer(ASTNode* node, AsmContext ctx) {
     }
     else { // Otherwise, we have to move the values into the array
         asm_add_com(&ctx, "; Array initializer");
-        int stack_ptr = node->var.stack_offset;
-        VarType deref_type = get_deref_var_type(node->var.type);
-        int end_stack_ptr = node->var.stack_offset -
-                            deref_type.bytes * node->var.type.array_size;
-        ASTNode* arg_node = node->args;
+        int stack_ptr = var->stack_offset;
+        VarType deref_type = get_deref_var_type(var->type);
+        int end_stack_ptr = var->stack_offset -
+                            deref_type.bytes * var->type.array_size;
+        ASTNode* arg_node = node->args->first;
         char* addr_size = bytes_to_addr_width(deref_type.bytes);
         while (stack_ptr > end_stack_ptr) {
             if (arg_node->type != AST_END) { // Grab the argument value
@@ -190,18 +192,18 @@ void gen_asm_array_initializer(ASTNode* node, AsmContext ctx) {
                                  arg_node->literal);
                     }
                 }
-                else if (arg_node->expr_type == EXPR_VAR && arg_node->var.is_global) {
-                    if (arg_node->var.type.is_static) {
-                        asm_addf(&ctx, "mov rax, [%s.%ds]", arg_node->var.name,
-                                 arg_node->var.unique_id);
+                else if (arg_node->expr_type == EXPR_VAR && arg_node->var->is_global) {
+                    if (arg_node->var->type.is_static) {
+                        asm_addf(&ctx, "mov rax, [%s.%ds]", arg_node->var->name,
+                                 arg_node->var->unique_id);
                         asm_addf(&ctx, "mov %s [rbp-%d], rax", addr_size, stack_ptr);
                     }
-                    else if (arg_node->var.type.is_const) {
+                    else if (arg_node->var->type.is_const) {
                         asm_addf(&ctx, "mov %s [rbp-%d], %s", addr_size, stack_ptr,
-                                 arg_node->var.const_expr);
+                                 arg_node->var->const_expr);
                     }
                     else {
-                        asm_addf(&ctx, "mov rax, [G_%s]", arg_node->var.name);
+                        asm_addf(&ctx, "mov rax, [G_%s]", arg_node->var->name);
                         asm_addf(&ctx, "mov %s [rbp-%d], rax", addr_size, stack_ptr);
                     }
                 }
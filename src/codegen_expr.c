@@ -37,28 +37,29 @@ void gen_asm_expr(ASTNode* node, AsmContext ctx) {
 // Generate assembly for accessing a variable
 void gen_asm_variable(ASTNode* node, AsmContext ctx) {
     // Access a variable and store it in rax
-    char* sp2 = var_to_stack_ptr(&node->var);
+    Variable* var = ast_node_get_var(node);
+    char* sp2 = var_to_stack_ptr(var);
     // Handle various variable types
-    if (node->var.type.is_const) { // Constant
-        asm_addf(&ctx, "mov rax, %s", node->var.const_expr);
+    if (var->type.is_const) { // Constant
+        asm_addf(&ctx, "mov rax, %s", var->const_expr);
     }
-    else if (node->var.type.is_struct_member) {
+    else if (var->type.is_struct_member) {
         // Struct member. Lhs must be struct, which means
         // pop rax will give us the lhs memory value
-        char* addr_size = bytes_to_addr_width(node->var.type.bytes);
-        char* move_instr = get_move_instr_for_var_type(node->var.type);
-        int offset = node->var.type.struct_bytes_offset;
+        char* addr_size = bytes_to_addr_width(var->type.bytes);
+        char* move_instr = get_move_instr_for_var_type(var->type);
+        int offset = var->type.struct_bytes_offset;
         // Save rax for potential deref assignment
         asm_add_com(&ctx, "; Struct member variable access");
         asm_addf(&ctx, "pop rax");
         asm_addf(&ctx, "lea r12, [rax+%d]", offset);
         asm_addf(&ctx, "push rax");
-        if (node->var.type.is_array ||
-            (node->var.type.type == TY_STRUCT && node->var.type.ptr_level == 0)) {
+        if (var->type.is_array ||
+            (var->type.type == TY_STRUCT && var->type.ptr_level == 0)) {
             // If the member variable is a struct or array, we want the address in rax
             asm_addf(&ctx, "mov rax, r12", offset);
         }
-        else if (node->var.type.type == TY_FLOAT) {
+        else if (var->type.type == TY_FLOAT) {
             asm_addf(&ctx, "movq xmm0, [r12]");
         }
         else { // Else, get the value
@@ -66,28 +67,28 @@ void gen_asm_variable(ASTNode* node, AsmContext ctx) {
         }
         free(move_instr);
     }
-    else if (node->var.type.is_array ||
-             (node->var.type.type == TY_STRUCT && node->var.type.ptr_level == 0)) {
+    else if (var->type.is_array ||
+             (var->type.type == TY_STRUCT && var->type.ptr_level == 0)) {
         // We store the address of array/pointers, not the value
-        if (node->var.type.is_static) {
-            asm_addf(&ctx, "lea rax, [%s.%ds]", node->var.name, node->var.unique_id);
+        if (var->type.is_static) {
+            asm_addf(&ctx, "lea rax, [%s.%ds]", var->name, var->unique_id);
         }
-        else if (node->var.is_global) {
-            asm_addf(&ctx, "lea rax, [G_%s]", node->var.name);
+        else if (var->is_global) {
+            asm_addf(&ctx, "lea rax, [G_%s]", var->name);
         }
         else {
-            asm_addf(&ctx, "lea rax, [rbp-%d]", node->var.stack_offset);
+            asm_addf(&ctx, "lea rax, [rbp-%d]", var->stack_offset);
         }
     }
-    else if (node->var.type.type == TY_INT || node->var.type.ptr_level > 0) {
+    else if (var->type.type == TY_INT || var->type.ptr_level > 0) {
         // Integer/pointer type, store value in rax
-        char* move_instr = get_move_instr_for_var_type(node->var.type);
-        asm_addf(&ctx, "%s, %s ; var %s", move_instr, sp2, node->var.name);
+        char* move_instr = get_move_instr_for_var_type(var->type);
+        asm_addf(&ctx, "%s, %s ; var %s", move_instr, sp2, var->name);
         free(move_instr);
     }
-    else if (node->var.type.type == TY_FLOAT) {
+    else if (var->type.type == TY_FLOAT) {
         // Floating point type, store in xmm0
-        if (node->var.type.bytes == 4) {
+        if (var->type.bytes == 4) {
             asm_addf(&ctx, "movd xmm0, %s", sp2);
             asm_addf(&ctx, "cvtss2sd xmm0, xmm0");
         }
@@ -126,16 +127,17 @@ void gen_asm_literal(ASTNode* node, AsmContext ctx) {
 }
 
 void gen_asm_unary_op(ASTNode* node, AsmContext ctx) {
-    if (node->cast_type.ptr_level > 0) { // Pointer
+    VarType* cast_type = ast_node_cast_type(node);
+    if (cast_type->ptr_level > 0) { // Pointer
         gen_asm_unary_op_ptr(node, ctx);
     }
-    else if (node->cast_type.type == TY_INT) {
+    else if (cast_type->type == TY_INT) {
         gen_asm_unary_op_int(node, ctx);
     }
-    else if (node->cast_type.type == TY_FLOAT) {
+    else if (cast_type->type == TY_FLOAT) {
         gen_asm_unary_op_float(node, ctx);
     }
-    else if (node->cast_type.type == TY_STRUCT) {
+    else if (cast_type->type == TY_STRUCT) {
         gen_asm_unary_op_struct(node, ctx);
     }
     else {
@@ -144,17 +146,18 @@ void gen_asm_unary_op(ASTNode* node, AsmContext ctx) {
 }
 
 void gen_asm_binary_op(ASTNode* node, AsmContext ctx) {
-    if (node->cast_type.ptr_level > 0) { // Pointer
+    VarType* cast_type = ast_node_cast_type(node);
+    if (cast_type->ptr_level > 0) { // Pointer
         gen_asm_binary_op_ptr(node, ctx);
     }
-    else if (node->cast_type.type == TY_INT) { // Int
+    else if (cast_type->type == TY_INT) { // Int
         // We need to perform implicit casting here
         gen_asm_binary_op_int(node, ctx);
     }
-    else if (node->cast_type.type == TY_FLOAT) { // Float
+    else if (cast_type->type == TY_FLOAT) { // Float
         gen_asm_binary_op_float(node, ctx);
     }
-    else if (node->cast_type.type == TY_STRUCT) {
+    else if (cast_type->type == TY_STRUCT) {
         gen_asm_binary_op_struct(node, ctx);
     }
     else {
@@ -167,7 +170,7 @@ void gen_asm_unary_op_address(ASTNode* node, AsmContext ctx) {
     asm_add_com(&ctx, "; Op: & (address)");
     if (node->expr_type == EXPR_VAR) {
         asm_addf(&ctx, "mov rax, 0");
-        asm_addf(&ctx, "lea rax, [rbp-%d]", node->var.stack_offset);
+        asm_addf(&ctx, "lea rax, [rbp-%d]", ast_node_get_var(node)->stack_offset);
     }
     else if ((node->expr_type == EXPR_UNOP && node->op_type == UOP_DEREF) ||
              (node->expr_type == EXPR_BINOP && node->op_type == BOP_MEMBER)) {
@@ -183,7 +186,7 @@ void gen_asm_unary_op_address(ASTNode* node, AsmContext ctx) {
 
 void gen_asm_unary_op_int(ASTNode* node, AsmContext ctx) {
     gen_asm(node->rhs, ctx); // The value we are acting on is now in RAX
-    char* var_sp = var_to_stack_ptr(&node->rhs->var);
+    char* var_sp = var_to_stack_ptr(ast_node_get_var(node->rhs));
     switch (node->op_type) {
         case UOP_NEG: // Negation
             asm_addf(&ctx, "neg rax");
@@ -230,29 +233,31 @@ void gen_asm_unary_op_int(ASTNode* node, AsmContext ctx) {
             gen_asm_binary_op_assign_int(node->rhs, ctx);
             asm_addf(&ctx, "pop rax");
             break;
-        case UOP_SIZEOF:
+        case UOP_SIZEOF: {
             asm_add_com(&ctx, "; Op: sizeof");
-            if (node->rhs->cast_type.is_array) {
+            VarType* rhs_type = ast_node_cast_type(node->rhs);
+            if (rhs_type->is_array) {
                 asm_addf(&ctx, "mov rax, %d",
-                         node->rhs->cast_type.array_size *
-                             node->rhs->cast_type.ptr_value_bytes);
+                         rhs_type->array_size * rhs_type->ptr_value_bytes);
             }
-            else if (node->rhs->cast_type.type == TY_STRUCT &&
-                     node->rhs->cast_type.ptr_level == 0) {
-                asm_addf(&ctx, "mov rax, %d", node->rhs->var.struct_type.struct_type.bytes);
+            else if (rhs_type->type == TY_STRUCT && rhs_type->ptr_level == 0) {
+                asm_addf(&ctx, "mov rax, %d",
+                         variable_struct_bytes(ast_node_get_var(node->rhs)));
             }
             else {
-                asm_addf(&ctx, "mov rax, %d", node->rhs->cast_type.bytes);
+                asm_addf(&ctx, "mov rax, %d", rhs_type->bytes);
             }
             break;
+        }
         case UOP_CAST:
             asm_add_com(&ctx, "; Op: cast");
-            gen_asm_unary_op_cast(ctx, node->cast_type, node->rhs->cast_type);
+            gen_asm_unary_op_cast(ctx, ast_node_cast_type(node),
+                                  ast_node_cast_type(node->rhs));
             break;
         case UOP_DEREF: { // Deref from int pointer
             asm_add_com(&ctx, "; Op: * (deref)");
-            char* addr_size = bytes_to_addr_width(node->cast_type.bytes);
-            char* move_instr = get_move_instr_for_var_type(node->cast_type);
+            char* addr_size = bytes_to_addr_width(ast_node_cast_type(node)->bytes);
+            char* move_instr = get_move_instr_for_var_type(*ast_node_cast_type(node));
             asm_addf(&ctx, "mov r12, rax"); // Save rax for potential deref assignment
             asm_addf(&ctx, "%s, %s [rax]", move_instr, addr_size);
             free(move_instr);
@@ -287,7 +292,7 @@ void gen_asm_binary_op_int(ASTNode* node, AsmContext ctx) {
     asm_addf(&ctx, "push rax"); // Save RAX
     gen_asm(node->rhs, ctx); // LHS now in RAX
     // Check if we need to cast rhs
-    gen_asm_unary_op_cast(ctx, node->cast_type, node->rhs->cast_type);
+    gen_asm_unary_op_cast(ctx, ast_node_cast_type(node), ast_node_cast_type(node->rhs));
     asm_addf(&ctx, "mov rbx, rax"); // Move RHS to RBX
     asm_addf(&ctx, "pop rax"); // LHS now in RAX
     // We are now ready for the binary operation
@@ -414,20 +419,19 @@ void gen_asm_binary_op_int(ASTNode* node, AsmContext ctx) {
 
 void gen_asm_binary_op_assign_int(ASTNode* node, AsmContext ctx) {
     if (node->expr_type == EXPR_VAR) {
-        char* reg_str = get_reg_width_str(node->var.type.bytes, RAX);
-        char* var_sp = var_to_stack_ptr(&node->var);
+        char* reg_str = get_reg_width_str(ast_node_get_var(node)->type.bytes, RAX);
+        char* var_sp = var_to_stack_ptr(ast_node_get_var(node));
         asm_addf(&ctx, "mov %s, %s", var_sp, reg_str);
         free(var_sp);
     }
     else if (node->expr_type == EXPR_UNOP && node->op_type == UOP_DEREF) {
-        node->var.type.bytes = node->var.type.ptr_value_bytes;
-        char* reg_str = get_reg_width_str(node->cast_type.bytes, RAX);
-        char* addr_size_str = bytes_to_addr_width(node->cast_type.bytes);
+        char* reg_str = get_reg_width_str(ast_node_cast_type(node)->bytes, RAX);
+        char* addr_size_str = bytes_to_addr_width(ast_node_cast_type(node)->bytes);
         asm_addf(&ctx, "mov %s [r12], %s", addr_size_str, reg_str);
     }
     else if (node->expr_type == EXPR_BINOP && node->op_type == BOP_MEMBER) {
-        char* reg_str = get_reg_width_str(node->cast_type.bytes, RAX);
-        char* addr_size_str = bytes_to_addr_width(node->cast_type.bytes);
+        char* reg_str = get_reg_width_str(ast_node_cast_type(node)->bytes, RAX);
+        char* addr_size_str = bytes_to_addr_width(ast_node_cast_type(node)->bytes);
         asm_addf(&ctx, "mov %s [r12], %s", addr_size_str, reg_str);
     }
     else {
@@ -473,7 +477,7 @@ void gen_asm_binary_op_or_int(ASTNode* node, AsmContext ctx) {
 // Generate assembly for a float unary op expression node
 void gen_asm_unary_op_float(ASTNode* node, AsmContext ctx) {
     gen_asm(node->rhs, ctx); // The value we are acting on is now in RAX
-    char* var_sp = var_to_stack_ptr(&node->rhs->var);
+    char* var_sp = var_to_stack_ptr(ast_node_get_var(node->rhs));
     switch (node->op_type) {
         case UOP_NEG: // Negation
             // Move into integer reg, flip first bit with xor
@@ -484,19 +488,20 @@ void gen_asm_unary_op_float(ASTNode* node, AsmContext ctx) {
             break;
         case UOP_SIZEOF:
             asm_add_com(&ctx, "; Op: sizeof");
-            asm_addf(&ctx, "mov rax, %s", node->rhs->cast_type.bytes);
+            asm_addf(&ctx, "mov rax, %s", ast_node_cast_type(node->rhs)->bytes);
             break;
         case UOP_CAST:
             asm_add_com(&ctx, "; Op: cast");
-            gen_asm_unary_op_cast(ctx, node->cast_type, node->rhs->cast_type);
+            gen_asm_unary_op_cast(ctx, ast_node_cast_type(node),
+                                  ast_node_cast_type(node->rhs));
             break;
         case UOP_DEREF: { // Deref from int pointer
             asm_add_com(&ctx, "; fOp: * (deref)");
-            char* addr_size = bytes_to_addr_width(node->cast_type.bytes);
-            char* move_instr = get_move_instr_for_var_type(node->cast_type);
+            char* addr_size = bytes_to_addr_width(ast_node_cast_type(node)->bytes);
+            char* move_instr = get_move_instr_for_var_type(*ast_node_cast_type(node));
             asm_addf(&ctx, "mov r12, rax"); // Save rax for potential deref assignment
             asm_addf(&ctx, "%s, %s [rax]", move_instr, addr_size);
-            if (node->cast_type.bytes == 4) {
+            if (ast_node_cast_type(node)->bytes == 4) {
                 asm_addf(&ctx, "movd xmm0, eax");
                 asm_addf(&ctx, "cvtss2sd xmm0, xmm0");
             }
@@ -524,18 +529,19 @@ void gen_asm_binary_op_float(ASTNode* node, AsmContext ctx) {
         asm_addf(&ctx, "push r12");
     }
     // Check if we need to cast lhs (lhs is int)
-    gen_asm_unary_op_cast(ctx, node->cast_type, node->lhs->cast_type);
+    gen_asm_unary_op_cast(ctx, ast_node_cast_type(node), ast_node_cast_type(node->lhs));
 
     gen_asm_add_short_circuit_jumps(node, ctx); // AND/OR Short circuiting related
 
     // Save xmm0 in rax. In a few cases we don't want to do this, check for that
-    if (!(node->lhs->expr_type == EXPR_VAR && node->lhs->var.type.type == TY_STRUCT)) {
+    if (!(node->lhs->expr_type == EXPR_VAR &&
+          ast_node_get_var(node->lhs)->type.type == TY_STRUCT)) {
         asm_addf(&ctx, "movq rax, xmm0");
     }
     asm_addf(&ctx, "push rax"); // Save RAX
     gen_asm(node->rhs, ctx);
     // Check if we need to cast rhs (rhs is int)
-    gen_asm_unary_op_cast(ctx, node->cast_type, node->rhs->cast_type);
+    gen_asm_unary_op_cast(ctx, ast_node_cast_type(node), ast_node_cast_type(node->rhs));
     asm_addf(&ctx, "movq xmm1, xmm0"); // Move RHS to XMM1
     asm_addf(&ctx, "pop rax"); // LHS now in RAX
     asm_addf(&ctx, "movq xmm0, rax"); // LHS now in XMM0
@@ -623,12 +629,13 @@ void gen_asm_binary_op_float(ASTNode* node, AsmContext ctx) {
 }
 // Generate assembly for a binary op assignment expression node
 void gen_asm_binary_op_assign_float(ASTNode* node, AsmContext ctx) {
-    char* move_instr = get_float_move_for_byte_size(node->cast_type.bytes);
-    if (node->cast_type.bytes == 4) { // Convert to 32 bit float if assigning to 32 bit
+    char* move_instr = get_float_move_for_byte_size(ast_node_cast_type(node)->bytes);
+    // Convert to 32 bit float if assigning to 32 bit
+    if (ast_node_cast_type(node)->bytes == 4) {
         asm_addf(&ctx, "cvtsd2ss xmm0, xmm0");
     }
     if (node->expr_type == EXPR_VAR) {
-        char* var_sp = var_to_stack_ptr(&node->var);
+        char* var_sp = var_to_stack_ptr(ast_node_get_var(node));
         asm_addf(&ctx, "%s %s, xmm0", move_instr, var_sp);
         free(var_sp);
     }
@@ -647,7 +654,7 @@ void gen_asm_binary_op_assign_float(ASTNode* node, AsmContext ctx) {
 // Generate assembly for a float unary op expression node
 void gen_asm_unary_op_ptr(ASTNode* node, AsmContext ctx) {
     gen_asm(node->rhs, ctx); // The value we are acting on is now in RAX
-    char* var_sp = var_to_stack_ptr(&node->rhs->var);
+    char* var_sp = var_to_stack_ptr(ast_node_get_var(node->rhs));
     switch (node->op_type) {
         case UOP_ADDR:
             gen_asm_unary_op_address(node->rhs, ctx);
@@ -659,7 +666,8 @@ void gen_asm_unary_op_ptr(ASTNode* node, AsmContext ctx) {
             break;
         case UOP_CAST:
             asm_add_com(&ctx, "; Op: cast");
-            gen_asm_unary_op_cast(ctx, node->cast_type, node->rhs->cast_type);
+            gen_asm_unary_op_cast(ctx, ast_node_cast_type(node),
+                                  ast_node_cast_type(node->rhs));
             break;
         // Increment, decrement
         // This is kind of a form of assignment
@@ -723,14 +731,14 @@ void gen_asm_binary_op_ptr(ASTNode* node, AsmContext ctx) {
         asm_addf(&ctx, "push r12");
     }
     // Check if we need to cast lhs
-    gen_asm_unary_op_cast(ctx, node->cast_type, node->lhs->cast_type);
+    gen_asm_unary_op_cast(ctx, ast_node_cast_type(node), ast_node_cast_type(node->lhs));
     gen_asm_add_short_circuit_jumps(node, ctx); // AND/OR Short circuiting related
 
     asm_addf(&ctx, "push rax"); // Save RAX
     gen_asm(node->rhs, ctx); // LHS now in RAX
     asm_addf(&ctx, "mov rbx, rax"); // Move RHS to RBX
     // Check if we need to cast rhs
-    gen_asm_unary_op_cast(ctx, node->cast_type, node->rhs->cast_type);
+    gen_asm_unary_op_cast(ctx, ast_node_cast_type(node), ast_node_cast_type(node->rhs));
     asm_addf(&ctx, "pop rax"); // LHS now in RAX
     // We are now ready for the binary operation
     switch (node->op_type) { // These are all integer operations
@@ -811,7 +819,7 @@ void gen_asm_binary_op_ptr(ASTNode* node, AsmContext ctx) {
 void gen_asm_binary_op_load_ptr_size(ASTNode* node, AsmContext ctx) {
     // Multiply rbx with pointer size
     // We need to check for type here. Only multiply if int
-    int bytes = get_deref_var_type(node->cast_type).bytes;
+    int bytes = get_deref_var_type(*ast_node_cast_type(node)).bytes;
     asm_addf(&ctx, "imul rbx, %d", bytes);
 }
 
@@ -822,7 +830,7 @@ void gen_asm_unary_op_struct(ASTNode* node, AsmContext ctx) {
     switch (node->op_type) {
         case UOP_SIZEOF:
             asm_add_com(&ctx, "; sOp: sizeof");
-            asm_addf(&ctx, "mov rax, %d", node->rhs->cast_type.bytes);
+            asm_addf(&ctx, "mov rax, %d", ast_node_cast_type(node->rhs)->bytes);
             break;
         case UOP_DEREF: { // Deref from struct pointer
             asm_add_com(&ctx, "; sOp: * (deref)");
@@ -874,13 +882,15 @@ void gen_asm_binary_op_struct(ASTNode* node, AsmContext ctx) {
 // Generate assembly for a struct binary op assignment expression node
 void gen_asm_binary_op_assign_struct(ASTNode* node, AsmContext ctx) {
     // Perform a memcpy from address in rbx to address in rax
-    if (node->rhs->var.struct_type.struct_type.bytes != node->lhs->cast_type.bytes) {
+    if (variable_struct_bytes(ast_node_get_var(node->rhs)) !=
+        ast_node_cast_type(node->lhs)->bytes) {
         codegen_error("Attempted to assign a struct to a struct of different size!");
     }
     // memcpy: rdi: dest_ptr, rsi: src_ptr, rdx: size_t (bytes)
     asm_addf(&ctx, "mov rdi, rax");
     asm_addf(&ctx, "mov rsi, rbx");
-    asm_addf(&ctx, "mov rdx, %d", node->rhs->var.struct_type.struct_type.bytes);
+    int struct_bytes = variable_struct_bytes(ast_node_get_var(node->rhs));
+    asm_addf(&ctx, "mov rdx, %d", struct_bytes);
     asm_addf(&ctx, "call memcpy");
 }
 
@@ -926,50 +936,50 @@ void gen_asm_add_short_circuit_jumps(ASTNode* node, AsmContext ctx) {
     }
 }
 
-void gen_asm_unary_op_cast(AsmContext ctx, VarType to_type, VarType from_type) {
+void gen_asm_unary_op_cast(AsmContext ctx, VarType* to_type, VarType* from_type) {
     // We have value in rax or xmm0
-    if (to_type.ptr_level > 0 && from_type.ptr_level > 0) {
+    if (to_type->ptr_level > 0 && from_type->ptr_level > 0) {
         // Pointer to pointer
         return; // No need to do anything
     }
-    else if (to_type.type == TY_INT && from_type.type == TY_FLOAT) {
+    else if (to_type->type == TY_INT && from_type->type == TY_FLOAT) {
         // Float to int
         asm_add_com(&ctx, "; Float to int cast");
-        if (from_type.bytes == 4) {
+        if (from_type->bytes == 4) {
             asm_addf(&ctx, "cvttsd2si eax, xmm0");
         }
         else { // 8 bytes
             asm_addf(&ctx, "cvttsd2si rax, xmm0");
         }
     }
-    else if (to_type.type == TY_FLOAT && from_type.type == TY_INT) {
+    else if (to_type->type == TY_FLOAT && from_type->type == TY_INT) {
         // Int to float
         asm_add_com(&ctx, "; Int to float cast");
-        if (to_type.bytes == 4) {
+        if (to_type->bytes == 4) {
             asm_addf(&ctx, "cvtsi2sd xmm0, eax");
         }
         else { // 8 bytes
             asm_addf(&ctx, "cvtsi2sd xmm0, rax");
         }
     }
-    else if (to_type.type == TY_INT && from_type.ptr_level > 0) {
+    else if (to_type->type == TY_INT && from_type->ptr_level > 0) {
         // Pointer to int
         return;
     }
-    else if (to_type.ptr_level > 0 && from_type.type == TY_INT) {
+    else if (to_type->ptr_level > 0 && from_type->type == TY_INT) {
         // Int to pointer
         return;
     }
-    else if (to_type.type == TY_INT && from_type.type == TY_INT) {
+    else if (to_type->type == TY_INT && from_type->type == TY_INT) {
         return; // No need to do anything
     }
-    else if (to_type.type == TY_FLOAT && from_type.type == TY_FLOAT) {
+    else if (to_type->type == TY_FLOAT && from_type->type == TY_FLOAT) {
         return; // No need to do anything
     }
-    else if (to_type.type == TY_VOID) {
+    else if (to_type->type == TY_VOID) {
         return;
     }
-    else if (from_type.type == TY_STRUCT) {
+    else if (from_type->type == TY_STRUCT) {
         return;
     }
     else {
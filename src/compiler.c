@@ -1,6 +1,9 @@
 #include "preprocess.h"
+#include "pch.h"
+#include "token_cache.h"
 #include "parser.h"
 #include "codegen.h"
+#include "driver.h"
 #include "util/args.h"
 
 /*
@@ -41,34 +44,28 @@ INFO:
 
 int main(int argc, char** argv) {
     CompileOptions options = parse_compiler_options(argc, argv);
+    scan_init();
+    if (options.token_cache_dir != NULL) {
+        token_cache_set_dir(options.token_cache_dir);
+    }
 
-    printf("Compiling source file \"%s\"\n", options.src_filename);
+    if (options.build_pch) {
+        // Precompile a header to <header>.pch, which is used when it is the first include
+        int token_count = pch_build(options.src_filename);
+        printf("Precompiled header \"%s\" (%d tokens)\n", options.src_filename, token_count);
+        source_files_free();
+        intern_pool_free();
+        free(options.output_filename);
+        return 0;
+    }
 
-    // Step 1: Preprocessing + Tokenization
-    PreprocessorTable table = preprocessor_table_new();
-    Tokens tokens = preprocess_first(options.src_filename, &table);
-    //tokens_pretty_print(&tokens);
-
-    // Step 2: AST Parsing
-    SymbolTable* symbols = symbol_table_new();
-    AST ast = parse(&tokens, symbols);
-
-    // Step 3: ASM Code Generation
-    char* asm_src = generate_assembly(&ast, symbols, options.debug_annotate_assembly);
-
-    // Save ASM src to file and compile with NASM
-    compile_asm(asm_src, options);
-
-    // Free memory
-    symbol_table_free(symbols);
-    preprocessor_table_free(&table);
-    tokens_free(&tokens);
-    tokens_free_line_strings(&tokens);
-    ast_free(&ast);
-    free(asm_src);
-    free(options.output_filename);
-
-    printf("Compilation complete\n");
+    if (options.src_count > 1) {
+        // Several source files are compiled by worker processes and linked together
+        compile_files(options);
+    }
+    else {
+        compile_file(options);
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "driver.h"
+
+void compile_file(CompileOptions options) {
+    printf("Compiling source file \"%s\"\n", options.src_filename);
+    long start = time_now_us();
+
+    // Step 1: Preprocessing + Tokenization
+    // Tokens are streamed to the parser as it needs them
+    PreprocessorTable table = preprocessor_table_new();
+    TokenStream stream = token_stream_new(options.src_filename, &table);
+
+    // Step 2: AST Parsing
+    SymbolTable* symbols = symbol_table_new();
+    AST ast = parse_token_stream(&stream, symbols);
+    // Tokenizing happens while parsing, so its time is included in the parse time
+    long parsed = time_now_us();
+
+    // Step 3: ASM Code Generation
+    // The functions are generated on the job threads
+    bool annotate = options.debug_annotate_assembly;
+    char* asm_src = generate_assembly_threaded(&ast, symbols, annotate, options.jobs);
+    long generated = time_now_us();
+
+    // Save ASM src to file and compile with NASM
+    if (!compile_asm(asm_src, options)) {
+        fprintf(stderr, "Error: Assembling \"%s\" failed\n", options.src_filename);
+        exit(EXIT_FAILURE);
+    }
+    long assembled = time_now_us();
+
+    // Write the files the output depends on as a make rule, for incremental builds
+    if (options.dependency_filename != NULL) {
+        char* rule = preprocessor_table_dependency_rule(&table, options.output_filename);
+        write_string_to_file(options.dependency_filename, rule);
+        free(rule);
+        free(options.dependency_filename);
+    }
+
+    // Free memory
+    symbol_table_free(symbols);
+    preprocessor_table_free(&table);
+    token_stream_free(&stream);
+    source_files_free();
+    intern_pool_free();
+    ast_free(&ast);
+    type_table_free();
+    free(asm_src);
+    free(options.output_filename);
+
+    if (options.time_report) {
+        print_phase_time("Preprocess + parse", parsed - start);
+        print_phase_time("  Tokenize", token_cache_tokenize_us());
+        print_phase_time("Codegen", generated - parsed);
+        print_phase_time("Assemble", assembled - generated);
+        print_phase_time("Total", time_now_us() - start);
+    }
+    printf("Compilation complete\n");
+}
+
+void print_phase_time(char* phase, long us) {
+    printf("%-20s %ld.%03ld ms\n", phase, us / 1000, us % 1000);
+}
+
+void compile_files(CompileOptions options) {
+    StrVector objects = str_vec_new(options.src_count);
+    int workers = 0;
+    bool failed = false;
+    for (int i = 0; i < options.src_count; i++) {
+        CompileOptions file_options = compile_file_options(&options, i);
+        str_vec_push(&objects, file_options.output_filename);
+        if (workers == options.jobs) {
+            failed = !wait_for_worker() || failed;
+            workers--;
+        }
+        // Output which is still buffered would be written by the worker as well
+        fflush(stdout);
+        int pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            compile_file(file_options);
+            str_vec_free(&objects);
+            free(options.output_filename);
+            exit(EXIT_SUCCESS);
+        }
+        free(file_options.output_filename);
+        free(file_options.dependency_filename);
+        workers++;
+    }
+    while (workers > 0) {
+        failed = !wait_for_worker() || failed;
+        workers--;
+    }
+
+    if (!failed && options.link_with_gcc) {
+        failed = !link_objects(objects.elems, objects.size, options);
+    }
+    if (options.link_with_gcc) {
+        for (int i = 0; i < objects.size; i++) {
+            remove(objects.elems[i]);
+        }
+    }
+    str_vec_free(&objects);
+    free(options.output_filename);
+    if (failed) {
+        fprintf(stderr, "Error: Compilation failed\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+CompileOptions compile_file_options(CompileOptions* options, int index) {
+    CompileOptions file_options = *options;
+    file_options.src_filename = options->src_filenames[index];
+    file_options.src_filenames = &options->src_filenames[index];
+    file_options.src_count = 1;
+    file_options.link_with_gcc = false;
+    file_options.dependency_filename = NULL;
+    // The jobs are already used by the worker processes
+    file_options.jobs = 1;
+    if (options->link_with_gcc) {
+        // Objects which are linked are named after the output, so source files with
+        // the same name in different directories do not overwrite each other
+        char suffix[32];
+        snprintf(suffix, 31, ".%d.o", index);
+        file_options.output_filename = str_add(options->output_filename, suffix);
+    }
+    else {
+        file_options.output_filename = object_filename(file_options.src_filename);
+        // Make rule files are only written for objects which are kept
+        if (options->dependency_filename != NULL) {
+            file_options.dependency_filename =
+                dependency_filename(file_options.output_filename);
+        }
+    }
+    return file_options;
+}
+
+bool wait_for_worker() {
+    int status = 0;
+    if (wait(&status) < 0) {
+        perror("wait");
+        exit(EXIT_FAILURE);
+    }
+    return status == 0;
+}
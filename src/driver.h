@@ -0,0 +1,38 @@
+// Compilation driver
+// Compiles the source files given on the command line. With several source files,
+// every file is compiled to an object by a worker process, running up to the number
+// of jobs at once, and the objects are linked in a single step after all are done.
+// Workers are processes instead of threads, as tokenizing registers source files in a
+// global table and compile errors exit the process. Token caches and precompiled
+// headers are shared between workers through their files.
+
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "preprocess.h"
+#include "parser.h"
+#include "codegen.h"
+#include "token_cache.h"
+#include "util/args.h"
+#include "util/file_helpers.h"
+
+// Preprocess, parse and generate the assembly of the source file of the options, and
+// assemble it to the output file. Exits on compilation errors
+void compile_file(CompileOptions options);
+
+// Print the milliseconds spent in a compilation phase for --time
+void print_phase_time(char* phase, long us);
+
+// Compile every source file of the options in worker processes and link the objects
+// unless compiling with -c. Exits if compiling any file fails
+void compile_files(CompileOptions options);
+
+// Options for compiling the source file at index to an object in a worker.
+// The object and make rule file names are owned by the caller
+CompileOptions compile_file_options(CompileOptions* options, int index);
+
+// Wait for a worker to exit, returns false if it failed
+bool wait_for_worker();
@@ -0,0 +1,213 @@
+/*
+Perfect hash table of the C keywords recognized by the tokenizer.
+Generated by tools/gen_keyword_hash.c, regenerate with make keywords.
+*/
+#pragma once
+#include "tokens.h"
+
+#define KEYWORD_HASH_SIZE 64
+#define KEYWORD_HASH_FIRST_MULT 1
+#define KEYWORD_HASH_LAST_MULT 58
+#define KEYWORD_HASH_LENGTH_MULT 24
+#define KEYWORD_MAX_LENGTH 8
+
+static char* keyword_hash_strings[KEYWORD_HASH_SIZE] = {
+    "",
+    "",
+    "for",
+    "",
+    "",
+    "continue",
+    "",
+    "",
+    "",
+    "",
+    "",
+    "struct",
+    "",
+    "",
+    "",
+    "",
+    "",
+    "while",
+    "",
+    "switch",
+    "default",
+    "",
+    "double",
+    "char",
+    "break",
+    "union",
+    "",
+    "",
+    "",
+    "unsigned",
+    "",
+    "sizeof",
+    "",
+    "extern",
+    "long",
+    "const",
+    "",
+    "case",
+    "float",
+    "else",
+    "",
+    "",
+    "",
+    "signed",
+    "",
+    "goto",
+    "return",
+    "",
+    "",
+    "static",
+    "",
+    "short",
+    "",
+    "if",
+    "",
+    "enum",
+    "typedef",
+    "int",
+    "do",
+    "",
+    "",
+    "",
+    "void",
+    "",
+};
+
+static int keyword_hash_lengths[KEYWORD_HASH_SIZE] = {
+    0,
+    0,
+    3,
+    0,
+    0,
+    8,
+    0,
+    0,
+    0,
+    0,
+    0,
+    6,
+    0,
+    0,
+    0,
+    0,
+    0,
+    5,
+    0,
+    6,
+    7,
+    0,
+    6,
+    4,
+    5,
+    5,
+    0,
+    0,
+    0,
+    8,
+    0,
+    6,
+    0,
+    6,
+    4,
+    5,
+    0,
+    4,
+    5,
+    4,
+    0,
+    0,
+    0,
+    6,
+    0,
+    4,
+    6,
+    0,
+    0,
+    6,
+    0,
+    5,
+    0,
+    2,
+    0,
+    4,
+    7,
+    3,
+    2,
+    0,
+    0,
+    0,
+    4,
+    0,
+};
+
+static TokenType keyword_hash_types[KEYWORD_HASH_SIZE] = {
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_FOR,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_CONTINUE,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_STRUCT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_WHILE,
+    TK_IDENT,
+    TK_KW_SWITCH,
+    TK_KW_DEFAULT,
+    TK_IDENT,
+    TK_KW_DOUBLE,
+    TK_KW_CHAR,
+    TK_KW_BREAK,
+    TK_KW_UNION,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_UNSIGNED,
+    TK_IDENT,
+    TK_OP_SIZEOF,
+    TK_IDENT,
+    TK_KW_EXTERN,
+    TK_KW_LONG,
+    TK_KW_CONST,
+    TK_IDENT,
+    TK_KW_CASE,
+    TK_KW_FLOAT,
+    TK_KW_ELSE,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_SIGNED,
+    TK_IDENT,
+    TK_KW_GOTO,
+    TK_KW_RETURN,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_STATIC,
+    TK_IDENT,
+    TK_KW_SHORT,
+    TK_IDENT,
+    TK_KW_IF,
+    TK_IDENT,
+    TK_KW_ENUM,
+    TK_KW_TYPEDEF,
+    TK_KW_INT,
+    TK_KW_DO,
+    TK_IDENT,
+    TK_IDENT,
+    TK_IDENT,
+    TK_KW_VOID,
+    TK_IDENT,
+};
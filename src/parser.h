@@ -9,7 +9,10 @@ which is implemented here.
 #include <stdbool.h>
 #include <string.h>
 #include "tokens.h"
+#include "preprocess.h"
 #include "symbol_table.h"
+#include "type_table.h"
+#include "util/arena.h"
 
 enum OpType {
     BOP_ADD, // +
@@ -97,74 +100,123 @@ typedef enum ExprType ExprType;
 
 typedef struct ASTNode ASTNode;
 
-struct ASTNode {
-    ASTNodeType type;
-    Variable var;
-    Function func;
-    ValueLabel label;
+// Children of control flow nodes: if, loops, switch and return
+struct ASTControl {
+    ASTNode* cond;
+    ASTNode* els;
+    ASTNode* incr; // For loops
+    ASTNode* ret;
+    ValueLabel* switch_cases;
+};
 
-    ASTNode* next;
-    ASTNode* prev; // Only used for function args
-    ASTNode* body;
+typedef struct ASTControl ASTControl;
+
+// Arguments of function calls and initializer lists, ended by an AST_END node
+struct ASTArgs {
+    ASTNode* first;
+    ASTNode* end;
+    int count; // Function call arguments
+};
 
+typedef struct ASTArgs ASTArgs;
+
+// Every node has the common fields below. The children used by only some kinds of nodes
+// are grouped by kind, and allocated in the AST arena when the node first uses them.
+// The variable, function and switch case label point to entries of the symbol table.
+// Nodes which change their variable, like struct members, get their own copy of it.
+// EXPR_VAR nodes always have a variable
+struct ASTNode {
+    ASTNodeType type;
     // Expr
     ExprType expr_type;
     OpType op_type;
-    VarType cast_type;
-    ASTNode* rhs;
-    ASTNode* lhs;
+    int cast_type; // Id in the type table
     // Literal
     LiteralType literal_type;
-    char* literal;
     bool top_level_expr;
 
-    // IF, WHILE, FOR etc
-    ASTNode* cond;
-    ASTNode* els;
-    ASTNode* incr;
+    // Source location used for debug tagging, the line is looked up during codegen
+    bool debug_src_tagged;
+    int debug_src_file_id;
+    int debug_src_offset;
 
-    ValueLabel* switch_cases; // Used for switch cases
+    Variable* var; // Variables, declarations and calls returning structs, NULL if unused
+    Function* func; // Function definitions and calls, NULL if unused
+    ValueLabel* label; // Switch cases, NULL if unused
 
-    // Function
-    ASTNode* args;
-    ASTNode* args_end;
-    VarTypeEnum ret_type;
-    ASTNode* ret; // necessary?
-
-    int debug_src_line;
-    char* debug_src_line_str;
-    char* debug_src_filename_str;
+    ASTNode* next;
+    ASTNode* prev; // Only used for function args
+    ASTNode* body;
+    ASTNode* rhs;
+    ASTNode* lhs;
+    char* literal;
 
-    ASTNode* next_mem; // Linked list used for freeing memory correctly
+    ASTControl* control; // IF, WHILE, FOR, SWITCH and RETURN, NULL otherwise
+    ASTArgs* args; // Function calls and initializer lists, NULL otherwise
 };
 
 struct AST {
     ASTNode* program;
+    Arena* arena; // Nodes, their payloads and strings, freed at once by ast_free
+    int node_count;
     Function* functions; // Hashmap here as well
     Variable* variables; // Hashmap probably? Or map to integers
 };
 
 typedef struct AST AST;
 
+// Parsing state, every parse has its own context so independent ASTs can be parsed
+// without sharing state
+struct ParserContext {
+    Tokens* tokens;
+    int index; // Current token being parsed
+    TokenStream* stream; // NULL when parsing a complete Tokens object
+    VarType latest_parsed_var_type;
+    Function latest_func;
+    Object latest_struct;
+    Arena* arena; // Arena of the AST being parsed, nodes and strings are freed together
+    int nodes_allocated;
+};
+
+typedef struct ParserContext ParserContext;
+
 // =========== AST struct functionality ============
 
 // Destructor, free the memory of the AST
 void ast_free(AST* ast);
 
-// Constructor, create new AST node
-ASTNode* ast_node_new(ASTNodeType type, int count);
+// Number of nodes allocated for the AST
+int ast_node_count(AST* ast);
 
-// Destructor, free the AST node
-void ast_node_free(ASTNode* ast_node);
+// Constructor, create new AST node in the arena of the AST being parsed
+ASTNode* ast_node_new(ParserContext* ctx, ASTNodeType type, int count);
+
+// Copy a goto label name with the prefix used in the assembly, in the arena of the AST
+char* ast_goto_label(ParserContext* ctx, char* name);
 
 // Swap the memory of two nodes
 void ast_node_swap(ASTNode* node1, ASTNode* node2);
 
-// Copies node2 into node1
+// Copies node2 into node1. The variable and the child groups are shared
 void ast_node_copy(ASTNode* node1, ASTNode* node2);
 
-// Tag AST Node with debug info from the Token
-void ast_node_tag_debug(ASTNode* node, Token* token);
+// Variable of a node for changing it. The node gets its own copy in the arena of the AST,
+// so the symbol table and the nodes sharing the variable are not changed
+Variable* ast_node_var(ParserContext* ctx, ASTNode* node);
+
+// Child group of a node, allocated in the arena of the AST if the node has none yet
+ASTControl* ast_node_control(ParserContext* ctx, ASTNode* node);
+ASTArgs* ast_node_args(ParserContext* ctx, ASTNode* node);
+
+// Variable of a node for reading, a zeroed variable if the node has none.
+// Codegen reads the variable of operands which may not be variables
+Variable* ast_node_get_var(ASTNode* node);
+
+// Type of an expression node in the type table, shared between nodes and not modified
+VarType* ast_node_cast_type(ASTNode* node);
+
+// Tag AST Node with debug info from the token at token_index
+void ast_node_tag_debug(ParserContext* ctx, ASTNode* node, int token_index);
 
 // =========== Parsing ============
 // Uses recursive decending to construct the AST
@@ -172,132 +224,157 @@ void ast_node_tag_debug(ASTNode* node, Token* token);
 // Take in a list of tokens and return an Abstract Syntax Tree
 AST parse(Tokens* tokens, SymbolTable* global_symbols);
 
+// Parse tokens pulled on demand from a token stream
+AST parse_token_stream(TokenStream* stream, SymbolTable* global_symbols);
+
+// Context for parsing tokens, or the ring buffer of a token stream
+ParserContext parser_context_new(Tokens* tokens, TokenStream* stream);
+
+// Helper for the above, parse from the first token
+AST parse_start(ParserContext* ctx, SymbolTable* global_symbols);
+
 // Parse the program (file)
 // <program> ::= { <function> | <declaration> }
-void parse_program(ASTNode* node, SymbolTable* symbols);
+void parse_program(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a function definition
 // <function> ::= <type> <id> "(" <args ...> ")" <scope>
-void parse_func(ASTNode* node, SymbolTable* symbols);
+void parse_func(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a statement, continue with next statement
 // <statement> ::= <keyword> | <expression> | <declaration>
-void parse_statement(ASTNode* node, SymbolTable* symbols);
+void parse_statement(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a single statement, do not continue with next.
-void parse_single_statement(ASTNode* node, SymbolTable* symbols);
+void parse_single_statement(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse an expression, ex (a + b) + 3
-void parse_expression(ASTNode* node, SymbolTable* symbols, int min_precedence);
+void parse_expression(ParserContext* ctx, ASTNode* node, SymbolTable* symbols,
+                      int min_precedence);
 // Parse an expression atom, ex 3 or x or (...)
-void parse_expression_atom(ASTNode* node, SymbolTable* symbols);
+void parse_expression_atom(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 // Parse certain binary operators which have a higher precedence than unary operators ([], ., ->)
-void parse_high_precedence_binary_operators(ASTNode* node, SymbolTable* symbols);
+void parse_high_precedence_binary_operators(ParserContext* ctx, ASTNode* node,
+                                            SymbolTable* symbols);
 // Parse array indexing binop. This needs special handling
-void parse_binary_op_indexing(ASTNode* node, SymbolTable* symbols);
+void parse_binary_op_indexing(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 // Parse struct member access binary operator. This needs special handling
-void parse_binary_op_struct_member(ASTNode* node, SymbolTable* symbols);
+void parse_binary_op_struct_member(ParserContext* ctx, ASTNode* node,
+                                   SymbolTable* symbols);
 // Parse struct ptr member access binary operator. This needs special handling
-void parse_binary_op_struct_ptr_member(ASTNode* node, SymbolTable* symbols);
+void parse_binary_op_struct_ptr_member(ParserContext* ctx, ASTNode* node,
+                                       SymbolTable* symbols);
 // Parse a unary operator
-void parse_unary_op(ASTNode* node, SymbolTable* symbols);
+void parse_unary_op(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 // Parse a literal
-void parse_literal(ASTNode* node, SymbolTable* symbols);
+void parse_literal(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 // Used later for short circuiting
 
-void parse_global(ASTNode* node, SymbolTable* symbols);
+void parse_global(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse declaration and possible initialization of static variable
-void parse_static_declaration(ASTNode* node, SymbolTable* symbols);
+void parse_static_declaration(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse declaration and possible initialization of array variable
-void parse_array_declaration(ASTNode* node, SymbolTable* symbols);
+void parse_array_declaration(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse array initializers, etc a[5] = {1, 2, 3, 4, 5}
-void parse_array_initializer(ASTNode* node, SymbolTable* symbols);
+void parse_array_initializer(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // <function_call> ::= <identifier> "(" <expression ...> ")"
-void parse_func_call(ASTNode* node, SymbolTable* symbols);
+void parse_func_call(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a scope/block
 // <scope> ::= "{" <statement ...> "}"
-void parse_scope(ASTNode* node, SymbolTable* symbols);
+void parse_scope(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse an if conditional
 // <if> ::= "if" "(" <expression> ")" <statement>
-void parse_if(ASTNode* node, SymbolTable* symbols);
+void parse_if(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a while loop
 // <while> ::= "while" "(" <expression> ")" <statement>
-void parse_while_loop(ASTNode* node, SymbolTable* symbols);
+void parse_while_loop(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a do while loop
 // <do_while> ::= "do" <statement> "while" "(" <expression> ")"
-void parse_do_while_loop(ASTNode* node, SymbolTable* symbols);
+void parse_do_while_loop(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a for loop
 // <for> ::= "for" "(" <statement> <expression> <expression> ")" <statement>
-void parse_for_loop(ASTNode* node, SymbolTable* symbols);
+void parse_for_loop(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a switch statement
 // <switch> ::= "switch" "(" <expression> ")" (<statement> | <case> | <default_case>)
-void parse_switch(ASTNode* node, SymbolTable* symbols);
+void parse_switch(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a case statement
 // <case> ::= "case" <identifier> ":"
-void parse_case(ASTNode* node, SymbolTable* symbols);
+void parse_case(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Parse a default case statement
 // <default_case> ::= "default" ":"
-void parse_default_case(ASTNode* node, SymbolTable* symbols);
+void parse_default_case(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
-void parse_typedef(ASTNode* node, SymbolTable* symbols);
+void parse_typedef(ParserContext* ctx, ASTNode* node, SymbolTable* symbols);
 
 // Print a parse error to stderr and exit the program
-void parse_error(char* error_message);
-void parse_error_unexpected_symbol(enum TokenType expected, enum TokenType recieved);
+void parse_error(ParserContext* ctx, char* error_message);
+void parse_error_unexpected_symbol(ParserContext* ctx, enum TokenType expected,
+                                   enum TokenType recieved);
 
 // Evaluate a constant expression (literal or constant variable)
 char* evaluate_const_expression(ASTNode* node, SymbolTable* symbols);
 
 // Various helpers
 
-// Return the previous token parsed
-Token prev_token();
+// Index in parse_tokens of the token at token_index, pulled from the token stream if streaming
+int parse_token_slot(ParserContext* ctx, int token_index);
+
+// Return the type of the current token
+TokenType parse_token_type(ParserContext* ctx);
+
+// Return the type and text of the previous token parsed
+TokenType prev_token_type(ParserContext* ctx);
+char* prev_token_string(ParserContext* ctx);
+
+// Keep the tokens from token_index on in the token stream, so the parser can go back to
+// them however far it parses ahead. -1 lets the stream drop them again
+void parse_keep_tokens_from(ParserContext* ctx, int token_index);
 
-void token_go_back(int steps);
+void token_go_back(ParserContext* ctx, int steps);
 
-void set_parse_token(Token* token);
+void set_parse_token(ParserContext* ctx, int token_index);
 
 // Return true or false whether the current token matches the sent in token
-bool accept(TokenType type);
+bool accept(ParserContext* ctx, TokenType type);
 // Accept any token within this range
-bool accept_range(TokenType from_token, TokenType to_token);
+bool accept_range(ParserContext* ctx, TokenType from_token, TokenType to_token);
 // Accept a unary operator Token type
-bool accept_unop_type();
+bool accept_unop_type(ParserContext* ctx);
 // Accept postfix/suffix unary operator Token Type
-bool accept_post_unop();
+bool accept_post_unop(ParserContext* ctx);
 // Accept a binary operator Token type
-bool accept_binop_type();
+bool accept_binop_type(ParserContext* ctx);
 // Accept a variable type
-bool accept_type(SymbolTable* symbols);
+bool accept_type(ParserContext* ctx, SymbolTable* symbols);
 // Accept a typedef/struct/enum type
-bool accept_object_type(SymbolTable* symbols);
+bool accept_object_type(ParserContext* ctx, SymbolTable* symbols);
 // Accept a literal
-bool accept_literal();
+bool accept_literal(ParserContext* ctx);
 // Dereference a variable type
 VarType get_deref_var_type(VarType var_type);
 
 // Parse an enum type (and definition if there)
-void parse_enum(SymbolTable* symbols);
+void parse_enum(ParserContext* ctx, SymbolTable* symbols);
 // Parse a struct type (and definition if there)
-void parse_struct(SymbolTable* symbols);
+void parse_struct(ParserContext* ctx, SymbolTable* symbols);
 
 // Make sure the current token matches the sent in token, else
 // send an error message and exit the program
-void expect(TokenType type);
+void expect(ParserContext* ctx, TokenType type);
 // Expect a variable type
-void expect_type(SymbolTable* symbols);
+void expect_type(ParserContext* ctx, SymbolTable* symbols);
 
 // Get precedence of binary operator
 int get_binary_operator_precedence(OpType type);
@@ -306,13 +383,13 @@ bool is_binary_operation_assignment(OpType type);
 // Return whether the binary operation is of a logical type (&&, ||, > etc)
 bool is_binary_operation_logical(OpType type);
 
-// Return the wider variable type.
+// Return the wider of two type table ids.
 // char > short > int > long > float > double > long double
-VarType return_wider_type(VarType type1, VarType type2);
+int return_wider_type(int type1, int type2);
 
 // Convert a TokenType unary operator type to the corresponding prefix UnaryOpType
-OpType token_type_to_pre_uop_type(TokenType type);
+OpType token_type_to_pre_uop_type(ParserContext* ctx, TokenType type);
 // Convert a TokenType unary operator type to the corresponding postfix UnaryOpType
-OpType token_type_to_post_uop_type(TokenType type);
+OpType token_type_to_post_uop_type(ParserContext* ctx, TokenType type);
 // Convert a TokenType binary operator type to the corresponding BinaryOpType
-OpType token_type_to_bop_type(TokenType type);
\ No newline at end of file
+OpType token_type_to_bop_type(ParserContext* ctx, TokenType type);
\ No newline at end of file
@@ -0,0 +1,357 @@
+#include "pch.h"
+
+// Number of precompiled headers loaded during the whole compilation
+static int headers_loaded = 0;
+
+int pch_build(char* header_path) {
+    PreprocessorTable table = preprocessor_table_new();
+    TokenStream stream = token_stream_new(header_path, &table);
+    // Precompiled headers are built from the headers themselves, not from other .pch files
+    stream.pch_allowed = false;
+
+    // Collect the tokens first, as their count is written before them
+    Tokens tokens = tokens_new(0);
+    tokens_reserve(&tokens, TOKENS_INITIAL_CAPACITY);
+    int slot = token_stream_slot(&stream, 0);
+    while (tokens_get_type(&stream.ring, slot) != TK_EOF) {
+        tokens_push_token(&tokens, &stream.ring, slot);
+        slot = token_stream_slot(&stream, tokens.size);
+    }
+
+    PchWriter writer;
+    writer.text = vec_new(sizeof(char), 4096);
+    writer.data = vec_new(sizeof(int), 4096);
+    writer.file_dependencies = vec_new(sizeof(int), 16);
+    pch_write_dependencies(&writer);
+    pch_write_int(&writer, tokens.size);
+    for (int i = 0; i < tokens.size; i++) {
+        pch_write_token(&writer, &tokens, i);
+    }
+    pch_write_defines(&writer, table.defines);
+    pch_write_items(&writer, table.included_files);
+    pch_write_items(&writer, table.include_guards);
+
+    char* path = pch_path(header_path);
+    pch_write_file(&writer, path);
+    free(path);
+
+    int token_count = tokens.size;
+    vec_free(&writer.text);
+    vec_free(&writer.data);
+    vec_free(&writer.file_dependencies);
+    tokens_free(&tokens);
+    token_stream_free(&stream);
+    preprocessor_table_free(&table);
+    return token_count;
+}
+
+bool pch_load(char* header_path, PreprocessorTable* table, Tokens* tokens) {
+    char* path = pch_path(header_path);
+    PchReader reader;
+    reader.dependency_files = vec_new(sizeof(int), 16);
+    bool is_valid = pch_reader_open(&reader, path) && pch_read_dependencies(&reader);
+    if (is_valid) {
+        // The header is replaced by the .pch file, and the files it was built from
+        preprocessor_table_add_dependency(table, path);
+        int* dependency_files = reader.dependency_files.elems;
+        for (int i = 0; i < reader.dependency_files.size; i++) {
+            preprocessor_table_add_dependency(table, source_file_get(dependency_files[i])->path);
+        }
+        int token_count = pch_read_int(&reader);
+        tokens_reserve(tokens, tokens->size + token_count);
+        for (int i = 0; i < token_count; i++) {
+            pch_read_token(&reader, tokens);
+        }
+        pch_read_defines(&reader, table);
+        pch_read_items(&reader, table, PP_INCLUDED_FILE);
+        pch_read_items(&reader, table, PP_INCLUDE_GUARD);
+        headers_loaded++;
+    }
+    free(path);
+    vec_free(&reader.dependency_files);
+    return is_valid;
+}
+
+int pch_headers_loaded() {
+    return headers_loaded;
+}
+
+char* pch_path(char* header_path) {
+    return str_add(header_path, PCH_EXTENSION);
+}
+
+// ================ Writing ===================
+
+void pch_write_int(PchWriter* writer, int value) {
+    vec_push(&writer->data, &value);
+}
+
+void pch_write_text(PchWriter* writer, char* text, int length) {
+    if (text == NULL) {
+        pch_write_int(writer, -1);
+        pch_write_int(writer, -1);
+        return;
+    }
+    // Texts are null terminated in the file, so they can be interned directly
+    int offset = writer->text.size;
+    for (int i = 0; i < length; i++) {
+        vec_push(&writer->text, &text[i]);
+    }
+    char terminator = '\0';
+    vec_push(&writer->text, &terminator);
+    pch_write_int(writer, offset);
+    pch_write_int(writer, length);
+}
+
+void pch_write_token(PchWriter* writer, Tokens* tokens, int i) {
+    TokenType type = tokens_get_type(tokens, i);
+    TokenSpan* span = tokens_get_span(tokens, i);
+    int* file_dependencies = writer->file_dependencies.elems;
+    int dependency = -1;
+    if (span->file_id < writer->file_dependencies.size) {
+        dependency = file_dependencies[span->file_id];
+    }
+    pch_write_int(writer, type);
+    pch_write_int(writer, dependency);
+    pch_write_int(writer, span->offset);
+    pch_write_int(writer, span->length);
+    // Texts which have been materialized are written as they are. Other texts are
+    // materialized from the source files when needed, like for tokens which were just read
+    char** texts = tokens->texts.elems;
+    char* text = texts[i];
+    if (text == NULL && dependency < 0 && token_type_spelling(type) == NULL) {
+        text = tokens_get_string(tokens, i);
+    }
+    if (text == NULL) {
+        pch_write_text(writer, NULL, 0);
+    }
+    else {
+        pch_write_text(writer, text, strlen(text));
+    }
+}
+
+void pch_write_dependencies(PchWriter* writer) {
+    // Every file opened while building the header, which is checked before loading it.
+    // Token spans refer to the dependencies, so tokens keep their source lines
+    int count = source_file_count();
+    int dependency_count = 0;
+    for (int i = 0; i < count; i++) {
+        int dependency = -1;
+        if (source_file_get(i)->path != NULL) {
+            dependency = dependency_count;
+            dependency_count++;
+        }
+        vec_push(&writer->file_dependencies, &dependency);
+    }
+    pch_write_int(writer, dependency_count);
+    for (int i = 0; i < count; i++) {
+        SourceFile* file = source_file_get(i);
+        if (file->path != NULL) {
+            pch_write_text(writer, file->path, strlen(file->path));
+            if (file->filename == NULL) {
+                pch_write_text(writer, NULL, 0);
+            }
+            else {
+                pch_write_text(writer, file->filename, strlen(file->filename));
+            }
+            pch_write_int(writer, file->size);
+            pch_write_int(writer, intern_hash(file->src, file->size));
+        }
+    }
+}
+
+void pch_write_defines(PchWriter* writer, PreprocessorMap* map) {
+    int count = 0;
+    for (int i = 0; i < map->capacity; i++) {
+        if (map->items[i].name != NULL && !map->items[i].ignore) {
+            count++;
+        }
+    }
+    pch_write_int(writer, count);
+    for (int i = 0; i < map->capacity; i++) {
+        PreprocessorItem* item = &map->items[i];
+        if (item->name != NULL && !item->ignore) {
+            pch_write_text(writer, item->name, strlen(item->name));
+            pch_write_int(writer, item->define_value_tokens.size);
+            for (int j = 0; j < item->define_value_tokens.size; j++) {
+                pch_write_token(writer, &item->define_value_tokens, j);
+            }
+            pch_write_int(writer, item->is_function_like);
+            if (item->is_function_like) {
+                pch_write_int(writer, item->is_variadic);
+                pch_write_int(writer, item->param_count);
+                int* refs = item->define_param_refs.elems;
+                for (int j = 0; j < item->define_value_tokens.size; j++) {
+                    pch_write_int(writer, refs[j]);
+                }
+            }
+        }
+    }
+}
+
+void pch_write_items(PchWriter* writer, PreprocessorMap* map) {
+    // Included files and include guards are never removed, so every used slot is written
+    pch_write_int(writer, map->size);
+    for (int i = 0; i < map->capacity; i++) {
+        PreprocessorItem* item = &map->items[i];
+        if (item->name != NULL) {
+            pch_write_text(writer, item->name, strlen(item->name));
+            pch_write_int(writer, item->include_file_only_once);
+            if (item->type == PP_INCLUDE_GUARD) {
+                pch_write_text(writer, item->value, strlen(item->value));
+            }
+            else {
+                pch_write_text(writer, NULL, 0);
+            }
+        }
+    }
+}
+
+void pch_write_file(PchWriter* writer, char* path) {
+    // Pad the text so the numbers after it are aligned
+    char padding = '\0';
+    while (writer->text.size % 4 != 0) {
+        vec_push(&writer->text, &padding);
+    }
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        perror(path);
+        exit(-1);
+    }
+    int header[3];
+    header[0] = PCH_MAGIC;
+    header[1] = PCH_VERSION;
+    header[2] = writer->text.size;
+    fwrite(header, sizeof(int), 3, file);
+    fwrite(writer->text.elems, 1, writer->text.size, file);
+    fwrite(writer->data.elems, sizeof(int), writer->data.size, file);
+    fclose(file);
+}
+
+// ================ Reading ===================
+
+bool pch_reader_open(PchReader* reader, char* path) {
+    // The file is mapped as a source file, which exits if it does not exist
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    fclose(file);
+    reader->file_id = source_file_open(path, false);
+    SourceFile* source_file = source_file_get(reader->file_id);
+    reader->src = source_file->src;
+    reader->size = source_file->size;
+    if (reader->size < PCH_HEADER_SIZE) {
+        return false;
+    }
+    int* header = (int*)reader->src;
+    if (header[0] != PCH_MAGIC || header[1] != PCH_VERSION) {
+        return false;
+    }
+    int text_size = header[2];
+    reader->text = reader->src + PCH_HEADER_SIZE;
+    reader->data = (int*)(reader->text + text_size);
+    reader->data_size = (reader->size - PCH_HEADER_SIZE - text_size) / 4;
+    reader->pos = 0;
+    return true;
+}
+
+int pch_read_int(PchReader* reader) {
+    if (reader->pos >= reader->data_size) {
+        fprintf(stderr, "Error: Precompiled header ends unexpectedly\n");
+        exit(-1);
+    }
+    int value = reader->data[reader->pos];
+    reader->pos++;
+    return value;
+}
+
+char* pch_read_text(PchReader* reader) {
+    int offset = pch_read_int(reader);
+    pch_read_int(reader);
+    if (offset < 0) {
+        return NULL;
+    }
+    return intern_str(reader->text + offset);
+}
+
+void pch_read_token(PchReader* reader, Tokens* tokens) {
+    TokenType type = pch_read_int(reader);
+    int dependency = pch_read_int(reader);
+    TokenSpan span;
+    span.file_id = reader->file_id;
+    span.offset = pch_read_int(reader);
+    span.length = pch_read_int(reader);
+    if (dependency >= 0) {
+        int* dependency_files = reader->dependency_files.elems;
+        span.file_id = dependency_files[dependency];
+    }
+    int i = tokens_push(tokens, type, span);
+    char* text = pch_read_text(reader);
+    if (text != NULL) {
+        char** texts = tokens->texts.elems;
+        texts[i] = text;
+    }
+}
+
+bool pch_read_dependencies(PchReader* reader) {
+    int count = pch_read_int(reader);
+    for (int i = 0; i < count; i++) {
+        char* path = pch_read_text(reader);
+        char* filename = pch_read_text(reader);
+        int size = pch_read_int(reader);
+        int hash = pch_read_int(reader);
+        FILE* file = fopen(path, "rb");
+        if (file == NULL) {
+            return false;
+        }
+        fclose(file);
+        int file_id = source_file_open(path, true);
+        SourceFile* source_file = source_file_get(file_id);
+        if (source_file->size != size || intern_hash(source_file->src, size) != hash) {
+            return false;
+        }
+        if (source_file->filename == NULL) {
+            source_file->filename = filename;
+        }
+        vec_push(&reader->dependency_files, &file_id);
+    }
+    return true;
+}
+
+void pch_read_defines(PchReader* reader, PreprocessorTable* table) {
+    int count = pch_read_int(reader);
+    for (int i = 0; i < count; i++) {
+        char* name = pch_read_text(reader);
+        int token_count = pch_read_int(reader);
+        PreprocessorItem item = preprocessor_define_new(name, tokens_new(0));
+        tokens_reserve(&item.define_value_tokens, token_count + 1);
+        for (int j = 0; j < token_count; j++) {
+            pch_read_token(reader, &item.define_value_tokens);
+        }
+        item.is_function_like = pch_read_int(reader);
+        if (item.is_function_like) {
+            item.is_variadic = pch_read_int(reader);
+            item.param_count = pch_read_int(reader);
+            vec_free(&item.define_param_refs);
+            item.define_param_refs = vec_new(sizeof(int), token_count + 1);
+            for (int j = 0; j < token_count; j++) {
+                int param = pch_read_int(reader);
+                vec_push(&item.define_param_refs, &param);
+            }
+        }
+        preprocessor_table_insert(table, item);
+    }
+}
+
+void pch_read_items(PchReader* reader, PreprocessorTable* table, PreprocessorItemType type) {
+    int count = pch_read_int(reader);
+    for (int i = 0; i < count; i++) {
+        PreprocessorItem item;
+        item.type = type;
+        item.name = pch_read_text(reader);
+        item.include_file_only_once = pch_read_int(reader);
+        item.value = pch_read_text(reader);
+        preprocessor_table_insert(table, item);
+    }
+}
@@ -0,0 +1,93 @@
+// Precompiled headers
+// A header which is included first by a source file can be precompiled into a .pch
+// file next to it. The file holds the preprocessed tokens of the header and the
+// preprocessor table state after it, so later compiles do not have to tokenize and
+// preprocess the header and the files it includes again.
+// The .pch file is mapped, and the loaded tokens refer to the source files the header
+// was built from, which have to be unchanged for the .pch file to be used.
+// Only the preprocessor output is stored. The global declarations and symbols of the
+// header are not, so the parser parses the loaded tokens like any other tokens.
+
+// Layout, every number is an int:
+//      magic, version, text size, text (padded to a multiple of 4 bytes)
+//      dependency count, (path, filename, size, hash) for every file the header was built from
+//      token count, (type, dependency, span offset, span length, text) for every token
+//      define count, (name, value token count, value tokens, is function-like) for every define,
+//          followed by (is variadic, parameter count, parameter of every value token)
+//          for function-like defines
+//      included file count, (name, include_file_only_once) for every included file
+//      include guard count, (path, guard define) for every include guard
+// Texts are stored as an offset into the text and a length, -1 for no text.
+// Tokens only have a text if it was materialized before the header was written
+
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/vector.h"
+#include "util/intern.h"
+#include "tokens.h"
+#include "preprocess.h"
+
+#define PCH_MAGIC 1212367683
+#define PCH_VERSION 2
+#define PCH_EXTENSION ".pch"
+// Size of the magic, version and text size fields before the text
+#define PCH_HEADER_SIZE 12
+
+// Accumulates the text and numbers of a .pch file while it is built
+struct PchWriter {
+    Vec text; // char vec
+    Vec data; // int vec
+    Vec file_dependencies; // int vec, dependency index of every source file, -1 if none
+};
+
+typedef struct PchWriter PchWriter;
+
+// Reads the numbers of a mapped .pch file in order
+struct PchReader {
+    char* src;
+    int size;
+    int file_id; // Source file of the mapping, the span of tokens without a source file
+    char* text;
+    int* data;
+    int data_size; // Number of ints after the text
+    int pos;
+    Vec dependency_files; // int vec, source file id of every dependency
+};
+
+typedef struct PchReader PchReader;
+
+// Preprocess a header as the first file and write the result to the header path + ".pch".
+// Returns the number of tokens written
+int pch_build(char* header_path);
+
+// Load the precompiled header of the header at header_path into tokens, and add the
+// preprocessor items of the header to the table. Returns false if there is no .pch file
+// or if it is out of date, in which case the header has to be preprocessed normally
+bool pch_load(char* header_path, PreprocessorTable* table, Tokens* tokens);
+
+// Number of precompiled headers loaded during the whole compilation
+int pch_headers_loaded();
+
+// Path of the .pch file of a header, the returned string is owned by the caller
+char* pch_path(char* header_path);
+
+// Helpers for pch_build
+void pch_write_int(PchWriter* writer, int value);
+void pch_write_text(PchWriter* writer, char* text, int length);
+void pch_write_token(PchWriter* writer, Tokens* tokens, int i);
+void pch_write_dependencies(PchWriter* writer);
+void pch_write_defines(PchWriter* writer, PreprocessorMap* map);
+void pch_write_items(PchWriter* writer, PreprocessorMap* map);
+void pch_write_file(PchWriter* writer, char* path);
+
+// Helpers for pch_load
+bool pch_reader_open(PchReader* reader, char* path);
+int pch_read_int(PchReader* reader);
+char* pch_read_text(PchReader* reader);
+void pch_read_token(PchReader* reader, Tokens* tokens);
+bool pch_read_dependencies(PchReader* reader);
+void pch_read_defines(PchReader* reader, PreprocessorTable* table);
+void pch_read_items(PchReader* reader, PreprocessorTable* table, PreprocessorItemType type);
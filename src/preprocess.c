@@ -1,90 +1,73 @@
 #include "preprocess.h"
+#include "pch.h"
+#include "token_cache.h"
 
 Tokens preprocess_first(char* filename, PreprocessorTable* table) {
-    Tokens tokens = preprocess(filename, table, false);
-    tokens_trim(&tokens);
-    return tokens;
+    // The whole file is collected from the same token stream the parser pulls from
+    Tokens output = tokens_new(0);
+    tokens_reserve(&output, TOKENS_INITIAL_CAPACITY);
+    TokenStream stream = token_stream_new(filename, table);
+    token_stream_drain(&stream, &output);
+    token_stream_free(&stream);
+    return output;
 }
 
-Tokens preprocess(char* filename, PreprocessorTable* table, bool is_stl_file) {
-    char* filename_with_dir;
-    if (!is_stl_file) { // Normal file
-        filename_with_dir = str_add(table->current_file_dir, filename);
-    }
-    else { // STL file, stored under libc/
-        filename_with_dir = str_add("libc/", filename);
-    }
-    table->current_file = filename_with_dir;
-    char* src = load_file_to_string(filename_with_dir);
-    preprocessor_table_update_current_dir(table, filename);
-
-    Tokens tokens = tokenize(src, true);
-    tokens_tag_src_filename(&tokens, filename);
-
-    preprocess_tokens(&tokens, table);
-
-    free(src);
-    free(table->current_file_dir);
-    free(filename_with_dir);
-    return tokens;
+void preprocess_tokens(Tokens* tokens, PreprocessorTable* table, Tokens* output) {
+    TokenStream stream = token_stream_new_tokens(tokens, table);
+    token_stream_drain(&stream, output);
+    // Remove the EOF token which ended the tokens
+    tokens_pop(output);
+    token_stream_free(&stream);
 }
 
-Tokens preprocess_tokens(Tokens* tokens, PreprocessorTable* table) {
-    for (size_t i = 0; i < tokens->size; i++) {
-        table->token_index = i;
-        preprocess_token(tokens, table);
-        i = table->token_index;
+// Number of files opened and includes skipped during the whole compilation
+static int files_opened = 0;
+static int guarded_includes_skipped = 0;
+
+char* preprocess_file_path(char* filename, PreprocessorTable* table, bool is_stl_file) {
+    if (is_stl_file) { // STL file, stored under libc/
+        return str_add("libc/", filename);
     }
-    return *tokens;
+    return str_add(table->current_file_dir, filename);
 }
 
-void preprocess_token(Tokens* tokens, PreprocessorTable* table) {
-    Token* token = tokens_get(tokens, table->token_index);
-    if (token->type == TK_PREPROCESSOR) {
-        if (str_startswith(token->string_repr, "#include")) {
-            preprocess_include(tokens, table);
-        }
-        else if (str_startswith(token->string_repr, "#define")) {
-            preprocess_define(tokens, table);
-        }
-        else if (str_startswith(token->string_repr, "#pragma once")) {
-            PreprocessorItem* cur_file = preprocessor_table_get_current_file(table);
-            PreprocessorItem cur_file_no_path;
-            cur_file_no_path.name = isolate_file_from_path(cur_file->name);
-            cur_file_no_path.type = PP_INCLUDED_FILE;
-            cur_file_no_path.include_file_only_once = true;
+void preprocess_directive(Tokens* tokens, PreprocessorTable* table) {
+    char* directive = tokens_get_string(tokens, table->token_index);
+    if (str_startswith(directive, "#define")) {
+        preprocess_define(tokens, table);
+    }
+    else if (str_startswith(directive, "#pragma once")) {
+        PreprocessorItem* cur_file = preprocessor_table_get_current_file(table);
+        PreprocessorItem cur_file_no_path;
+        char* file_no_path_str = isolate_file_from_path(table->current_file);
+        cur_file_no_path.name = intern_str(file_no_path_str);
+        free(file_no_path_str);
+        cur_file_no_path.type = PP_INCLUDED_FILE;
+        cur_file_no_path.include_file_only_once = true;
+        if (cur_file != NULL) {
             cur_file->include_file_only_once = true;
-            preprocessor_table_insert(table, cur_file_no_path);
-        }
-        else if (str_startswith(token->string_repr, "#ifdef")) {
-            preprocess_ifdef(tokens, table);
-        }
-        else if (str_startswith(token->string_repr, "#ifndef")) {
-            preprocess_ifndef(tokens, table);
-        }
-        else if (str_startswith(token->string_repr, "#undef")) {
-            preprocess_undef(tokens, table);
-        }
-        else {
-            preprocess_error("Unknown preprocess directive encountered", table);
         }
+        preprocessor_table_insert(table, cur_file_no_path);
+    }
+    else if (str_startswith(directive, "#undef")) {
+        preprocess_undef(tokens, table);
     }
-    else if (token->type == TK_IDENT) {
-        preprocess_ident(tokens, table);
+    else {
+        preprocess_error("Unknown preprocess directive encountered", table);
     }
 }
 
-void preprocess_include(Tokens* tokens, PreprocessorTable* table) {
-    Token* token = tokens_get(tokens, table->token_index);
+char* preprocess_include_file(Tokens* tokens, PreprocessorTable* table, bool* is_stl_file) {
     // Isolate the include filename
-    StrVector str_vec = str_split_on_whitespace(token->string_repr);
+    char* directive = tokens_get_string(tokens, table->token_index);
+    StrVector str_vec = str_split_on_whitespace(directive);
     char* file_str = str_vec.elems[1];
-    bool is_stl_file = false;
+    *is_stl_file = false;
     if (file_str[0] == '\"') { // We do not support STL yet
-        is_stl_file = false;
+        *is_stl_file = false;
     }
     else if (file_str[0] == '<') {
-        is_stl_file = true;
+        *is_stl_file = true;
     }
     else {
         preprocess_error("Incorrectly formatted include encountered!", table);
@@ -92,21 +75,18 @@ void preprocess_include(Tokens* tokens, PreprocessorTable* table) {
 
     file_str[0] = ' ';
     file_str[strlen(file_str) - 1] = ' ';
-    file_str = str_strip(file_str);
+    char* stripped_file_str = str_strip(file_str);
+    file_str = intern_str(stripped_file_str);
+    free(stripped_file_str);
+    str_vec_free(&str_vec);
 
     // If file already is in table and has pragma once, skip
-    char* file_no_path_str = isolate_file_from_path(file_str);
-    PreprocessorItem* item = preprocessor_table_lookup(table, file_no_path_str);
-    /*if (item) {
-        printf("item %s: include only once: %d, %d\n", item->name,
-               item->include_file_only_once, item && item->include_file_only_once);
-    }*/
+    char* isolated_file_str = isolate_file_from_path(file_str);
+    char* file_no_path_str = intern_str(isolated_file_str);
+    free(isolated_file_str);
+    PreprocessorItem* item = preprocessor_table_lookup_file(table, file_no_path_str);
     if (item && item->include_file_only_once) {
-        //printf("Skipping include!\n");
-        str_vec_free(&str_vec);
-        free(file_str);
-        free(file_no_path_str);
-        return;
+        return NULL;
     }
     // Add it to the preprocessor table
     PreprocessorItem file_item;
@@ -117,197 +97,891 @@ void preprocess_include(Tokens* tokens, PreprocessorTable* table) {
     preprocessor_table_insert(table, file_item);
 
     // Consumed this token, set it to none
-    token->type = TK_NONE;
-
-    // Send the include file into the preprocessor
-    PreprocessorTable next_table = *table;
-    next_table.current_file_index = next_table.elems->size - 1;
-
-    Tokens file_tokens = preprocess(file_str, &next_table, is_stl_file);
-    tokens_trim(&file_tokens);
-    // Remove the EOF token
-    Token* last_token = vec_peek(&file_tokens.elems);
-    last_token->type = TK_NONE;
-    // Insert the include file tokens at the preprocessor token location
-    tokens = tokens_insert(tokens, &file_tokens, table->token_index);
-    // Free used memory
-    str_vec_free(&str_vec);
-    free(file_no_path_str);
-    vec_free(&file_tokens.elems);
-    table->token_index += file_tokens.size;
+    tokens_set_type(tokens, table->token_index, TK_NONE);
+    return file_str;
 }
 
 void preprocess_define(Tokens* tokens, PreprocessorTable* table) {
-    Token* token = tokens_get(tokens, table->token_index);
+    int index = table->token_index;
+    char* directive = tokens_get_string(tokens, index);
+    // Defines with parameters have a ( right after the name
+    char* directive_end = directive + strlen(directive);
+    char* name_start = scan_skip_blanks(directive + 7, directive_end);
+    char* name_end = scan_ident_end(name_start, directive_end);
+    if (*name_end == '(') {
+        char* name = str_substr(name_start, name_end - name_start);
+        preprocess_define_function(tokens, table, intern_str(name), name_end + 1);
+        free(name);
+        return;
+    }
+
     // Isolate everything after define
-    StrVector str_vec = str_split_on_whitespace(token->string_repr);
-    char* define_ident = str_copy(str_vec.elems[1]);
+    StrVector str_vec = str_split_on_whitespace(directive);
+    char* define_ident = intern_str(str_vec.elems[1]);
     StrVector str_vec_value = str_vec_slice(&str_vec, 2, str_vec.size);
     char* define_value = str_vec_join_with_delim(&str_vec_value, ' ');
 
-    Tokens define_value_tokens;
-    if (str_vec_value.size > 0) { // Define has a replace value we should use
-        define_value_tokens = tokenize(define_value, false);
-    }
-    else { // This is an empty define, if used should produce no token
-        define_value_tokens = tokens_new(1);
-    }
-
-    // Remove the EOF token
-    Token* last_token = vec_peek(&define_value_tokens.elems);
-    last_token->type = TK_NONE;
-    tokens_trim(&define_value_tokens);
-    preprocess_tokens(&define_value_tokens, table);
+    // An empty define produces no tokens when it is used. The value is kept unexpanded,
+    // as it is rescanned for defines together with the tokens after each use
+    Tokens define_value_tokens = tokenize_define_value(define_value);
 
     // Consume this token, set it to none
-    token->type = TK_NONE;
-
-    // If file already is in table, override
-    PreprocessorItem* item = preprocessor_table_lookup(table, define_value);
-    if (item) {
-        // Just overwrite with the new value tokens
-        vec_free(&item->define_value_tokens.elems);
-        item->define_value_tokens = define_value_tokens;
-        return;
-    }
-    // Add it to the preprocessor table
-    PreprocessorItem define_item;
-    define_item.type = PP_DEFINE;
-    define_item.name = define_ident;
-    define_item.define_value_tokens = define_value_tokens;
-    preprocessor_table_insert(table, define_item);
+    tokens_set_type(tokens, index, TK_NONE);
+
+    // Add it to the preprocessor table, this overrides an earlier define with the same name
+    PreprocessorItem item = preprocessor_define_new(define_ident, define_value_tokens);
+    preprocessor_table_insert(table, item);
 
     str_vec_free(&str_vec);
     free(define_value);
 }
 
+void preprocess_define_function(Tokens* tokens, PreprocessorTable* table, char* name,
+                                char* params_start) {
+    char* params_end = params_start;
+    while (*params_end != ')') {
+        if (*params_end == '\0') {
+            preprocess_error("#define parameters have no closing parenthesis!", table);
+        }
+        params_end++;
+    }
+    // The value is kept unexpanded, as the arguments are only known when it is used
+    PreprocessorItem item = preprocessor_define_new(name, tokenize_define_value(params_end + 1));
+    item.is_function_like = true;
+
+    // Parameters are identifiers separated by commas, with ... for __VA_ARGS__ last
+    char* params_str = str_substr(params_start, params_end - params_start);
+    Tokens param_tokens = tokenize_define_value(params_str);
+    StrVector param_names = str_vec_new(4);
+    for (int i = 0; i < param_tokens.size; i++) {
+        TokenType type = tokens_get_type(&param_tokens, i);
+        if (type == TK_IDENT && !item.is_variadic) {
+            str_vec_push_no_copy(&param_names, tokens_get_string(&param_tokens, i));
+        }
+        else if (type == TK_KW_VARIADIC_DOTS && !item.is_variadic) {
+            str_vec_push_no_copy(&param_names, intern_str("__VA_ARGS__"));
+            item.is_variadic = true;
+        }
+        else if (type != TK_DL_COMMA) {
+            preprocess_error("Invalid parameter in #define!", table);
+        }
+    }
+    item.param_count = param_names.size;
+
+    // Find the parameter of every value token once, instead of on every use
+    Tokens* value = &item.define_value_tokens;
+    vec_free(&item.define_param_refs);
+    item.define_param_refs = vec_new(sizeof(int), value->size + 1);
+    for (int i = 0; i < value->size; i++) {
+        int param = -1;
+        if (tokens_get_type(value, i) == TK_IDENT) {
+            char* ident = tokens_get_string(value, i);
+            for (int j = 0; j < param_names.size; j++) {
+                if (param_names.elems[j] == ident) {
+                    param = j;
+                }
+            }
+        }
+        vec_push(&item.define_param_refs, &param);
+    }
+    int* refs = item.define_param_refs.elems;
+    for (int i = 0; i < value->size; i++) {
+        TokenType type = tokens_get_type(value, i);
+        if (type == TK_PP_HASH && (i + 1 == value->size || refs[i + 1] < 0)) {
+            preprocess_error("# in #define is not followed by a parameter!", table);
+        }
+        if (type == TK_PP_HASHHASH && (i == 0 || i + 1 == value->size)) {
+            preprocess_error("## in #define is at the start or end of the value!", table);
+        }
+    }
+
+    tokens_set_type(tokens, table->token_index, TK_NONE);
+    preprocessor_table_insert(table, item);
+    // The names are interned, so only the vector is freed
+    free(param_names.elems);
+    tokens_free(&param_tokens);
+    free(params_str);
+}
+
 // Preprocess #undef directive (undefine)
 void preprocess_undef(Tokens* tokens, PreprocessorTable* table) {
     // Remove item from preprocessor table
-    Token* token = tokens_get(tokens, table->token_index);
     // Isolate everything after define
-    StrVector str_vec = str_split_on_whitespace(token->string_repr);
-    char* define_ident = str_copy(str_vec.elems[1]);
+    char* directive = tokens_get_string(tokens, table->token_index);
+    StrVector str_vec = str_split_on_whitespace(directive);
+    char* define_ident = intern_str(str_vec.elems[1]);
 
     preprocessor_table_remove(table, define_ident);
 
     // Consume this token, set it to none
-    token->type = TK_NONE;
+    tokens_set_type(tokens, table->token_index, TK_NONE);
 
     str_vec_free(&str_vec);
-    free(define_ident);
 }
 
-void preprocess_ident(Tokens* tokens, PreprocessorTable* table) {
-    // Replace identifiers which are defines with the define tokens
-    Token* token = tokens_get(tokens, table->token_index);
-    PreprocessorItem* item = preprocessor_table_lookup(table, token->string_repr);
-    if (item == NULL) {
-        return;
+// ================ Function-like defines ===================
+
+int preprocess_macro_next(Tokens* tokens, int i, Tokenizer* tokenizer) {
+    while (true) {
+        if (i >= tokens->size) {
+            if (tokenizer == NULL) {
+                return i;
+            }
+            // The use continues on the next line of the file
+            tokenize_next_line(tokenizer);
+            continue;
+        }
+        TokenType type = tokens_get_type(tokens, i);
+        if (type != TK_COMMENT && type != TK_NONE) {
+            return i;
+        }
+        i++;
     }
-    // This is a define identifier, replace with define tokens
+}
 
-    // Consume this token, set it to none
-    token->type = TK_NONE;
-    Tokens insert_tokens = tokens_copy(&item->define_value_tokens);
-    tokens = tokens_insert(tokens, &insert_tokens, table->token_index);
-    free(insert_tokens.elems.elems);
-    table->token_index += item->define_value_tokens.size;
-}
-
-// Preprocess #ifdef directives
-void preprocess_ifdef(Tokens* tokens, PreprocessorTable* table) {
-    Token* token = tokens_get(tokens, table->token_index);
-    // Isolate #ifdef identifier
-    StrVector str_vec = str_split_on_whitespace(token->string_repr);
-    if (str_vec.size < 2) {
-        preprocess_error("#ifdef directive has no identifier!", table);
+int preprocess_macro_args(Tokens* tokens, int start, Tokenizer* tokenizer, PreprocessorItem* item,
+                          Vec* args, PreprocessorTable* table) {
+    int i = preprocess_macro_next(tokens, start, tokenizer);
+    if (i >= tokens->size || tokens_get_type(tokens, i) != TK_DL_OPENPAREN) {
+        return -1;
+    }
+    Tokens arg = tokens_new(0);
+    tokens_reserve(&arg, 8);
+    int depth = 0;
+    i++;
+    while (true) {
+        i = preprocess_macro_next(tokens, i, tokenizer);
+        if (i >= tokens->size || tokens_get_type(tokens, i) == TK_EOF ||
+            tokens_get_type(tokens, i) == TK_PREPROCESSOR) {
+            preprocess_error("Arguments of a define have no closing parenthesis!", table);
+        }
+        TokenType type = tokens_get_type(tokens, i);
+        if (type == TK_DL_CLOSEPAREN && depth == 0) {
+            break;
+        }
+        // Commas inside parens, or in the __VA_ARGS__ argument, do not separate arguments
+        bool is_va_args = item->is_variadic && args->size == item->param_count - 1;
+        if (type == TK_DL_COMMA && depth == 0 && !is_va_args) {
+            vec_push(args, &arg);
+            arg = tokens_new(0);
+            tokens_reserve(&arg, 8);
+            i++;
+            continue;
+        }
+        if (type == TK_DL_OPENPAREN) {
+            depth++;
+        }
+        else if (type == TK_DL_CLOSEPAREN) {
+            depth--;
+        }
+        tokens_push_token(&arg, tokens, i);
+        i++;
+    }
+    vec_push(args, &arg);
+    // F() is one empty argument, which means no arguments for a define without parameters
+    if (item->param_count == 0 && args->size == 1 && arg.size == 0) {
+        tokens_free(vec_pop(args));
+    }
+    // The __VA_ARGS__ argument can be left out
+    if (item->is_variadic && args->size == item->param_count - 1) {
+        Tokens va_args = tokens_new(0);
+        vec_push(args, &va_args);
+    }
+    if (args->size != item->param_count) {
+        preprocess_error("Wrong number of arguments for a define!", table);
     }
-    char* define_ident = str_copy(str_vec.elems[1]);
-    int endif_offset = preprocess_scan_for_endif(token, table);
-    if (preprocessor_table_lookup(table, define_ident)) { // Value defined, use code
-        // Consume this token, set it to none
-        token->type = TK_NONE;
+    return i + 1;
+}
+
+void preprocess_macro_expand(PreprocessorItem* item, Vec* args, PreprocessorTable* table,
+                             Tokens* output) {
+    Tokens* value = &item->define_value_tokens;
+    int* refs = item->define_param_refs.elems;
+    Tokens* raw_args = args->elems;
+    // Arguments are fully expanded the first time they are used outside of # and ##
+    Tokens* expanded_args = malloc(sizeof(Tokens) * (item->param_count + 1));
+    bool* is_expanded = calloc(item->param_count + 1, sizeof(bool));
+    bool is_paste = false; // The previous value token was ##
+    bool has_left = false; // The operand before ## produced tokens
+    for (int i = 0; i < value->size; i++) {
+        TokenType type = tokens_get_type(value, i);
+        if (type == TK_PP_HASHHASH) {
+            is_paste = true;
+            continue;
+        }
+        int operand_start = output->size;
+        int param = refs[i];
+        if (type == TK_PP_HASH) {
+            // The parameter after # is replaced by its argument as a string
+            i++;
+            char* str = preprocess_macro_stringify(&raw_args[refs[i]]);
+            int str_index = tokens_push(output, TK_LSTRING, *tokens_get_span(value, i - 1));
+            tokens_set_string(output, str_index, str);
+            free(str);
+        }
+        else if (param >= 0) {
+            // Operands of ## use the argument as written
+            bool is_paste_operand = is_paste || (i + 1 < value->size &&
+                                                 tokens_get_type(value, i + 1) == TK_PP_HASHHASH);
+            Tokens* arg = &raw_args[param];
+            if (!is_paste_operand) {
+                if (!is_expanded[param]) {
+                    expanded_args[param] = tokens_new(0);
+                    tokens_reserve(&expanded_args[param], arg->size + 1);
+                    preprocess_tokens(arg, table, &expanded_args[param]);
+                    is_expanded[param] = true;
+                }
+                arg = &expanded_args[param];
+            }
+            bool is_va_args = item->is_variadic && param == item->param_count - 1;
+            if (is_paste && is_va_args && has_left &&
+                tokens_get_type(output, output->size - 1) == TK_DL_COMMA) {
+                // , ## __VA_ARGS__ removes the comma if there are no variadic arguments
+                if (arg->size == 0) {
+                    tokens_pop(output);
+                }
+                is_paste = false;
+            }
+            for (int j = 0; j < arg->size; j++) {
+                tokens_push_token(output, arg, j);
+            }
+        }
+        else {
+            tokens_push_token(output, value, i);
+        }
 
-        // Consume matching #endif
-        token += endif_offset;
-        token->type = TK_NONE;
+        bool has_operand = output->size > operand_start;
+        if (is_paste && has_left && has_operand) {
+            preprocess_macro_paste(output, operand_start);
+        }
+        // An empty operand of ## is a placeholder, so the left operand is kept for the next ##
+        has_left = has_operand || (is_paste && has_left);
+        is_paste = false;
     }
-    else { // Value not defined, cut out the tokens by setting them to none
-        Token* end_token = token + endif_offset;
-        while (token <= end_token) {
-            token->type = TK_NONE;
-            token++;
+    for (int i = 0; i < item->param_count; i++) {
+        if (is_expanded[i]) {
+            tokens_free(&expanded_args[i]);
         }
     }
+    free(expanded_args);
+    free(is_expanded);
+}
 
-    str_vec_free(&str_vec);
-    free(define_ident);
+char* preprocess_macro_stringify(Tokens* arg) {
+    Vec str = vec_new(sizeof(char), 64);
+    for (int i = 0; i < arg->size; i++) {
+        TokenSpan* span = tokens_get_span(arg, i);
+        // Whitespace between the tokens becomes a single space
+        if (i > 0) {
+            TokenSpan* prev_span = tokens_get_span(arg, i - 1);
+            if (span->file_id != prev_span->file_id ||
+                span->offset > prev_span->offset + prev_span->length) {
+                char space = ' ';
+                vec_push(&str, &space);
+            }
+        }
+        TokenType type = tokens_get_type(arg, i);
+        char* text = tokens_get_string(arg, i);
+        char quote = '\0';
+        if (type == TK_LSTRING) {
+            quote = '"';
+        }
+        else if (type == TK_LCHAR) {
+            quote = '\'';
+        }
+        if (quote == '\0') {
+            for (int j = 0; text[j] != '\0'; j++) {
+                vec_push(&str, &text[j]);
+            }
+            continue;
+        }
+        // Quotes and backslashes of literals are escaped in the string
+        char backslash = '\\';
+        if (quote == '"') {
+            vec_push(&str, &backslash);
+        }
+        vec_push(&str, &quote);
+        for (int j = 0; text[j] != '\0'; j++) {
+            if (text[j] == '"' || text[j] == '\\') {
+                vec_push(&str, &backslash);
+            }
+            vec_push(&str, &text[j]);
+        }
+        if (quote == '"') {
+            vec_push(&str, &backslash);
+        }
+        vec_push(&str, &quote);
+    }
+    char terminator = '\0';
+    vec_push(&str, &terminator);
+    return str.elems;
+}
+
+void preprocess_macro_paste(Tokens* output, int i) {
+    // Tokenize the joined text of the tokens on both sides of ##, and replace them
+    char* text = str_add(tokens_get_string(output, i - 1), tokens_get_string(output, i));
+    Tokens pasted = tokenize_define_value(text);
+    Tokens rest = tokens_new(0);
+    tokens_reserve(&rest, output->size - i + 1);
+    for (int j = i + 1; j < output->size; j++) {
+        tokens_push_token(&rest, output, j);
+    }
+    while (output->size > i - 1) {
+        tokens_pop(output);
+    }
+    for (int j = 0; j < pasted.size; j++) {
+        tokens_push_token(output, &pasted, j);
+    }
+    for (int j = 0; j < rest.size; j++) {
+        tokens_push_token(output, &rest, j);
+    }
+    tokens_free(&rest);
+    tokens_free(&pasted);
+    free(text);
+}
+
+void preprocess_macro_args_free(Vec* args) {
+    Tokens* arg_list = args->elems;
+    for (int i = 0; i < args->size; i++) {
+        tokens_free(&arg_list[i]);
+    }
+    vec_free(args);
 }
 
-// Preprocess #ifndef directives
-void preprocess_ifndef(Tokens* tokens, PreprocessorTable* table) {
-    Token* token = tokens_get(tokens, table->token_index);
-    // Isolate #ifdef identifier
-    StrVector str_vec = str_split_on_whitespace(token->string_repr);
+bool preprocess_conditional_is_defined(Tokens* tokens, PreprocessorTable* table, char* error_message) {
+    // Isolate #ifdef/#ifndef identifier
+    StrVector str_vec = str_split_on_whitespace(tokens_get_string(tokens, table->token_index));
     if (str_vec.size < 2) {
-        preprocess_error("#ifndef directive has no identifier!", table);
+        preprocess_error(error_message, table);
     }
-    char* define_ident = str_copy(str_vec.elems[1]);
-    int endif_offset = preprocess_scan_for_endif(token, table);
-    if (!preprocessor_table_lookup(table, define_ident)) { // Value not defined, use code
-        // Consume this token, set it to none
-        token->type = TK_NONE;
+    char* define_ident = intern_str(str_vec.elems[1]);
+    str_vec_free(&str_vec);
+    return preprocessor_table_lookup_define(table, define_ident) != NULL;
+}
+
+// ================ Include guards ===================
 
-        // Consume matching #endif
-        token += endif_offset;
-        token->type = TK_NONE;
+void preprocess_guard_init(IncludeGuard* guard) {
+    guard->state = GUARD_START;
+    guard->define_ident = NULL;
+    guard->depth = 0;
+}
+
+void preprocess_guard_feed(IncludeGuard* guard, Tokens* tokens, int i) {
+    TokenType type = tokens_get_type(tokens, i);
+    if (guard->state == GUARD_NONE || type == TK_COMMENT || type == TK_EOF) {
+        return;
+    }
+    if (type != TK_PREPROCESSOR) {
+        // Code is only allowed inside the guarded block
+        if (guard->state != GUARD_INSIDE) {
+            guard->state = GUARD_NONE;
+        }
+        return;
+    }
+    char* directive = tokens_get_string(tokens, i);
+    if (guard->state == GUARD_START || guard->state == GUARD_DEFINE) {
+        StrVector str_vec = str_split_on_whitespace(directive);
+        char* ident = NULL;
+        if (str_vec.size >= 2) {
+            ident = intern_str(str_vec.elems[1]);
+        }
+        str_vec_free(&str_vec);
+        if (guard->state == GUARD_START && str_startswith(directive, "#ifndef") &&
+            ident != NULL) {
+            guard->state = GUARD_DEFINE;
+            guard->define_ident = ident;
+        }
+        else if (guard->state == GUARD_DEFINE && str_startswith(directive, "#define") &&
+                 ident == guard->define_ident) {
+            guard->state = GUARD_INSIDE;
+            guard->depth = 1;
+        }
+        else {
+            guard->state = GUARD_NONE;
+        }
     }
-    else { // Value defined, cut out the tokens by setting them to none
-        Token* end_token = token + endif_offset;
-        while (token <= end_token) {
-            token->type = TK_NONE;
-            token++;
+    else if (guard->state == GUARD_INSIDE) {
+        if (str_startswith(directive, "#ifdef") || str_startswith(directive, "#ifndef")) {
+            guard->depth++;
         }
+        else if (str_startswith(directive, "#endif")) {
+            guard->depth--;
+            if (guard->depth == 0) {
+                guard->state = GUARD_CLOSED;
+            }
+        }
+    }
+    else { // Directives after the guard
+        guard->state = GUARD_NONE;
     }
+}
 
-    str_vec_free(&str_vec);
-    free(define_ident);
-}
-
-// Scan for #endif directive, return offset from given token
-int preprocess_scan_for_endif(Token* start_token, PreprocessorTable* table) {
-    // Simple stack-based match search
-    int offset = 0;
-    int endifs_left = 0; // Used as stack
-    while (start_token->type != TK_EOF) {
-        if (start_token->type == TK_PREPROCESSOR) {
-            if (str_startswith(start_token->string_repr, "#ifdef") ||
-                str_startswith(start_token->string_repr, "#ifndef")) {
-                endifs_left++; // Push
+bool preprocess_guard_can_skip(IncludeGuard* guard) {
+    // Only directives change the state inside the guard, and an unused block is balanced
+    return guard->state == GUARD_INSIDE || guard->state == GUARD_NONE;
+}
+
+void preprocess_guard_record(IncludeGuard* guard, PreprocessorTable* table, char* path) {
+    if (guard->state != GUARD_CLOSED) {
+        return;
+    }
+    PreprocessorItem item;
+    item.type = PP_INCLUDE_GUARD;
+    item.name = intern_str(path);
+    item.value = guard->define_ident;
+    preprocessor_table_insert(table, item);
+}
+
+bool preprocess_guard_skips_include(PreprocessorTable* table, char* path) {
+    PreprocessorItem* item = preprocessor_map_lookup(table->include_guards, intern_str(path));
+    if (item == NULL || preprocessor_table_lookup_define(table, item->value) == NULL) {
+        return false;
+    }
+    guarded_includes_skipped++;
+    return true;
+}
+
+int preprocess_files_opened() {
+    return files_opened;
+}
+
+int preprocess_guarded_includes_skipped() {
+    return guarded_includes_skipped;
+}
+
+// ================ Token stream ===================
+
+TokenStream token_stream_new(char* filename, PreprocessorTable* table) {
+    TokenStream stream = token_stream_new_empty(TOKEN_STREAM_CAPACITY);
+    token_stream_push_file(&stream, filename, table, false);
+    return stream;
+}
+
+TokenStream token_stream_new_tokens(Tokens* tokens, PreprocessorTable* table) {
+    // The stream is only drained, so it does not need a ring
+    TokenStream stream = token_stream_new_empty(0);
+    stream.pch_allowed = false;
+    Tokens frame_tokens = tokens_new(0);
+    tokens_reserve(&frame_tokens, tokens->size + 1);
+    for (int i = 0; i < tokens->size; i++) {
+        tokens_push_token(&frame_tokens, tokens, i);
+    }
+    // The tokens end in EOF like a file, which stops draining before the frame is popped
+    TokenSpan eof_span;
+    eof_span.file_id = 0;
+    eof_span.offset = 0;
+    eof_span.length = 0;
+    tokens_push(&frame_tokens, TK_EOF, eof_span);
+    PreprocessFrame frame = preprocess_frame_new_tokens(table, frame_tokens, true);
+    vec_push(&stream.frames, &frame);
+    return stream;
+}
+
+TokenStream token_stream_new_empty(int ring_capacity) {
+    TokenStream stream;
+    stream.frames = vec_new(sizeof(PreprocessFrame), 16);
+    stream.ring = tokens_new(ring_capacity);
+    stream.start = 0;
+    stream.end = 0;
+    stream.keep_start = -1;
+    stream.pch_allowed = true;
+    stream.header_tokens = tokens_new(0);
+    stream.output = NULL;
+    return stream;
+}
+
+void token_stream_free(TokenStream* stream) {
+    while (stream->frames.size > 0) {
+        token_stream_pop_frame(stream);
+    }
+    vec_free(&stream->frames);
+    tokens_free(&stream->ring);
+    tokens_free(&stream->header_tokens);
+}
+
+void token_stream_drain(TokenStream* stream, Tokens* output) {
+    stream->output = output;
+    while (true) {
+        token_stream_pull(stream);
+        if (tokens_get_type(output, output->size - 1) == TK_EOF) {
+            break;
+        }
+    }
+    stream->output = NULL;
+}
+
+int token_stream_slot(TokenStream* stream, int index) {
+    while (index >= stream->end) {
+        token_stream_pull(stream);
+    }
+    if (index < stream->start) {
+        PreprocessFrame* frame = vec_peek(&stream->frames);
+        preprocess_error("Token stream can not go back this far, increase TOKEN_STREAM_CAPACITY",
+                         &frame->table);
+    }
+    return index % stream->ring.size;
+}
+
+void token_stream_grow_ring(TokenStream* stream) {
+    Tokens ring = tokens_new(stream->ring.size * 2);
+    for (int i = stream->start; i < stream->end; i++) {
+        tokens_set_token(&ring, i % ring.size, &stream->ring, i % stream->ring.size);
+    }
+    tokens_free(&stream->ring);
+    stream->ring = ring;
+}
+
+void token_stream_push_file(TokenStream* stream, char* filename, PreprocessorTable* table,
+                            bool is_stl_file) {
+    PreprocessFrame frame;
+    frame.table = *table;
+    frame.filename_with_dir = preprocess_file_path(filename, table, is_stl_file);
+    frame.table.current_file = frame.filename_with_dir;
+    int file_id = source_file_open(frame.filename_with_dir, true);
+    files_opened++;
+    preprocessor_table_add_dependency(&frame.table, frame.filename_with_dir);
+    source_file_get(file_id)->filename = filename;
+    preprocessor_table_update_current_dir(&frame.table, filename);
+
+    if (token_cache_enabled()) {
+        // Cached tokens are read for the whole file. They end in EOF, so the frame
+        // never has to tokenize a line
+        frame.tokens = token_cache_tokenize(file_id);
+    }
+    else {
+        frame.tokens = tokens_new(0);
+        tokens_reserve(&frame.tokens, TOKENS_INITIAL_CAPACITY);
+    }
+    tokenizer_init(&frame.tokenizer, NULL, file_id);
+    frame.index = 0;
+    frame.is_macro = false;
+    frame.macro_name = NULL;
+    frame.owns_tokens = true;
+    frame.rescan = true;
+    frame.open_conditionals = 0;
+    frame.skipped_conditionals = 0;
+    preprocess_guard_init(&frame.guard);
+    vec_push(&stream->frames, &frame);
+}
+
+void token_stream_push_macro(TokenStream* stream, PreprocessFrame* frame,
+                             PreprocessorItem* item, int i) {
+    // The define value tokens stay owned by the table
+    PreprocessFrame expansion =
+        preprocess_frame_new_tokens(&frame->table, item->define_value_tokens, false);
+    expansion.macro_name = item->name;
+    expansion.use_span = token_stream_use_span(frame, i);
+    item->is_expanding = true;
+    vec_push(&stream->frames, &expansion);
+}
+
+void token_stream_push_tokens(TokenStream* stream, Tokens* tokens) {
+    PreprocessFrame* file_frame = vec_peek(&stream->frames);
+    PreprocessFrame frame =
+        preprocess_frame_new_tokens(&file_frame->table, *tokens, false);
+    frame.rescan = false;
+    vec_push(&stream->frames, &frame);
+}
+
+PreprocessFrame preprocess_frame_new_tokens(PreprocessorTable* table, Tokens tokens,
+                                            bool owns_tokens) {
+    PreprocessFrame frame;
+    frame.table = *table;
+    frame.tokens = tokens;
+    frame.index = 0;
+    frame.is_macro = true;
+    frame.macro_name = NULL;
+    frame.owns_tokens = owns_tokens;
+    frame.rescan = true;
+    return frame;
+}
+
+bool token_stream_push_function_macro(TokenStream* stream, PreprocessFrame* frame,
+                                      PreprocessorItem* item, int i) {
+    // An expansion is rescanned together with the tokens after it, so if the name ends
+    // an expansion, the arguments are looked for in the frames below it
+    int args_frame_index = stream->frames.size - 1;
+    PreprocessFrame* args_frame = frame;
+    int start = i + 1;
+    while (args_frame->is_macro && args_frame_index > 0 &&
+           preprocess_macro_next(&args_frame->tokens, start, NULL) >=
+               args_frame->tokens.size) {
+        args_frame_index--;
+        args_frame = vec_get(&stream->frames, args_frame_index);
+        start = args_frame->index;
+    }
+    // The arguments of a use in a file can continue on the next lines
+    Tokenizer* tokenizer = NULL;
+    if (!args_frame->is_macro) {
+        args_frame->tokenizer.tokens = &args_frame->tokens;
+        tokenizer = &args_frame->tokenizer;
+    }
+    PreprocessorTable table = frame->table;
+    Vec args = vec_new(sizeof(Tokens), item->param_count + 1);
+    int end =
+        preprocess_macro_args(&args_frame->tokens, start, tokenizer, item, &args, &table);
+    if (end < 0) {
+        preprocess_macro_args_free(&args);
+        return false;
+    }
+    args_frame->index = end;
+    TokenSpan use_span = token_stream_use_span(frame, i);
+    // The frames the arguments were read past have no tokens left
+    while (stream->frames.size - 1 > args_frame_index) {
+        token_stream_pop_frame(stream);
+    }
+
+    // The expansion is rescanned from its own frame, which owns the tokens
+    Tokens expanded = tokens_new(0);
+    tokens_reserve(&expanded, TOKENS_INITIAL_CAPACITY);
+    preprocess_macro_expand(item, &args, &table, &expanded);
+    preprocess_macro_args_free(&args);
+    PreprocessFrame expansion = preprocess_frame_new_tokens(&table, expanded, true);
+    expansion.macro_name = item->name;
+    expansion.use_span = use_span;
+    item->is_expanding = true;
+    vec_push(&stream->frames, &expansion);
+    return true;
+}
+
+TokenSpan token_stream_use_span(PreprocessFrame* frame, int i) {
+    // Defines used inside an expansion are reported at the use of the outer define
+    if (frame->macro_name != NULL) {
+        return frame->use_span;
+    }
+    return *tokens_get_span(&frame->tokens, i);
+}
+
+bool token_stream_expand_ident(TokenStream* stream, PreprocessFrame* frame, int i) {
+    PreprocessorItem* item =
+        preprocessor_table_lookup_define(&frame->table, tokens_get_string(&frame->tokens, i));
+    // A define is not expanded again while its expansion is being rescanned
+    if (item == NULL || item->is_expanding) {
+        return false;
+    }
+    if (item->is_function_like) {
+        return token_stream_push_function_macro(stream, frame, item, i);
+    }
+    token_stream_push_macro(stream, frame, item, i);
+    return true;
+}
+
+void token_stream_pop_frame(TokenStream* stream) {
+    PreprocessFrame* frame = vec_pop(&stream->frames);
+    if (frame->macro_name != NULL) {
+        // The define can be expanded again after its expansion
+        preprocessor_table_lookup_define(&frame->table, frame->macro_name)->is_expanding = false;
+    }
+    if (frame->owns_tokens) {
+        tokens_free(&frame->tokens);
+    }
+    if (frame->is_macro) {
+        return;
+    }
+    free(frame->table.current_file_dir);
+    free(frame->filename_with_dir);
+}
+
+TokenSpan* token_stream_emit(TokenStream* stream, Tokens* tokens, int i) {
+    if (tokens_get_type(tokens, i) != TK_COMMENT) {
+        stream->pch_allowed = false;
+    }
+    if (stream->output != NULL) {
+        int output_index = tokens_push_token(stream->output, tokens, i);
+        return tokens_get_span(stream->output, output_index);
+    }
+    bool is_full = stream->end - stream->start == stream->ring.size;
+    if (is_full && stream->keep_start >= 0 && stream->keep_start <= stream->start) {
+        // The oldest token would be dropped, but the parser can still go back to it
+        token_stream_grow_ring(stream);
+    }
+    int slot = stream->end % stream->ring.size;
+    tokens_set_token(&stream->ring, slot, tokens, i);
+    stream->end++;
+    if (stream->end - stream->start > stream->ring.size) {
+        stream->start = stream->end - stream->ring.size;
+    }
+    return tokens_get_span(&stream->ring, slot);
+}
+
+void token_stream_emit_expanded(TokenStream* stream, PreprocessFrame* frame, int i) {
+    if (frame->macro_name == NULL || tokens_get_type(&frame->tokens, i) == TK_COMMENT) {
+        token_stream_emit(stream, &frame->tokens, i);
+        return;
+    }
+    // Tokens of an expansion are reported at the use of the define. Their text is
+    // materialized first, as it is read from the span
+    tokens_get_string(&frame->tokens, i);
+    TokenSpan* span = token_stream_emit(stream, &frame->tokens, i);
+    *span = frame->use_span;
+}
+
+void token_stream_pull(TokenStream* stream) {
+    while (true) {
+        PreprocessFrame* frame = vec_peek(&stream->frames);
+        if (frame->index >= frame->tokens.size) {
+            if (frame->is_macro) {
+                token_stream_pop_frame(stream);
+            }
+            else { // Tokenize the next line of the file
+                tokens_clear(&frame->tokens);
+                frame->index = 0;
+                // The frame may have moved since the last line, as the frame vector grows
+                frame->tokenizer.tokens = &frame->tokens;
+                if (frame->skipped_conditionals > 0 && preprocess_guard_can_skip(&frame->guard)) {
+                    tokenize_next_directive_line(&frame->tokenizer);
+                }
+                else {
+                    tokenize_next_line(&frame->tokenizer);
+                }
+            }
+            continue;
+        }
+        int i = frame->index;
+        frame->index++;
+        TokenType type = tokens_get_type(&frame->tokens, i);
+        if (type == TK_NONE) {
+            continue;
+        }
+        if (frame->is_macro) {
+            // Expansions of defines and token lists are rescanned
+            if (frame->rescan && type == TK_IDENT &&
+                token_stream_expand_ident(stream, frame, i)) {
+                continue;
+            }
+            token_stream_emit_expanded(stream, frame, i);
+            return;
+        }
+        preprocess_guard_feed(&frame->guard, &frame->tokens, i);
+        if (type == TK_EOF) {
+            if (frame->open_conditionals > 0 || frame->skipped_conditionals > 0) {
+                preprocess_error("#ifdef/#ifndef directive has no matching #endif!", &frame->table);
             }
-            else if (str_startswith(start_token->string_repr, "#endif")) {
-                endifs_left--; // Pop
+            preprocess_guard_record(&frame->guard, &frame->table, frame->filename_with_dir);
+            if (stream->frames.size > 1) { // End of an include file
+                token_stream_pop_frame(stream);
+                continue;
             }
+            // End of the translation unit, keep returning EOF
+            frame->index--;
+            token_stream_emit(stream, &frame->tokens, i);
+            return;
+        }
+        if (frame->skipped_conditionals > 0) {
+            token_stream_skip_conditional(frame, i);
+            continue;
+        }
+        if (type == TK_PREPROCESSOR) {
+            int frame_count = stream->frames.size;
+            frame->table.token_index = i;
+            token_stream_directive(stream, frame);
+            if (stream->frames.size != frame_count) { // Entered an include file
+                continue;
+            }
+            // Directives which are not consumed are passed on, like #pragma once
+            if (tokens_get_type(&frame->tokens, i) == TK_NONE) {
+                continue;
+            }
+        }
+        else if (type == TK_IDENT && token_stream_expand_ident(stream, frame, i)) {
+            // This is a define identifier, continue with the define tokens
+            continue;
+        }
+        token_stream_emit(stream, &frame->tokens, i);
+        return;
+    }
+}
+
+void token_stream_directive(TokenStream* stream, PreprocessFrame* frame) {
+    Tokens* tokens = &frame->tokens;
+    PreprocessorTable* table = &frame->table;
+    char* directive = tokens_get_string(tokens, table->token_index);
+    // A precompiled header can only replace the first directive of the translation unit,
+    // as the table is then in the same state as when the header was precompiled
+    bool is_first_directive = stream->pch_allowed;
+    stream->pch_allowed = false;
+    if (str_startswith(directive, "#include")) {
+        bool is_stl_file;
+        char* file_str = preprocess_include_file(tokens, table, &is_stl_file);
+        if (file_str == NULL) {
+            return;
+        }
+        char* path = preprocess_file_path(file_str, table, is_stl_file);
+        if (preprocess_guard_skips_include(table, path)) {
+            free(path);
+            return;
         }
-        if (endifs_left == 0) { // Stack empty, found match
-            return offset;
+        if (is_first_directive && pch_load(path, table, &stream->header_tokens)) {
+            source_file_get(source_file_open(path, true))->filename = file_str;
+            token_stream_push_tokens(stream, &stream->header_tokens);
         }
-        start_token++;
-        offset++;
+        else {
+            PreprocessorTable next_table = *table;
+            next_table.current_file_name = file_str;
+            token_stream_push_file(stream, file_str, &next_table, is_stl_file);
+        }
+        free(path);
+    }
+    else if (str_startswith(directive, "#ifdef")) {
+        bool is_defined =
+            preprocess_conditional_is_defined(tokens, table, "#ifdef directive has no identifier!");
+        token_stream_conditional(frame, is_defined);
+    }
+    else if (str_startswith(directive, "#ifndef")) {
+        bool is_defined =
+            preprocess_conditional_is_defined(tokens, table, "#ifndef directive has no identifier!");
+        token_stream_conditional(frame, !is_defined);
+    }
+    else if (str_startswith(directive, "#endif") && frame->open_conditionals > 0) {
+        // Consume the #endif of an used conditional block
+        frame->open_conditionals--;
+        tokens_set_type(tokens, table->token_index, TK_NONE);
+    }
+    else {
+        preprocess_directive(tokens, table);
+    }
+}
+
+void token_stream_conditional(PreprocessFrame* frame, bool use_code) {
+    int index = frame->table.token_index;
+    tokens_set_type(&frame->tokens, index, TK_NONE);
+    if (use_code) {
+        frame->open_conditionals++;
+        return;
+    }
+    frame->skipped_conditionals = 1;
+    // Whole files of cached tokens have a conditional index, jump to the #endif
+    int endif_index = tokens_find_conditional_end(&frame->tokens, index);
+    if (endif_index >= 0 && preprocess_guard_can_skip(&frame->guard)) {
+        frame->index = endif_index;
+    }
+}
+
+void token_stream_skip_conditional(PreprocessFrame* frame, int i) {
+    if (tokens_get_type(&frame->tokens, i) != TK_PREPROCESSOR) {
+        return;
+    }
+    char* directive = tokens_get_string(&frame->tokens, i);
+    if (str_startswith(directive, "#ifdef") || str_startswith(directive, "#ifndef")) {
+        frame->skipped_conditionals++;
+    }
+    else if (str_startswith(directive, "#endif")) {
+        frame->skipped_conditionals--;
     }
-    preprocess_error("#ifdef/#ifndef directive has no matching #endif!", table);
-    return -1;
 }
 
 // ================ Preprocessor Table ===================
 
 PreprocessorTable preprocessor_table_new() {
     PreprocessorTable table;
-    table.elems = vec_new_dyn(sizeof(PreprocessorItem));
+    table.defines = preprocessor_map_new();
+    table.included_files = preprocessor_map_new();
+    table.include_guards = preprocessor_map_new();
+    table.dependencies = vec_new_dyn(sizeof(char*));
     table.token_index = 0;
     table.current_file_dir = NULL;
-    table.current_file_index = 0;
+    table.current_file_name = NULL;
     // Add a CCIC define which is unique for this compiler
     // Useful for certain debugging
     preprocessor_table_add_simple_define(&table, "CCIC");
@@ -315,18 +989,11 @@ PreprocessorTable preprocessor_table_new() {
 }
 
 void preprocessor_table_free(PreprocessorTable* table) {
-    for (size_t i = 0; i < table->elems->size; i++) {
-        PreprocessorItem* item = vec_get(table->elems, i);
-        if (item->type == PP_INCLUDED_FILE && item->name != NULL) {
-            free(item->name);
-        }
-        else if (item->type == PP_DEFINE && item->name != NULL) {
-            tokens_free(&item->define_value_tokens);
-            free(item->name);
-        }
-    }
-    vec_free(table->elems);
-    free(table->elems);
+    preprocessor_map_free(table->defines);
+    preprocessor_map_free(table->included_files);
+    preprocessor_map_free(table->include_guards);
+    vec_free(table->dependencies);
+    free(table->dependencies);
 }
 
 void preprocessor_table_update_current_dir(PreprocessorTable* table, char* filepath) {
@@ -338,42 +1005,94 @@ void preprocessor_table_update_current_dir(PreprocessorTable* table, char* filep
     free(file_dir);
 }
 
-PreprocessorItem* preprocessor_table_lookup(PreprocessorTable* table, char* name) {
-    for (size_t i = 0; i < table->elems->size; i++) {
-        PreprocessorItem* item = vec_get(table->elems, i);
-        if (!item->ignore && strcmp(item->name, name) == 0) {
-            return item;
-        }
-    }
-    return NULL;
+PreprocessorItem* preprocessor_table_lookup_define(PreprocessorTable* table, char* name) {
+    return preprocessor_map_lookup(table->defines, name);
+}
+
+PreprocessorItem* preprocessor_table_lookup_file(PreprocessorTable* table, char* name) {
+    return preprocessor_map_lookup(table->included_files, name);
 }
 
 PreprocessorItem* preprocessor_table_get_current_file(PreprocessorTable* table) {
-    return vec_get(table->elems, table->current_file_index);
+    if (table->current_file_name == NULL) {
+        return NULL;
+    }
+    return preprocessor_table_lookup_file(table, table->current_file_name);
 }
 
 void preprocessor_table_insert(PreprocessorTable* table, PreprocessorItem item) {
-    item.ignore = false;
-    vec_push(table->elems, &item);
+    if (item.type == PP_DEFINE) {
+        preprocessor_map_insert(table->defines, item);
+    }
+    else if (item.type == PP_INCLUDED_FILE) {
+        preprocessor_map_insert(table->included_files, item);
+    }
+    else {
+        preprocessor_map_insert(table->include_guards, item);
+    }
 }
 
 int preprocessor_table_remove(PreprocessorTable* table, char* name) {
-    PreprocessorItem* item = preprocessor_table_lookup(table, name);
+    PreprocessorItem* item = preprocessor_table_lookup_define(table, name);
     if (item == NULL) { // This item does not exist, do nothing
         return 0;
     }
-    // Removing items is expensive, just ignore this item from now on
+    // Keep the slot so probing for other names still works, just ignore this item from now on
     item->ignore = true;
     return 1;
 }
 
+void preprocessor_table_add_dependency(PreprocessorTable* table, char* path) {
+    // A translation unit depends on few files, so they are searched linearly
+    char* name = intern_str(path);
+    char** dependencies = table->dependencies->elems;
+    for (int i = 0; i < table->dependencies->size; i++) {
+        if (dependencies[i] == name) {
+            return;
+        }
+    }
+    vec_push(table->dependencies, &name);
+}
+
+char* preprocessor_table_dependency_rule(PreprocessorTable* table, char* target) {
+    char** dependencies = table->dependencies->elems;
+    StrVector rule = str_vec_new(2 * table->dependencies->size + 4);
+    str_vec_push(&rule, target);
+    str_vec_push(&rule, ":");
+    for (int i = 0; i < table->dependencies->size; i++) {
+        str_vec_push(&rule, " \\\n  ");
+        str_vec_push(&rule, dependencies[i]);
+    }
+    str_vec_push(&rule, "\n");
+    for (int i = 1; i < table->dependencies->size; i++) {
+        str_vec_push(&rule, "\n");
+        str_vec_push(&rule, dependencies[i]);
+        str_vec_push(&rule, ":\n");
+    }
+    char* rule_str = str_vec_join(&rule);
+    str_vec_free(&rule);
+    return rule_str;
+}
+
 // Add a simple define. Used for compiler specific defines etc
 void preprocessor_table_add_simple_define(PreprocessorTable* table, char* name) {
+    preprocessor_table_insert(table, preprocessor_define_new(intern_str(name), tokens_new(0)));
+}
+
+PreprocessorItem preprocessor_define_new(char* name, Tokens define_value_tokens) {
     PreprocessorItem item;
-    item.name = str_copy(name);
     item.type = PP_DEFINE;
-    item.define_value_tokens = tokens_new(0);
-    preprocessor_table_insert(table, item);
+    item.name = name;
+    item.value = NULL;
+    item.include_file_only_once = false;
+    item.define_value_tokens = define_value_tokens;
+    item.ignore = false;
+    item.is_function_like = false;
+    item.is_variadic = false;
+    item.param_count = 0;
+    item.define_param_refs = vec_new(sizeof(int), 0);
+    item.is_expanding = false;
+    return item;
 }
 
 void preprocess_error(char* error_message, PreprocessorTable* table) {
@@ -381,3 +1100,80 @@ void preprocess_error(char* error_message, PreprocessorTable* table) {
             table->current_file);
     exit(1);
 }
+
+// ================ Preprocessor Map ===================
+
+PreprocessorMap* preprocessor_map_new() {
+    PreprocessorMap* map = malloc(sizeof(PreprocessorMap));
+    map->size = 0;
+    map->capacity = PREPROCESSOR_MAP_INITIAL_CAPACITY;
+    map->items = calloc(map->capacity, sizeof(PreprocessorItem));
+    return map;
+}
+
+void preprocessor_map_free(PreprocessorMap* map) {
+    for (size_t i = 0; i < map->capacity; i++) {
+        PreprocessorItem* item = &map->items[i];
+        // Names are interned and not owned by the map
+        if (item->name != NULL && item->type == PP_DEFINE) {
+            tokens_free(&item->define_value_tokens);
+            vec_free(&item->define_param_refs);
+        }
+    }
+    free(map->items);
+    free(map);
+}
+
+PreprocessorItem* preprocessor_map_lookup(PreprocessorMap* map, char* name) {
+    PreprocessorItem* item = &map->items[preprocessor_map_find_slot(map, name)];
+    if (item->name == NULL || item->ignore) {
+        return NULL;
+    }
+    return item;
+}
+
+void preprocessor_map_insert(PreprocessorMap* map, PreprocessorItem item) {
+    // Keep the load factor at most 1/2, so probe sequences stay short
+    if ((map->size + 1) * 2 > map->capacity) {
+        preprocessor_map_grow(map);
+    }
+    PreprocessorItem* slot = &map->items[preprocessor_map_find_slot(map, item.name)];
+    if (slot->name == NULL) {
+        map->size++;
+    }
+    else if (slot->type == PP_DEFINE) { // Redefined or defined again after #undef
+        tokens_free(&slot->define_value_tokens);
+        vec_free(&slot->define_param_refs);
+    }
+    item.ignore = false;
+    *slot = item;
+}
+
+int preprocessor_map_find_slot(PreprocessorMap* map, char* name) {
+    // Linear probing until the name or an empty slot is found
+    int mask = map->capacity - 1;
+    int slot = preprocessor_map_hash(name) & mask;
+    while (map->items[slot].name != NULL && map->items[slot].name != name) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+int preprocessor_map_hash(char* name) {
+    // Names are interned, so the address identifies the name
+    long address = (long)name;
+    return address ^ (address >> 9) ^ (address >> 20);
+}
+
+void preprocessor_map_grow(PreprocessorMap* map) {
+    PreprocessorItem* old_items = map->items;
+    int old_capacity = map->capacity;
+    map->capacity = old_capacity * 2;
+    map->items = calloc(map->capacity, sizeof(PreprocessorItem));
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_items[i].name != NULL) {
+            map->items[preprocessor_map_find_slot(map, old_items[i].name)] = old_items[i];
+        }
+    }
+    free(old_items);
+}
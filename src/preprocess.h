@@ -5,7 +5,7 @@
 // Support:
 //      #include
 //      #pragma once
-//      #define (simple replace macros, not functions)
+//      #define (replace macros, and function-like macros with #, ## and __VA_ARGS__)
 //      #undef
 //      #ifdef
 //      #ifndef
@@ -16,22 +16,13 @@
 
 #include "util/file_helpers.h"
 #include "util/vector.h"
+#include "util/scan.h"
 #include "tokens.h"
 
-// Should probably be a hashmap
-struct PreprocessorTable {
-    Vec* elems;
-    int token_index;
-    int current_file_index;
-    char* current_file_dir;
-    char* current_file;
-};
-
-typedef struct PreprocessorTable PreprocessorTable;
-
 enum PreprocessorItemType {
     PP_DEFINE,
     PP_INCLUDED_FILE,
+    PP_INCLUDE_GUARD,
 };
 
 typedef enum PreprocessorItemType PreprocessorItemType;
@@ -39,25 +30,140 @@ typedef enum PreprocessorItemType PreprocessorItemType;
 struct PreprocessorItem {
     PreprocessorItemType type;
     char* name;
-    char* value;
+    char* value; // Guard define of a PP_INCLUDE_GUARD file
     bool include_file_only_once;
     Tokens define_value_tokens;
     bool ignore;
+    // Value tokens are kept unexpanded. Function-like defines also keep the parameter
+    // of every value token found when they are defined, so uses do not have to look it up
+    bool is_function_like;
+    bool is_variadic; // The last parameter is __VA_ARGS__
+    int param_count;
+    Vec define_param_refs; // int vec, parameter index of every value token, -1 if none
+    bool is_expanding; // The expansion is being rescanned, so the define is not expanded again
 };
 
 typedef struct PreprocessorItem PreprocessorItem;
 
-// Turn the first file into a list of tokens
+#define PREPROCESSOR_MAP_INITIAL_CAPACITY 64
+
+// Open addressing hash map of items, keyed by their interned name.
+// Removed items stay in their slot with ignore set, so probing is not disturbed
+struct PreprocessorMap {
+    int size; // Used slots, including ignored items
+    int capacity; // Power of two
+    PreprocessorItem* items; // Slots, the name is NULL if the slot is empty
+};
+
+typedef struct PreprocessorMap PreprocessorMap;
+
+// Defines and included files are kept in separate maps. The maps are shared
+// by the copies of the table made for included files
+struct PreprocessorTable {
+    PreprocessorMap* defines;
+    PreprocessorMap* included_files;
+    PreprocessorMap* include_guards; // Paths of files wrapped in an #ifndef include guard
+    Vec* dependencies; // char* vec, interned paths of every file the output depends on
+    int token_index;
+    char* current_file_name; // Name of the current file in included_files, NULL for the first file
+    char* current_file_dir;
+    char* current_file;
+};
+
+typedef struct PreprocessorTable PreprocessorTable;
+
+enum IncludeGuardState {
+    GUARD_START, // Waiting for the #ifndef
+    GUARD_DEFINE, // Waiting for the #define of the guard
+    GUARD_INSIDE, // Inside the guarded block
+    GUARD_CLOSED, // After the #endif of the guard, only comments may follow
+    GUARD_NONE, // The file is not guarded
+};
+
+typedef enum IncludeGuardState IncludeGuardState;
+
+// Detects the #ifndef X / #define X / ... / #endif include guard pattern,
+// by being fed the raw tokens of a file in order
+struct IncludeGuard {
+    IncludeGuardState state;
+    char* define_ident;
+    int depth; // Nesting depth of conditionals inside the guard
+};
+
+typedef struct IncludeGuard IncludeGuard;
+
+// Number of recent tokens a TokenStream starts with, which bounds how far the parser can
+// go back. The ring grows instead of dropping tokens the parser has asked to keep
+#define TOKEN_STREAM_CAPACITY 4096
+
+// A file or define expansion which the token stream is reading from
+struct PreprocessFrame {
+    PreprocessorTable table; // Per file table state, the items are shared by all frames
+    Tokenizer tokenizer;
+    Tokens tokens; // Tokens of the current line of a file, or the tokens of a define
+    int index;
+    IncludeGuard guard;
+    bool is_macro; // The tokens are in memory, instead of being tokenized from a file
+    char* macro_name; // Define the frame is the expansion of, or NULL
+    TokenSpan use_span; // Location of the define use in a file, given to expanded tokens
+    bool owns_tokens; // The tokens are freed with the frame
+    bool rescan; // Identifiers are expanded, false for already preprocessed tokens
+    int open_conditionals; // Used #ifdef/#ifndef blocks waiting for their #endif
+    int skipped_conditionals; // Nesting depth inside an unused block, 0 when not skipping
+    char* filename_with_dir;
+};
+
+typedef struct PreprocessFrame PreprocessFrame;
+
+// The preprocessor. Files are tokenized one line at a time and preprocessed as
+// the parser pulls tokens, with includes and defines expanded lazily.
+// Only the most recent tokens are kept in a ring buffer, so token memory does not
+// grow with the size of the translation unit
+struct TokenStream {
+    Vec frames; // PreprocessFrame vec, the innermost file or define last
+    Tokens ring; // The last ring.size tokens
+    int start; // Stream index of the oldest token in the ring
+    int end; // Stream index after the newest token in the ring
+    int keep_start; // Tokens from this stream index on stay in the ring, or -1
+    bool pch_allowed; // Only comments have been read, so the next #include can use a .pch file
+    Tokens header_tokens; // Tokens of a loaded precompiled header
+    Tokens* output; // Tokens are appended here instead of to the ring while draining
+};
+
+typedef struct TokenStream TokenStream;
+
+// Turn the first file into a list of tokens, by draining a token stream of it
 Tokens preprocess_first(char* filename, PreprocessorTable* table);
 
-// Turn a file into a list of tokens
-Tokens preprocess(char* filename, PreprocessorTable* table, bool is_stl_file);
+// Expand the defines in tokens, appending the result to output
+void preprocess_tokens(Tokens* tokens, PreprocessorTable* table, Tokens* output);
+
+// Path of a file included from the current file, the returned string is owned by the caller
+char* preprocess_file_path(char* filename, PreprocessorTable* table, bool is_stl_file);
+
+// Include guard detection. A file whose guard define is still defined does not have to
+// be opened again, as all of its code would be cut out
+void preprocess_guard_init(IncludeGuard* guard);
+void preprocess_guard_feed(IncludeGuard* guard, Tokens* tokens, int i);
+// Returns true if the tokens of an unused conditional block can be skipped without
+// feeding them, as they would not change the guard
+bool preprocess_guard_can_skip(IncludeGuard* guard);
+// Record the guard of a file once all of its tokens have been fed
+void preprocess_guard_record(IncludeGuard* guard, PreprocessorTable* table, char* path);
+// Returns true and counts the skip if the file at path is guarded by a defined guard
+bool preprocess_guard_skips_include(PreprocessorTable* table, char* path);
+
+// Number of files opened by the preprocessor, and of includes skipped by their include guard
+int preprocess_files_opened();
+int preprocess_guarded_includes_skipped();
 
-Tokens preprocess_tokens(Tokens* tokens, PreprocessorTable* table);
-void preprocess_token(Tokens* tokens, PreprocessorTable* table);
+// Preprocess the directives which are the same in every frame, #define, #undef and
+// #pragma once. These do not output tokens
+void preprocess_directive(Tokens* tokens, PreprocessorTable* table);
 
-// Preprocess #include directive
-void preprocess_include(Tokens* tokens, PreprocessorTable* table);
+// Helper for #include, adds the included file to the table and returns its interned name.
+// Returns NULL if the file should not be included again because of #pragma once
+char* preprocess_include_file(Tokens* tokens, PreprocessorTable* table, bool* is_stl_file);
 
 // Preprocess #define directive (replace macro)
 void preprocess_define(Tokens* tokens, PreprocessorTable* table);
@@ -65,17 +171,75 @@ void preprocess_define(Tokens* tokens, PreprocessorTable* table);
 // Preprocess #undef directive (undefine)
 void preprocess_undef(Tokens* tokens, PreprocessorTable* table);
 
-// Preprocess identifiers and check if they match a define directive (replace macro)
-void preprocess_ident(Tokens* tokens, PreprocessorTable* table);
+// Helper for preprocess_define, for defines with parameters
+void preprocess_define_function(Tokens* tokens, PreprocessorTable* table, char* name,
+                                char* params_start);
 
-// Preprocess #ifdef directives
-void preprocess_ifdef(Tokens* tokens, PreprocessorTable* table);
+// Function-like define uses. The arguments after the name at tokens[start] are collected
+// into args, a Tokens vec. If tokenizer is not NULL, lines are tokenized into tokens
+// while the arguments continue. Returns the index after the closing paren, or -1 if
+// the name is not followed by arguments and is not a use of the define
+int preprocess_macro_args(Tokens* tokens, int start, Tokenizer* tokenizer, PreprocessorItem* item,
+                          Vec* args, PreprocessorTable* table);
+// Replace the parameters in the value tokens of a define with the arguments, and apply
+// # and ##. The output still has to be rescanned for defines
+void preprocess_macro_expand(PreprocessorItem* item, Vec* args, PreprocessorTable* table,
+                             Tokens* output);
+void preprocess_macro_args_free(Vec* args);
+// Index of the next token at or after i which is not a comment, tokenizing lines if needed
+int preprocess_macro_next(Tokens* tokens, int i, Tokenizer* tokenizer);
+// Helpers for preprocess_macro_expand
+char* preprocess_macro_stringify(Tokens* arg);
+void preprocess_macro_paste(Tokens* output, int i);
 
-// Preprocess #ifndef directives
-void preprocess_ifndef(Tokens* tokens, PreprocessorTable* table);
+// Helper for #ifdef and #ifndef, check if the identifier of the directive is defined
+bool preprocess_conditional_is_defined(Tokens* tokens, PreprocessorTable* table, char* error_message);
 
-// Scan for #endif directive, return offset from given token
-int preprocess_scan_for_endif(Token* start_token, PreprocessorTable* table);
+// =============== Token stream ===================
+// Start streaming the preprocessed tokens of a file
+TokenStream token_stream_new(char* filename, PreprocessorTable* table);
+// Stream the expansion of a copy of tokens, ending in an EOF token
+TokenStream token_stream_new_tokens(Tokens* tokens, PreprocessorTable* table);
+// Helper for the above, a stream without frames
+TokenStream token_stream_new_empty(int ring_capacity);
+
+// Append every token up to and including EOF to output, instead of to the ring
+void token_stream_drain(TokenStream* stream, Tokens* output);
+
+// Free the token stream and close any open files
+void token_stream_free(TokenStream* stream);
+
+// Get the ring buffer slot of the token at a stream index, pulling tokens until it is available.
+// The token is at this slot in stream->ring until more tokens are pulled
+int token_stream_slot(TokenStream* stream, int index);
+// Double the size of the ring, keeping the tokens in it
+void token_stream_grow_ring(TokenStream* stream);
+
+// Preprocess tokens from the open files until one token has been added to the ring
+void token_stream_pull(TokenStream* stream);
+// Helpers for token_stream_pull
+void token_stream_push_file(TokenStream* stream, char* filename, PreprocessorTable* table,
+                            bool is_stl_file);
+void token_stream_push_macro(TokenStream* stream, PreprocessFrame* frame,
+                             PreprocessorItem* item, int i);
+// Expand a use of a function-like define at frame->tokens[i], returns false if it is not a use
+bool token_stream_push_function_macro(TokenStream* stream, PreprocessFrame* frame,
+                                      PreprocessorItem* item, int i);
+// Location which the expansion of a define used at frame->tokens[i] is reported at
+TokenSpan token_stream_use_span(PreprocessFrame* frame, int i);
+// Expand the identifier at frame->tokens[i] if it is a define, returns false if it is not
+bool token_stream_expand_ident(TokenStream* stream, PreprocessFrame* frame, int i);
+// Push preprocessed tokens which stay owned by the caller, like a precompiled header
+void token_stream_push_tokens(TokenStream* stream, Tokens* tokens);
+PreprocessFrame preprocess_frame_new_tokens(PreprocessorTable* table, Tokens tokens,
+                                            bool owns_tokens);
+void token_stream_pop_frame(TokenStream* stream);
+// Add a token to the ring, or to the output while draining. Returns the span of the token
+TokenSpan* token_stream_emit(TokenStream* stream, Tokens* tokens, int i);
+void token_stream_emit_expanded(TokenStream* stream, PreprocessFrame* frame, int i);
+void token_stream_directive(TokenStream* stream, PreprocessFrame* frame);
+void token_stream_conditional(PreprocessFrame* frame, bool use_code);
+void token_stream_skip_conditional(PreprocessFrame* frame, int i);
 
 // =============== Preprocessor Table ===================
 // Create a new PreprocessorTable
@@ -84,22 +248,51 @@ PreprocessorTable preprocessor_table_new();
 // Free the memory of the PreprocessorTable
 void preprocessor_table_free(PreprocessorTable* table);
 
-// Lookup an element by name in the PreprocessorTable. Returns NULL if not found
-PreprocessorItem* preprocessor_table_lookup(PreprocessorTable* table, char* name);
+// Lookup a define or an included file by its interned name. Returns NULL if not found
+PreprocessorItem* preprocessor_table_lookup_define(PreprocessorTable* table, char* name);
+PreprocessorItem* preprocessor_table_lookup_file(PreprocessorTable* table, char* name);
 
 // Update the current directory which the file being preprocessed is in
 void preprocessor_table_update_current_dir(PreprocessorTable* table, char* filepath);
 
-// Get the current file directory
+// Get the included file item of the current file, NULL for the first file
 PreprocessorItem* preprocessor_table_get_current_file(PreprocessorTable* table);
 
-// Insert an element into the PreprocessorTable
+// Insert an element into the define, included file or include guard map, depending on its type.
+// An element with the same name is replaced
 void preprocessor_table_insert(PreprocessorTable* table, PreprocessorItem item);
 
-// Remove a potential element from the PreprocessorTable
+// Remove a potential define from the PreprocessorTable
 int preprocessor_table_remove(PreprocessorTable* table, char* name);
 
+// Record a file the preprocessed output depends on, if it has not been recorded yet
+void preprocessor_table_add_dependency(PreprocessorTable* table, char* path);
+
+// Make rule of the output file target, depending on the recorded files. Every dependency
+// other than the first file also gets an empty rule, so make does not fail when a header
+// is removed. The returned string is owned by the caller
+char* preprocessor_table_dependency_rule(PreprocessorTable* table, char* target);
+
 // Add a simple define. Used for compiler specific defines etc
 void preprocessor_table_add_simple_define(PreprocessorTable* table, char* name);
 
-void preprocess_error(char* error_message, PreprocessorTable* table);
\ No newline at end of file
+// A define item without parameters, with the interned name
+PreprocessorItem preprocessor_define_new(char* name, Tokens define_value_tokens);
+
+void preprocess_error(char* error_message, PreprocessorTable* table);
+
+// =============== Preprocessor Map ===================
+PreprocessorMap* preprocessor_map_new();
+void preprocessor_map_free(PreprocessorMap* map);
+
+// Lookup an item, returns NULL if it is not in the map or has been removed
+PreprocessorItem* preprocessor_map_lookup(PreprocessorMap* map, char* name);
+
+// Insert an item, replacing any item with the same name.
+// Replaced define value tokens are freed
+void preprocessor_map_insert(PreprocessorMap* map, PreprocessorItem item);
+
+// Helpers for the map
+int preprocessor_map_find_slot(PreprocessorMap* map, char* name);
+int preprocessor_map_hash(char* name);
+void preprocessor_map_grow(PreprocessorMap* map);
\ No newline at end of file
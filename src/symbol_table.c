@@ -13,14 +13,16 @@ SymbolTable* symbol_table_new() {
 void symbol_table_init(SymbolTable* table) {
     table->children_ptrs = malloc(sizeof(SymbolTable*));
     table->children_max_count = 1;
-    table->vars = calloc(1, sizeof(Variable));
+    table->vars = calloc(1, sizeof(Variable*));
     table->var_max_count = 1;
-    table->funcs = calloc(1, sizeof(Function));
+    table->funcs = calloc(1, sizeof(Function*));
     table->func_max_count = 1;
-    table->labels = calloc(1, sizeof(ValueLabel));
+    table->labels = calloc(1, sizeof(ValueLabel*));
     table->label_max_count = 1;
     table->objects = calloc(1, sizeof(Object));
     table->object_max_count = 1;
+    table->struct_layouts = calloc(1, sizeof(StructLayout*));
+    table->struct_layout_max_count = 1;
 }
 
 // Free the symbol table and its children
@@ -32,32 +34,41 @@ void symbol_table_free(SymbolTable* table) {
         free(table->children_ptrs);
     }
     for (size_t i = 0; i < table->var_count; i++) {
-        if (table->vars[i].const_expr) {
-            free(table->vars[i].const_expr);
+        if (table->vars[i]->const_expr) {
+            free(table->vars[i]->const_expr);
         }
+        free(table->vars[i]);
+    }
+    for (size_t i = 0; i < table->func_count; i++) {
+        free(table->funcs[i]);
+    }
+    for (size_t i = 0; i < table->label_count; i++) {
+        free(table->labels[i]);
     }
 
     free(table->vars);
     free(table->funcs);
     free(table->labels);
+    symbol_index_free(&table->var_index);
+    symbol_index_free(&table->func_index);
+    symbol_index_free(&table->object_index);
 
-    // Free the struct member linked list in VarType
-    for (size_t i = 0; i < table->object_count; i++) {
-        if (table->objects[i].type == OBJ_STRUCT) {
-            VarType* member = table->objects[i].first_struct_member;
-            VarType* prev_member;
-            while (member) {
-                prev_member = member;
-                member = prev_member->next_struct_member;
-                free(prev_member);
-            }
-        }
+    for (size_t i = 0; i < table->struct_layout_count; i++) {
+        struct_layout_free(table->struct_layouts[i]);
     }
+    free(table->struct_layouts);
 
     free(table->objects);
     free(table);
 }
 
+SymbolTable* symbol_table_global(SymbolTable* table) {
+    while (table->parent != NULL) {
+        table = table->parent;
+    }
+    return table;
+}
+
 // Child vector
 SymbolTable* symbol_table_create_child(SymbolTable* table, int stack_offset) {
     table->children_count++;
@@ -92,6 +103,7 @@ Variable variable_new() {
     var.type.array_has_initializer = false;
     var.is_undefined = false;
     var.const_expr_type = LT_INT;
+    var.struct_layout = NULL;
     return var;
 }
 
@@ -105,13 +117,10 @@ Variable symbol_table_lookup_var(SymbolTable* table, char* var_name) {
 }
 
 Variable* symbol_table_lookup_var_ptr(SymbolTable* table, char* var_name) {
-    // Linear search for now, should be a hashtable later
-    for (size_t i = 0; i < table->var_count; i++) {
-        Variable* var = &table->vars[i];
-        if (strcmp(var->name, var_name) == 0) {
-            // Found it!
-            return var;
-        }
+    int i = symbol_index_find(&table->var_index, var_name, 0);
+    if (i >= 0) {
+        // Found it!
+        return table->vars[i];
     }
     if (table->is_global) {
         // The referenced variable is not declared anywhere up
@@ -138,9 +147,8 @@ Variable* symbol_table_insert_var(SymbolTable* table, Variable var) {
             // FIXME: What if the first element is a struct? Same issue
             // Maybe store total struct size somewhere else?
             table->cur_stack_offset = align_stack_address(
-                table->cur_stack_offset, var.struct_type.first_struct_member->bytes);
-            table->cur_stack_offset += var.type.bytes -
-                                       var.struct_type.first_struct_member->bytes;
+                table->cur_stack_offset, var.struct_layout->alignment);
+            table->cur_stack_offset += var.type.bytes - var.struct_layout->alignment;
             var.stack_offset = table->cur_stack_offset;
         }
         else {
@@ -154,16 +162,20 @@ Variable* symbol_table_insert_var(SymbolTable* table, Variable var) {
         var.stack_offset = 0;
     }
     var.is_global = table->is_global;
-    static int unique_id = 0;
-    var.unique_id = unique_id++;
+    SymbolTable* global_table = symbol_table_global(table);
+    var.unique_id = global_table->next_var_id;
+    global_table->next_var_id++;
     var.const_expr = NULL;
     var.const_expr_type = LT_INT;
-    table->vars[table->var_count - 1] = var;
-    return table->vars + table->var_count - 1;
+    Variable* var_ptr = malloc(sizeof(Variable));
+    *var_ptr = var;
+    table->vars[table->var_count - 1] = var_ptr;
+    symbol_index_add(&table->var_index, var.name, 0, table->var_count - 1);
+    return var_ptr;
 }
 
 void symbol_table_vars_realloc(SymbolTable* table, int new_size) {
-    table->vars = realloc(table->vars, sizeof(Variable) * new_size);
+    table->vars = realloc(table->vars, sizeof(Variable*) * new_size);
     table->var_max_count = new_size;
 }
 
@@ -180,12 +192,14 @@ int symbol_table_get_max_stack_space(SymbolTable* table) {
 // ================ Functions ==================
 
 Function symbol_table_lookup_func(SymbolTable* table, char* func_name) {
-    for (size_t i = 0; i < table->func_count; i++) {
-        Function* func = &table->funcs[i];
-        if (strcmp(func->name, func_name) == 0) {
-            // Found it!
-            return *func;
-        }
+    return *symbol_table_lookup_func_ptr(table, func_name);
+}
+
+Function* symbol_table_lookup_func_ptr(SymbolTable* table, char* func_name) {
+    int i = symbol_index_find(&table->func_index, func_name, 0);
+    if (i >= 0) {
+        // Found it!
+        return table->funcs[i];
     }
     if (table->is_global) {
         // The referenced function is not declared anywhere up
@@ -193,7 +207,7 @@ Function symbol_table_lookup_func(SymbolTable* table, char* func_name) {
         symbol_error2(func_name, "function referenced but never declared!");
     }
     // We did not find the variable in this scope, go up a scope
-    return symbol_table_lookup_func(table->parent, func_name);
+    return symbol_table_lookup_func_ptr(table->parent, func_name);
 }
 
 // Insert a variable in this scope of the symbol table
@@ -204,25 +218,25 @@ Function* symbol_table_insert_func(SymbolTable* table, Function func) {
     func.is_builtin = false;
     func.builtin_type = BUILTIN_NONE;
     // Check if this function already exists, if so, overwrite it
-    for (size_t i = 0; i < table->func_count; i++) {
-        Function* lookup_func = &table->funcs[i];
-        if (strcmp(lookup_func->name, func.name) == 0) {
-            // We already have a function of this name, overwrite it
-            *lookup_func = func;
-            return lookup_func;
-        }
+    int i = symbol_index_find(&table->func_index, func.name, 0);
+    if (i >= 0) {
+        *table->funcs[i] = func;
+        return table->funcs[i];
     }
     // Otherwise, create new entry
     table->func_count++;
     if (table->func_count > table->func_max_count) {
         symbol_table_funcs_realloc(table, table->func_max_count * 2);
     }
-    table->funcs[table->func_count - 1] = func;
-    return table->funcs + table->func_count - 1;
+    Function* func_ptr = malloc(sizeof(Function));
+    *func_ptr = func;
+    table->funcs[table->func_count - 1] = func_ptr;
+    symbol_index_add(&table->func_index, func.name, 0, table->func_count - 1);
+    return func_ptr;
 }
 
 void symbol_table_funcs_realloc(SymbolTable* table, int new_size) {
-    table->funcs = realloc(table->funcs, sizeof(Function) * new_size);
+    table->funcs = realloc(table->funcs, sizeof(Function*) * new_size);
     table->func_max_count = new_size;
 }
 
@@ -254,7 +268,7 @@ ValueLabel* symbol_table_lookup_switch_case_labels(SymbolTable* table) {
 
 void symbol_table_find_labels_recursively(SymbolTable* table, ValueLabel* cur_label) {
     for (size_t i = 0; i < table->label_count; i++) {
-        ValueLabel* label = &table->labels[i];
+        ValueLabel* label = table->labels[i];
         cur_label->next = label;
         cur_label = label;
     }
@@ -267,21 +281,22 @@ void symbol_table_find_labels_recursively(SymbolTable* table, ValueLabel* cur_la
     }
 }
 
-int cur_value_label_id = 0;
-
-ValueLabel symbol_table_insert_label(SymbolTable* table, ValueLabel label) {
+ValueLabel* symbol_table_insert_label(SymbolTable* table, ValueLabel label) {
     table->label_count++;
     if (table->label_count > table->label_max_count) {
         symbol_table_labels_realloc(table, table->label_max_count * 2);
     }
-    cur_value_label_id++;
-    label.id = cur_value_label_id;
-    table->labels[table->label_count - 1] = label;
-    return label;
+    SymbolTable* global_table = symbol_table_global(table);
+    global_table->next_label_id++;
+    label.id = global_table->next_label_id;
+    ValueLabel* label_ptr = malloc(sizeof(ValueLabel));
+    *label_ptr = label;
+    table->labels[table->label_count - 1] = label_ptr;
+    return label_ptr;
 }
 
 void symbol_table_labels_realloc(SymbolTable* table, int new_size) {
-    table->labels = realloc(table->labels, sizeof(ValueLabel) * new_size);
+    table->labels = realloc(table->labels, sizeof(ValueLabel*) * new_size);
     table->label_max_count = new_size;
 }
 
@@ -294,7 +309,7 @@ void symbol_table_insert_builtin_funcs(SymbolTable* table) {
     func.return_type.type = TY_VOID;
     func.is_defined = true;
     for (size_t i = 0; i < 2; i++) {
-        func.name = builtin_names[i];
+        func.name = intern_str(builtin_names[i]);
         func.def_param_count = builtin_arg_count[i];
         Function* func_ptr = symbol_table_insert_func(table, func);
         func_ptr->is_builtin = true;
@@ -306,13 +321,10 @@ void symbol_table_insert_builtin_funcs(SymbolTable* table) {
 
 Object* symbol_table_lookup_object(SymbolTable* table, char* object_name,
                                    ObjectTypeEnum type) {
-    // Linear search for now, should be a hashtable later
-    for (size_t i = 0; i < table->object_count; i++) {
-        Object* object = &table->objects[i];
-        if (object->type == type && strcmp(object->name, object_name) == 0) {
-            // Found it!
-            return object;
-        }
+    int i = symbol_index_find(&table->object_index, object_name, type);
+    if (i >= 0) {
+        // Found it!
+        return &table->objects[i];
     }
     if (table->is_global) {
         return NULL;
@@ -327,23 +339,150 @@ Object symbol_table_insert_object(SymbolTable* table, Object object) {
         symbol_table_objects_realloc(table, table->object_max_count * 2);
     }
     table->objects[table->object_count - 1] = object;
+    symbol_index_add(&table->object_index, object.name, object.type,
+                     table->object_count - 1);
     return object;
 }
 
-VarType* symbol_table_struct_lookup_member(Object struct_obj, char* member_name) {
-    VarType* member = struct_obj.first_struct_member;
-    while (member) {
-        if (strcmp(member->struct_member_name, member_name) == 0) {
-            return member;
+void symbol_table_objects_realloc(SymbolTable* table, int new_size) {
+    table->objects = realloc(table->objects, sizeof(Object) * new_size);
+    table->object_max_count = new_size;
+}
+
+// ============== Struct layouts ===============
+
+StructLayout* symbol_table_new_struct_layout(SymbolTable* table, char* name) {
+    StructLayout* layout = calloc(1, sizeof(StructLayout));
+    layout->name = name;
+    layout->members = calloc(1, sizeof(VarType));
+    layout->member_max_count = 1;
+    table->struct_layout_count++;
+    if (table->struct_layout_count > table->struct_layout_max_count) {
+        table->struct_layout_max_count *= 2;
+        int new_size = table->struct_layout_max_count * sizeof(StructLayout*);
+        table->struct_layouts = realloc(table->struct_layouts, new_size);
+    }
+    table->struct_layouts[table->struct_layout_count - 1] = layout;
+    return layout;
+}
+
+VarType* struct_layout_add_member(StructLayout* layout, VarType member) {
+    layout->member_count++;
+    if (layout->member_count > layout->member_max_count) {
+        layout->member_max_count *= 2;
+        layout->members =
+            realloc(layout->members, sizeof(VarType) * layout->member_max_count);
+    }
+    layout->members[layout->member_count - 1] = member;
+    symbol_index_add(&layout->member_index, member.struct_member_name, 0,
+                     layout->member_count - 1);
+    return &layout->members[layout->member_count - 1];
+}
+
+VarType* struct_layout_lookup_member(StructLayout* layout, char* member_name) {
+    if (layout == NULL) {
+        return NULL;
+    }
+    int i = symbol_index_find(&layout->member_index, member_name, 0);
+    if (i < 0) {
+        return NULL;
+    }
+    return &layout->members[i];
+}
+
+int variable_struct_bytes(Variable* var) {
+    if (var->struct_layout == NULL) {
+        return 0;
+    }
+    return var->struct_layout->bytes;
+}
+
+void struct_layout_free(StructLayout* layout) {
+    free(layout->members);
+    symbol_index_free(&layout->member_index);
+    free(layout);
+}
+
+// ================ Symbol index ===============
+
+int symbol_index_find(SymbolIndex* index, char* name, int kind) {
+    if (index->capacity == 0) {
+        return -1;
+    }
+    int mask = index->capacity - 1;
+    int slot = symbol_index_hash(name, kind) & mask;
+    while (index->names[slot] != NULL) {
+        if (index->names[slot] == name && index->kinds[slot] == kind) {
+            return index->symbols[slot];
         }
-        member = member->next_struct_member;
+        slot = (slot + 1) & mask;
     }
-    return NULL;
+    return -1;
 }
 
-void symbol_table_objects_realloc(SymbolTable* table, int new_size) {
-    table->objects = realloc(table->objects, sizeof(Object) * new_size);
-    table->object_max_count = new_size;
+void symbol_index_add(SymbolIndex* index, char* name, int kind, int symbol) {
+    // Keep the load factor at most 1/2, so probe sequences stay short
+    if ((index->size + 1) * 2 > index->capacity) {
+        symbol_index_grow(index);
+    }
+    int mask = index->capacity - 1;
+    int slot = symbol_index_hash(name, kind) & mask;
+    while (index->names[slot] != NULL) {
+        if (index->names[slot] == name && index->kinds[slot] == kind) {
+            // Lookups find the first symbol with the name, so it is not replaced
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    index->names[slot] = name;
+    index->kinds[slot] = kind;
+    index->symbols[slot] = symbol;
+    index->size++;
+}
+
+void symbol_index_grow(SymbolIndex* index) {
+    int old_capacity = index->capacity;
+    char** old_names = index->names;
+    int* old_kinds = index->kinds;
+    int* old_symbols = index->symbols;
+    index->capacity = old_capacity * 2;
+    if (index->capacity == 0) {
+        index->capacity = SYMBOL_INDEX_INITIAL_CAPACITY;
+    }
+    index->names = calloc(index->capacity, sizeof(char*));
+    index->kinds = malloc(sizeof(int) * index->capacity);
+    index->symbols = malloc(sizeof(int) * index->capacity);
+    index->size = 0;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_names[i] != NULL) {
+            symbol_index_add(index, old_names[i], old_kinds[i], old_symbols[i]);
+        }
+    }
+    if (old_capacity != 0) {
+        free(old_names);
+        free(old_kinds);
+        free(old_symbols);
+    }
+}
+
+void symbol_index_free(SymbolIndex* index) {
+    if (index->capacity != 0) {
+        free(index->names);
+        free(index->kinds);
+        free(index->symbols);
+    }
+    index->size = 0;
+    index->capacity = 0;
+}
+
+int symbol_index_hash(char* name, int kind) {
+    // Names are interned, so the pointer identifies the name. Interned names are packed
+    // next to each other in the pool, so every bit of the pointer is mixed in with a
+    // multiplicative hash. The multiplier is the 64 bit golden ratio constant, negated
+    // to fit in a long. The high half of the product depends on all bits of the pointer
+    unsigned long hash = (unsigned long)name * 7046029254386353131;
+    hash = (hash >> 32) & 1073741823;
+    return (int)hash ^ kind;
 }
 
 // ================= Other =====================
@@ -2,9 +2,12 @@
 // Each scope has its own symbol table and is linked to the parent scope.
 // Then every scope has an inherent stack offset, which determines local variables location
 // on the stack
-// To find a variable, first search the current scope and traverse all the way to the top
+// To find a variable, first search the current scope and traverse all the way to the top.
+// Every scope has a hash index of its variables, functions and objects, so a scope
+// is searched in constant time no matter how many symbols it has
 // The symbol table is a tree of scopes. Every time a new scope is made, I make a new child
 // Global scope -> function scope -> block scope etc
+// All symbol names are interned, so names are compared by pointer
 
 #pragma once
 #include <stdbool.h>
@@ -15,6 +18,7 @@
 #include <unistd.h>
 
 #include "util/string_helpers.h"
+#include "util/intern.h"
 
 // Represents a literal type
 enum LiteralType {
@@ -48,6 +52,7 @@ typedef enum ObjectTypeEnum ObjectTypeEnum;
 typedef enum BuiltinFuncEnum BuiltinFuncEnum;
 
 typedef struct VarType VarType;
+typedef struct StructLayout StructLayout;
 
 // Represents a variable type (ex int)
 struct VarType {
@@ -66,8 +71,7 @@ struct VarType {
 
     // Struct type information
     char* struct_name;
-    // Keep track of the members of the struct
-    VarType* next_struct_member;
+    // Members of a struct, the member types are stored in the layout of the struct
     char* struct_member_name;
     int struct_bytes_offset;
     bool is_struct_member;
@@ -87,7 +91,7 @@ struct Object { // Structs, unions, enums, typedefs etc
     VarType typedef_type;
     // Struct related
     VarType struct_type;
-    VarType* first_struct_member;
+    StructLayout* layout;
 };
 
 typedef struct Object Object;
@@ -105,7 +109,7 @@ struct Variable {
     char* const_expr;
     LiteralType const_expr_type;
     int unique_id;
-    Object struct_type;
+    StructLayout* struct_layout; // Layout of struct variables, owned by the symbol table
 };
 
 typedef struct Variable Variable;
@@ -115,10 +119,7 @@ struct Function {
     char* name;
     VarType return_type;
     int def_param_count;
-    int call_param_count;
-    int call_int_param_count;
-    int call_float_param_count;
-    Variable* params;
+    Variable** params; // Parameter variables in the symbol table of the function
     int stack_space_used;
     bool is_defined; // Has this function been defined? Otherwise, declare as extern
     bool is_variadic;
@@ -143,6 +144,32 @@ struct ValueLabel {
     long padding3;
 };
 
+#define SYMBOL_INDEX_INITIAL_CAPACITY 8
+
+// Open addressing hash index from interned names to the symbols of a scope vector.
+// Only the first symbol with a name and kind is indexed, like a linear search would find
+struct SymbolIndex {
+    int size;
+    int capacity; // Power of two, 0 until the first symbol is added
+    char** names; // Name of every slot, NULL if the slot is empty
+    int* kinds; // Object type of every slot, 0 for variables and functions
+    int* symbols; // Index of the symbol in the scope vector
+};
+
+typedef struct SymbolIndex SymbolIndex;
+
+// Layout of a struct definition, computed once when the definition is parsed.
+// The members are stored in declaration order and indexed by name
+struct StructLayout {
+    char* name; // NULL for unnamed structs
+    int bytes;
+    int alignment; // Bytes of the first member, struct variables are aligned to it
+    int member_count;
+    int member_max_count;
+    VarType* members;
+    SymbolIndex member_index;
+};
+
 typedef struct SymbolTable SymbolTable;
 
 // This is a tree of tables
@@ -152,32 +179,45 @@ struct SymbolTable {
     int label_prefix;
     int cur_stack_offset;
     SymbolTable* parent;
+    // Id counters of variables and value labels, only the global table's are used so
+    // ids are unique within one parse without any process-wide state
+    int next_var_id;
+    int next_label_id;
 
     // Vector of pointers to the children. This might be better as a linked list?
     int children_count;
     int children_max_count;
     SymbolTable** children_ptrs;
 
-    // Variable vector. This should later be a hashtable
+    // Variable vector. Every variable is allocated separately, so AST nodes can point
+    // to it while more variables are added
     int var_count;
     int var_max_count;
-    Variable* vars;
+    Variable** vars;
+    SymbolIndex var_index;
 
     // Function vector. At first this will only be in the global scope,
     // but later I should implement local functions
     int func_count;
     int func_max_count;
-    Function* funcs;
+    Function** funcs;
+    SymbolIndex func_index;
 
     // Value Label vector (switch cases)
     int label_count;
     int label_max_count;
-    ValueLabel* labels;
+    ValueLabel** labels;
 
     // Object vector (struct, union, enums, typedef)
     int object_count;
     int object_max_count;
     Object* objects;
+    SymbolIndex object_index;
+
+    // Layouts of the structs defined in this scope, named or not
+    int struct_layout_count;
+    int struct_layout_max_count;
+    StructLayout** struct_layouts;
 };
 
 // Helpers for reporting symbol errors
@@ -195,6 +235,9 @@ void symbol_table_init(SymbolTable* table);
 // Free the symbol table and its children
 void symbol_table_free(SymbolTable* table);
 
+// The global scope at the top of the table
+SymbolTable* symbol_table_global(SymbolTable* table);
+
 // ================ Variables ==================
 // Lookup a variable in the symbol table
 // If not found in this scope, traverse up the scopes until found
@@ -208,8 +251,6 @@ Variable* symbol_table_insert_var(SymbolTable* table, Variable var);
 
 void symbol_table_vars_realloc(SymbolTable* table, int new_size);
 
-Variable* symbol_table_get_function_args(SymbolTable* table);
-
 // Get the max stack space recursively used by the symbol table and all children
 int symbol_table_get_max_stack_space(SymbolTable* table);
 
@@ -241,7 +282,7 @@ ValueLabel* symbol_table_lookup_switch_case_labels(SymbolTable* table);
 // Helper for above
 void symbol_table_find_labels_recursively(SymbolTable* table, ValueLabel* cur_label);
 
-ValueLabel symbol_table_insert_label(SymbolTable* table, ValueLabel label);
+ValueLabel* symbol_table_insert_label(SymbolTable* table, ValueLabel label);
 
 void symbol_table_labels_realloc(SymbolTable* table, int new_size);
 
@@ -254,7 +295,34 @@ Object symbol_table_insert_object(SymbolTable* table, Object object);
 
 void symbol_table_objects_realloc(SymbolTable* table, int new_size);
 
-VarType* symbol_table_struct_lookup_member(Object struct_obj, char* member_name);
+// ============== Struct layouts ===============
+
+// Create an empty struct layout, owned by this scope
+StructLayout* symbol_table_new_struct_layout(SymbolTable* table, char* name);
+
+// Add a member to the end of a struct, the offset of the member has to be set
+VarType* struct_layout_add_member(StructLayout* layout, VarType member);
+
+// Member of a struct by name, NULL if the struct has no such member
+VarType* struct_layout_lookup_member(StructLayout* layout, char* member_name);
+
+// Size of the struct of a variable, 0 if the variable has no struct layout
+int variable_struct_bytes(Variable* var);
+
+void struct_layout_free(StructLayout* layout);
+
+// ================ Symbol index ===============
+// Index of the symbol with a name and kind, -1 if it is not in the index
+int symbol_index_find(SymbolIndex* index, char* name, int kind);
+
+// Add a symbol, unless a symbol with the same name and kind is already indexed
+void symbol_index_add(SymbolIndex* index, char* name, int kind, int symbol);
+
+void symbol_index_free(SymbolIndex* index);
+
+// Helpers for the index
+int symbol_index_hash(char* name, int kind);
+void symbol_index_grow(SymbolIndex* index);
 
 // =============== Tree related ================
 SymbolTable* symbol_table_create_child(SymbolTable* table, int stack_offset);
@@ -0,0 +1,235 @@
+#include "token_cache.h"
+
+// Directory of the cache entries, NULL if the cache is disabled
+static char* cache_dir = NULL;
+static int cache_hits = 0;
+static int cache_misses = 0;
+static long tokenize_us = 0;
+
+void token_cache_set_dir(char* dir) {
+    cache_dir = dir;
+}
+
+bool token_cache_enabled() {
+    return cache_dir != NULL;
+}
+
+Tokens token_cache_tokenize(int file_id) {
+    long start = time_now_us();
+    SourceFile* file = source_file_get(file_id);
+    if (cache_dir == NULL || file->path == NULL) {
+        Tokens tokens = tokenize_source_file(file_id);
+        tokenize_us += time_now_us() - start;
+        return tokens;
+    }
+    char* path = token_cache_entry_path(file);
+    Tokens tokens = tokens_new(0);
+    if (token_cache_read(path, file, file_id, &tokens)) {
+        cache_hits++;
+    }
+    else {
+        tokens_free(&tokens);
+        tokens = tokenize_source_file(file_id);
+        token_cache_write(path, file, &tokens);
+        cache_misses++;
+    }
+    free(path);
+    tokenize_us += time_now_us() - start;
+    return tokens;
+}
+
+int token_cache_hits() {
+    return cache_hits;
+}
+
+int token_cache_misses() {
+    return cache_misses;
+}
+
+long token_cache_tokenize_us() {
+    return tokenize_us;
+}
+
+char* token_cache_entry_path(SourceFile* file) {
+    unsigned long hash = token_cache_hash(file->src, file->size);
+    char* path = malloc(strlen(cache_dir) + 64);
+    sprintf(path, "%s/%d-%lu.tok", cache_dir, file->size, hash);
+    return path;
+}
+
+long token_cache_hash(char* src, int size) {
+    // The FNV offset basis 14695981039346656037 does not fit a long, so it is written
+    // as the negative long with the same bits
+    unsigned long hash = -3750763034362895579;
+    for (int i = 0; i < size; i++) {
+        hash = (hash ^ (((int)src[i]) & 255)) * 1099511628211;
+    }
+    return (long)hash;
+}
+
+bool token_cache_read(char* path, SourceFile* file, int file_id, Tokens* tokens) {
+    // Entries are read instead of mapped, as they are only needed until the tokens are copied
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    int size = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    char* entry = malloc(size + 4);
+    if (read(fd, entry, size) != size) {
+        size = 0;
+    }
+    close(fd);
+
+    bool is_valid = token_cache_validate(entry, size, file);
+    if (is_valid) {
+        int* header = (int*)entry;
+        int count = header[3];
+        int* offsets = header + TOKEN_CACHE_HEADER_INTS;
+        int* lengths = offsets + count;
+        int* text_offsets = lengths + count;
+        int* conditionals = text_offsets + count;
+        char* types = (char*)(conditionals + header[5]);
+        char* text = types + count;
+        tokens_reserve(tokens, count + 1);
+        vec_resize(&tokens->types, count);
+        vec_resize(&tokens->spans, count);
+        vec_resize(&tokens->texts, count);
+        tokens->size = count;
+        TokenType* token_types = tokens->types.elems;
+        TokenSpan* token_spans = tokens->spans.elems;
+        char** texts = tokens->texts.elems;
+        for (int i = 0; i < count; i++) {
+            token_types[i] = types[i];
+            token_spans[i].file_id = file_id;
+            token_spans[i].offset = offsets[i];
+            token_spans[i].length = lengths[i];
+            if (text_offsets[i] >= 0) {
+                texts[i] = intern_str(text + text_offsets[i]);
+            }
+            else {
+                texts[i] = NULL;
+            }
+        }
+        tokens_drop_conditionals(tokens);
+        tokens->conditionals = vec_new(sizeof(int), header[5] + 2);
+        for (int i = 0; i < header[5]; i++) {
+            vec_push(&tokens->conditionals, &conditionals[i]);
+        }
+    }
+
+    free(entry);
+    return is_valid;
+}
+
+bool token_cache_validate(char* entry, int size, SourceFile* file) {
+    int* header = (int*)entry;
+    if (size < TOKEN_CACHE_HEADER_INTS * 4 || header[0] != TOKEN_CACHE_MAGIC ||
+        header[1] != TOKEN_CACHE_VERSION || header[2] != file->size) {
+        return false;
+    }
+    int count = header[3];
+    int text_size = header[4];
+    int conditional_count = header[5];
+    if (count < 0 || text_size < 0 || conditional_count < 0) {
+        return false;
+    }
+    // Entries which were cut short are tokenized again. The size is computed with longs,
+    // so corrupt counts can not wrap it around to the entry size
+    long ints = TOKEN_CACHE_HEADER_INTS + (long)count * TOKEN_CACHE_TOKEN_INTS +
+                conditional_count;
+    if (size != ints * 4 + count + text_size + file->size) {
+        return false;
+    }
+    int* offsets = header + TOKEN_CACHE_HEADER_INTS;
+    int* lengths = offsets + count;
+    int* text_offsets = lengths + count;
+    int* conditionals = text_offsets + count;
+    char* types = (char*)(conditionals + conditional_count);
+    char* text = types + count;
+    char* src = text + text_size;
+    if (memcmp(src, file->src, file->size) != 0) {
+        return false;
+    }
+    // The last text is null terminated, so every text offset in the text starts a string
+    // which ends within it
+    if (text_size > 0 && text[text_size - 1] != '\0') {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (offsets[i] < 0 || lengths[i] < 0 || lengths[i] > file->size - offsets[i]) {
+            return false;
+        }
+        if (text_offsets[i] < -1 || text_offsets[i] >= text_size) {
+            return false;
+        }
+        // TK_PP_HASHHASH is the last token type
+        if (types[i] < 0 || types[i] > TK_PP_HASHHASH) {
+            return false;
+        }
+    }
+    // The #endif of a conditional is -1 if it was not found
+    for (int i = 0; i < conditional_count; i++) {
+        if (conditionals[i] < -1 || conditionals[i] >= count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void token_cache_write(char* path, SourceFile* file, Tokens* tokens) {
+    int header[TOKEN_CACHE_HEADER_INTS];
+    header[0] = TOKEN_CACHE_MAGIC;
+    header[1] = TOKEN_CACHE_VERSION;
+    header[2] = file->size;
+    header[3] = tokens->size;
+    Vec offsets = vec_new(sizeof(int), tokens->size + 1);
+    Vec lengths = vec_new(sizeof(int), tokens->size + 1);
+    Vec text_offsets = vec_new(sizeof(int), tokens->size + 1);
+    Vec types = vec_new(sizeof(char), tokens->size + 1);
+    Vec text = vec_new(sizeof(char), 1024);
+    char** texts = tokens->texts.elems;
+    for (int i = 0; i < tokens->size; i++) {
+        TokenSpan* span = tokens_get_span(tokens, i);
+        vec_push(&offsets, &span->offset);
+        vec_push(&lengths, &span->length);
+        char type = tokens_get_type(tokens, i);
+        vec_push(&types, &type);
+        // The tokenizer only sets the text of preprocessor directives
+        int text_offset = -1;
+        if (texts[i] != NULL) {
+            text_offset = text.size;
+            int length = strlen(texts[i]);
+            for (int j = 0; j <= length; j++) {
+                vec_push(&text, &texts[i][j]);
+            }
+        }
+        vec_push(&text_offsets, &text_offset);
+    }
+    header[4] = text.size;
+    header[5] = tokens->conditionals.size;
+
+    // Entries are written to a temporary file and renamed, so concurrent compiles
+    // never read a partially written entry
+    char* tmp_path = malloc(strlen(path) + 32);
+    sprintf(tmp_path, "%s.%d.tmp", path, getpid());
+    FILE* entry_file = fopen(tmp_path, "wb");
+    if (entry_file != NULL) {
+        fwrite(header, sizeof(int), TOKEN_CACHE_HEADER_INTS, entry_file);
+        fwrite(offsets.elems, sizeof(int), offsets.size, entry_file);
+        fwrite(lengths.elems, sizeof(int), lengths.size, entry_file);
+        fwrite(text_offsets.elems, sizeof(int), text_offsets.size, entry_file);
+        fwrite(tokens->conditionals.elems, sizeof(int), tokens->conditionals.size, entry_file);
+        fwrite(types.elems, 1, types.size, entry_file);
+        fwrite(text.elems, 1, text.size, entry_file);
+        fwrite(file->src, 1, file->size, entry_file);
+        fclose(entry_file);
+        rename(tmp_path, path);
+    }
+    free(tmp_path);
+    vec_free(&offsets);
+    vec_free(&lengths);
+    vec_free(&text_offsets);
+    vec_free(&types);
+    vec_free(&text);
+}
@@ -0,0 +1,64 @@
+// Token cache
+// The tokens of source files can be cached in a directory, so files which have not
+// changed are not tokenized again by later compiles. The cache is opt-in, and entries
+// are named after the size and a 64 bit content hash of the file. An entry also holds
+// a copy of the source, which has to match the file, so a hash collision never
+// substitutes the tokens of another file.
+// Loaded tokens refer to the source file like tokenized tokens, so only the token
+// types, spans and preprocessor directive texts are stored. Every offset read from an
+// entry is checked against the sizes in its header before it is used.
+
+// Entry layout, the numbers are ints:
+//      magic, version, source size, token count, text size, conditional index size
+//      span offsets, span lengths and text offsets (-1 if no text) of the tokens
+//      conditional index of the tokenizer, (#ifdef/#ifndef index, #endif index) pairs
+//      token types, one char each as there are fewer than 128 token types
+//      text, the null terminated texts of the tokens which have one
+//      source, the content of the file the tokens were made from
+
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/vector.h"
+#include "util/intern.h"
+#include "util/file_helpers.h"
+#include "util/timing.h"
+#include "tokens.h"
+
+#define TOKEN_CACHE_MAGIC 1414219587
+// Increment when the tokenizer or the entry layout changes, to invalidate old entries
+#define TOKEN_CACHE_VERSION 4
+// Number of ints before the tokens of an entry, and per token
+#define TOKEN_CACHE_HEADER_INTS 6
+#define TOKEN_CACHE_TOKEN_INTS 3
+
+// Enable the cache with the directory to store entries in, which has to exist
+void token_cache_set_dir(char* dir);
+bool token_cache_enabled();
+
+// Tokenize a source file opened from disk, reusing the cached tokens if the cache has
+// an entry for its content. Otherwise the file is tokenized and an entry is written.
+// Without a cache directory this is the same as tokenize_source_file
+Tokens token_cache_tokenize(int file_id);
+
+// Number of files loaded from the cache and tokenized, during the whole compilation
+int token_cache_hits();
+int token_cache_misses();
+// Time spent in token_cache_tokenize during the whole compilation, with or without a
+// cache directory, in microseconds
+long token_cache_tokenize_us();
+
+// Path of the cache entry of a source file, the returned string is owned by the caller
+char* token_cache_entry_path(SourceFile* file);
+
+// 64 bit FNV-1a hash of the content of a file, which names its entry
+long token_cache_hash(char* src, int size);
+
+// Load the tokens of an entry, returns false if there is no valid entry for the file
+bool token_cache_read(char* path, SourceFile* file, int file_id, Tokens* tokens);
+// Check that the sizes and offsets of an entry of size bytes are in bounds, and that
+// its source copy matches the file
+bool token_cache_validate(char* entry, int size, SourceFile* file);
+void token_cache_write(char* path, SourceFile* file, Tokens* tokens);
@@ -1,604 +1,835 @@
 #include "tokens.h"
+#include "keyword_hash.h"
 
 /*
 Implement tokenization of Hex int values
 */
 
+// Every source buffer loaded during compilation, indexed by file id
+static Vec* source_files = NULL;
+
+// The line information of source files is built on first use, and code generation
+// threads look it up, so it is locked. A CCIC build has no threads
+#ifndef CCIC
+#include <pthread.h>
+static pthread_mutex_t source_lines_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void source_lines_lock() {
+    pthread_mutex_lock(&source_lines_mutex);
+}
+
+void source_lines_unlock() {
+    pthread_mutex_unlock(&source_lines_mutex);
+}
+#endif
+#ifdef CCIC
+void source_lines_lock() {
+}
+
+void source_lines_unlock() {
+}
+#endif
+
 Tokens tokenize(char* src, bool tag_debug_line_info) {
-    // Split up src in lines
-    //StrVector lines = str_split(src, '\n');
+    // Tokens refer back into the source, which is kept with the other source files
+    return tokenize_source_file(source_file_new(src, tag_debug_line_info));
+}
+
+Tokens tokenize_source_file(int file_id) {
+    // Tokens are appended as they are recognized
+    Tokens tokens = tokens_new(0);
+    tokens_reserve(&tokens, TOKENS_INITIAL_CAPACITY);
 
-    int total_lines_length = 0;
-    StrVector lines = str_split_lines(src);
-    for (size_t i = 0; i < lines.size; i++) {
-        char* new_str = str_strip(lines.elems[i]);
-        free(lines.elems[i]);
-        lines.elems[i] = new_str;
-        total_lines_length += strlen(new_str);
+    // Tokenize everything in a single pass over the lines
+    Tokenizer tokenizer;
+    tokenizer_init(&tokenizer, &tokens, file_id);
+    // The whole file is tokenized, so the conditional blocks can be indexed
+    tokens.conditionals = vec_new(sizeof(int), 16);
+    tokenizer.index_conditionals = true;
+    tokenizer.open_conditionals = vec_new(sizeof(int), 16);
+    while (tokenize_next_line(&tokenizer)) {
     }
+    vec_free(&tokenizer.open_conditionals);
+    return tokens;
+}
 
-    Tokens tokens = tokens_new(total_lines_length + 1);
+Tokens tokenize_define_value(char* src) {
+    Tokens tokens = tokens_new(0);
+    tokens_reserve(&tokens, TOKENS_INITIAL_CAPACITY);
+    Tokenizer tokenizer;
+    tokenizer_init(&tokenizer, &tokens, source_file_new(src, false));
+    // Define values are a single line, which is tokenized without checking for a directive
+    tokenize_find_line(&tokenizer, tokenizer.src);
+    char* str = tokenizer.line;
+    while (str < tokenizer.line_end) {
+        str = tokenize_next(&tokenizer, str);
+    }
+    return tokens;
+}
 
-    // Tag every token with the connected code line
-    if (tag_debug_line_info) {
-        tag_tokens_with_src_lines(&tokens, &lines);
+// ================ Source files ===================
+
+int source_file_new(char* src, bool tag_debug_line_info) {
+    return source_file_add(scan_padded_copy(src), strlen(src), tag_debug_line_info);
+}
+
+int source_file_open(char* path, bool tag_debug_line_info) {
+    path = intern_str(path);
+    // Headers included several times share the same mapping
+    if (source_files != NULL) {
+        for (size_t i = 0; i < source_files->size; i++) {
+            if (source_file_get(i)->path == path) {
+                return i;
+            }
+        }
     }
+    int size;
+    char* src = map_file_to_string(path, &size);
+    bool is_mapped = src != NULL;
+    if (!is_mapped) {
+        src = load_file_to_string(path);
+    }
+    int file_id = source_file_add(src, size, tag_debug_line_info);
+    SourceFile* file = source_file_get(file_id);
+    file->path = path;
+    file->is_mapped = is_mapped;
+    return file_id;
+}
 
-    // Set last token to EOF
-    tokens_get(&tokens, tokens.size - 1)->type = TK_EOF;
+int source_file_add(char* src, int size, bool tag_debug_line_info) {
+    if (source_files == NULL) {
+        source_files = vec_new_dyn(sizeof(SourceFile));
+    }
+    SourceFile file;
+    file.filename = NULL;
+    file.path = NULL;
+    file.src = src;
+    file.size = size;
+    file.is_mapped = false;
+    file.tag_debug_line_info = tag_debug_line_info;
+    // Line information is only needed for diagnostics and debug tagging,
+    // so the line index is built on the first lookup
+    file.line_offsets.elems = NULL;
+    file.line_strs.elems = NULL;
+    vec_push(source_files, &file);
+    return source_files->size - 1;
+}
 
-    //str_vec_print(&lines);
+int source_file_count() {
+    if (source_files == NULL) {
+        return 0;
+    }
+    return source_files->size;
+}
 
-    tokenize_comments(&tokens, &lines);
-    tokenize_preprocessor(&tokens, &lines);
-    tokenize_strings(&tokens, &lines);
-    tokenize_keywords(&tokens, &lines);
-    tokenize_ops(&tokens, &lines);
-    tokenize_idents(&tokens, &lines);
-    tokenize_values(&tokens, &lines);
-    tokenize_delims(&tokens, &lines);
+SourceFile* source_file_get(int file_id) {
+    return vec_get(source_files, file_id);
+}
 
-    //str_vec_print(&lines);
+void source_files_free() {
+    if (source_files == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < source_files->size; i++) {
+        SourceFile* file = source_file_get(i);
+        if (file->is_mapped) {
+            unmap_file(file->src, file->size);
+        }
+        else {
+            free(file->src);
+        }
+        if (file->line_offsets.elems != NULL) {
+            char** line_strs = file->line_strs.elems;
+            for (size_t j = 0; j < file->line_strs.size; j++) {
+                if (line_strs[j] != NULL) {
+                    free(line_strs[j]);
+                }
+            }
+            vec_free(&file->line_offsets);
+            vec_free(&file->line_strs);
+        }
+    }
+    vec_free(source_files);
+    free(source_files);
+    source_files = NULL;
+}
 
-    //tokens_print(&tokens);
+int source_file_get_line(int file_id, int offset) {
+    source_lines_lock();
+    int line = source_file_find_line(source_file_get(file_id), offset);
+    source_lines_unlock();
+    return line;
+}
 
-    tokens_trim(&tokens);
-    str_vec_free(&lines);
-    return tokens;
+int source_file_find_line(SourceFile* file, int offset) {
+    if (file->line_offsets.elems == NULL) {
+        source_file_index_lines(file);
+    }
+    // Binary search for the last line starting at or before offset
+    int* line_offsets = file->line_offsets.elems;
+    int low = 0;
+    int high = file->line_offsets.size - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (line_offsets[mid] <= offset) {
+            low = mid;
+        }
+        else {
+            high = mid - 1;
+        }
+    }
+    return low;
 }
 
+char* source_file_get_line_str(int file_id, int offset) {
+    SourceFile* file = source_file_get(file_id);
+    if (!file->tag_debug_line_info) {
+        return NULL;
+    }
+    source_lines_lock();
+    int line = source_file_find_line(file, offset);
+    char** line_strs = file->line_strs.elems;
+    if (line_strs[line] == NULL) {
+        int* line_offsets = file->line_offsets.elems;
+        char* line_start = file->src + line_offsets[line];
+        char* line_end = scan_line_end(line_start);
+        char* line_str = str_substr(line_start, line_end - line_start);
+        line_strs[line] = str_strip(line_str);
+        free(line_str);
+    }
+    char* line_str = line_strs[line];
+    source_lines_unlock();
+    return line_str;
+}
+
+void source_file_index_lines(SourceFile* file) {
+    file->line_offsets = vec_new(sizeof(int), 16);
+    int offset = 0;
+    vec_push(&file->line_offsets, &offset);
+    char* str = scan_line_end(file->src);
+    while (*str) {
+        offset = str + 1 - file->src;
+        vec_push(&file->line_offsets, &offset);
+        str = scan_line_end(str + 1);
+    }
+    file->line_strs = vec_new(sizeof(char*), file->line_offsets.size);
+    vec_resize(&file->line_strs, file->line_offsets.size);
+}
+
+// ================ Tokens object ===================
+
 // Create a new Tokens object
 Tokens tokens_new(int size) {
     Tokens tokens;
     tokens.size = size;
-    tokens.elems = vec_new(sizeof(Token), size);
-    tokens.line_string_vec.elems = NULL;
-    vec_resize(&tokens.elems, size);
+    tokens.types = vec_new(sizeof(TokenType), size);
+    tokens.spans = vec_new(sizeof(TokenSpan), size);
+    tokens.texts = vec_new(sizeof(char*), size);
+    vec_resize(&tokens.types, size);
+    vec_resize(&tokens.spans, size);
+    vec_resize(&tokens.texts, size);
+    // Allocated by the tokenizer if it builds the index
+    tokens.conditionals.elems = NULL;
+    tokens.conditionals.size = 0;
+    tokens.conditionals.max_size = 0;
+    tokens.conditionals.elem_bytes = sizeof(int);
     return tokens;
 }
 
+void tokens_reserve(Tokens* tokens, int capacity) {
+    vec_reserve(&tokens->types, capacity);
+    vec_reserve(&tokens->spans, capacity);
+    vec_reserve(&tokens->texts, capacity);
+}
+
 void tokens_free(Tokens* tokens) {
-    for (size_t i = 0; i < tokens->size; i++) {
-        Token* t = tokens_get(tokens, i);
-        if (t->requires_string_free) {
-            free(t->string_repr);
-        }
-        if (t->src_line_requires_free) {
-            free(t->src_line_str);
-        }
+    vec_free(&tokens->types);
+    vec_free(&tokens->spans);
+    vec_free(&tokens->texts);
+    vec_free(&tokens->conditionals);
+}
+
+TokenType tokens_get_type(Tokens* tokens, int i) {
+    TokenType* types = tokens->types.elems;
+    return types[i];
+}
+
+void tokens_set_type(Tokens* tokens, int i, TokenType type) {
+    TokenType* types = tokens->types.elems;
+    types[i] = type;
+}
+
+TokenSpan* tokens_get_span(Tokens* tokens, int i) {
+    return vec_get(&tokens->spans, i);
+}
+
+char* tokens_get_string(Tokens* tokens, int i) {
+    char** texts = tokens->texts.elems;
+    if (texts[i] != NULL) {
+        return texts[i];
+    }
+    TokenType type = tokens_get_type(tokens, i);
+    if (type == TK_NONE || type == TK_EOF) {
+        return NULL;
     }
-    vec_free(&tokens->elems);
+    // Keywords, operators and delimiters share a static string
+    char* spelling = token_type_spelling(type);
+    if (spelling != NULL) {
+        return spelling;
+    }
+    TokenSpan* span = tokens_get_span(tokens, i);
+    char* src = source_file_get(span->file_id)->src + span->offset;
+    if (type == TK_COMMENT && src[1] == '*') {
+        return "BLOCK COMMENT N/A";
+    }
+    if (type == TK_LSTRING || type == TK_LCHAR) {
+        // Escape ` characters which don't play well with NASM
+        char* text = str_escape_nasm_chars(str_substr(src, span->length));
+        texts[i] = intern_str(text);
+        free(text);
+    }
+    else {
+        texts[i] = intern_str_n(src, span->length);
+    }
+    return texts[i];
+}
+
+void tokens_set_string(Tokens* tokens, int i, char* string_repr) {
+    char** texts = tokens->texts.elems;
+    texts[i] = intern_str(string_repr);
+}
+
+int tokens_get_src_line(Tokens* tokens, int i) {
+    if (tokens_get_type(tokens, i) == TK_EOF) {
+        return 0;
+    }
+    TokenSpan* span = tokens_get_span(tokens, i);
+    return source_file_get_line(span->file_id, span->offset);
+}
+
+char* tokens_get_src_line_str(Tokens* tokens, int i) {
+    if (tokens_get_type(tokens, i) == TK_EOF) {
+        return NULL;
+    }
+    TokenSpan* span = tokens_get_span(tokens, i);
+    return source_file_get_line_str(span->file_id, span->offset);
+}
+
+char* tokens_get_src_filename(Tokens* tokens, int i) {
+    return source_file_get(tokens_get_span(tokens, i)->file_id)->filename;
+}
+
+int tokens_push(Tokens* tokens, TokenType type, TokenSpan span) {
+    char* text = NULL;
+    vec_push(&tokens->types, &type);
+    vec_push(&tokens->spans, &span);
+    vec_push(&tokens->texts, &text);
+    tokens->size = tokens->types.size;
+    return tokens->size - 1;
 }
 
-void tokens_free_line_strings(Tokens* tokens) {
-    str_vec_free(&tokens->line_string_vec);
+int tokens_push_token(Tokens* dest, Tokens* src, int src_i) {
+    TokenType type = tokens_get_type(src, src_i);
+    int i = tokens_push(dest, type, *tokens_get_span(src, src_i));
+    char** dest_texts = dest->texts.elems;
+    char** src_texts = src->texts.elems;
+    dest_texts[i] = src_texts[src_i];
+    return i;
 }
 
-Token* tokens_get(Tokens* tokens, int i) {
-    return (Token*) vec_get(&tokens->elems, i);
+void tokens_pop(Tokens* tokens) {
+    vec_pop(&tokens->types);
+    vec_pop(&tokens->spans);
+    vec_pop(&tokens->texts);
+    tokens->size = tokens->types.size;
 }
 
-void tokens_set(Tokens* tokens, int i, TokenType type, char* string_repr,
-                bool requires_free) {
-    Token* t = tokens_get(tokens, i);
-    t->type = type;
-    t->string_repr = string_repr;
-    t->requires_string_free = requires_free;
+void tokens_clear(Tokens* tokens) {
+    tokens->size = 0;
+    tokens->types.size = 0;
+    tokens->spans.size = 0;
+    tokens->texts.size = 0;
+    tokens->conditionals.size = 0;
+}
+
+void tokens_set_token(Tokens* dest, int dest_i, Tokens* src, int src_i) {
+    char** dest_texts = dest->texts.elems;
+    char** src_texts = src->texts.elems;
+    tokens_set_type(dest, dest_i, tokens_get_type(src, src_i));
+    *tokens_get_span(dest, dest_i) = *tokens_get_span(src, src_i);
+    dest_texts[dest_i] = src_texts[src_i];
 }
 
 // Remove NULL elements from the Token Array
 void tokens_trim(Tokens* tokens) {
-    // Count non-none tokens
-    int token_count = 0;
-    for (size_t i = 0; i < tokens->size; i++) {
-        if (tokens_get(tokens, i)->type != TK_NONE) {
-            token_count++;
-        }
-    }
-    Vec new_token_vec = vec_new(sizeof(Token), token_count);
-    vec_resize(&new_token_vec, token_count);
-    // Add the tokens
+    char** texts = tokens->texts.elems;
+    // Move the non-none tokens to the front
     int j = 0;
     for (size_t i = 0; i < tokens->size; i++) {
-        Token* token = tokens_get(tokens, i);
-        if (token->type != TK_NONE) {
-            Token* new_token = vec_get(&new_token_vec, j);
-            *new_token = *token;
+        TokenType type = tokens_get_type(tokens, i);
+        if (type != TK_NONE) {
+            tokens_set_type(tokens, j, type);
+            *tokens_get_span(tokens, j) = *tokens_get_span(tokens, i);
+            texts[j] = texts[i];
             j++;
         }
-        else {
-            if (token->requires_string_free) {
-                free(token->string_repr);
-            }
-        }
     }
-    vec_free(&tokens->elems);
-    tokens->size = token_count;
-    tokens->elems = new_token_vec;
+    tokens->size = j;
+    tokens->types.size = j;
+    tokens->spans.size = j;
+    tokens->texts.size = j;
+    tokens_drop_conditionals(tokens);
 }
 
 // Insert the entire tokens2 into tokens1 at a specific index in tokens1
 Tokens* tokens_insert(Tokens* tokens1, Tokens* tokens2, int tokens1_index) {
-    vec_insert(&tokens1->elems, &tokens2->elems, tokens1_index);
-    tokens1->size = tokens1->elems.size;
-    str_vec_add(&tokens1->line_string_vec, &tokens2->line_string_vec);
+    vec_insert(&tokens1->types, &tokens2->types, tokens1_index);
+    vec_insert(&tokens1->spans, &tokens2->spans, tokens1_index);
+    vec_insert(&tokens1->texts, &tokens2->texts, tokens1_index);
+    tokens1->size = tokens1->types.size;
+    tokens_drop_conditionals(tokens1);
     return tokens1;
 }
 
 void tokens_tag_src_filename(Tokens* tokens, char* filename) {
     for (size_t i = 0; i < tokens->size; i++) {
-        tokens_get(tokens, i)->src_filename = filename;
+        source_file_get(tokens_get_span(tokens, i)->file_id)->filename = filename;
+    }
+}
+
+// ================ Tokenizer ===================
+
+void tokenizer_init(Tokenizer* tokenizer, Tokens* tokens, int file_id) {
+    tokenizer->tokens = tokens;
+    tokenizer->file_id = file_id;
+    tokenizer->src = source_file_get(file_id)->src;
+    tokenizer->next_line = tokenizer->src;
+    tokenizer->in_block_comment = false;
+    tokenizer->index_conditionals = false;
+}
+
+bool tokenize_next_line(Tokenizer* tokenizer) {
+    char* str = tokenizer->next_line;
+    if (*str) {
+        tokenizer->next_line = tokenize_find_line(tokenizer, str);
+        tokenize_line(tokenizer);
+        return true;
     }
+    TokenSpan eof_span;
+    eof_span.file_id = tokenizer->file_id;
+    eof_span.offset = str - tokenizer->src;
+    eof_span.length = 0;
+    tokens_push(tokenizer->tokens, TK_EOF, eof_span);
+    return false;
 }
 
-void tokenize_preprocessor(Tokens* tokens, StrVector* str_split) {
-    int src_pos = 0;
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str = str_split->elems[i];
-        // Is this a preprocessor line?
-        if (str_startswith(str, "#")) {
-            tokens_set(tokens, src_pos, TK_PREPROCESSOR, str_copy(str), true);
-            str_fill(str, strlen(str), ' ');
+bool tokenize_next_directive_line(Tokenizer* tokenizer) {
+    // Only '/' can start or end a block comment, so the block comment state is the
+    // same after the skipped lines
+    while (!tokenizer->in_block_comment && *tokenizer->next_line) {
+        char* next_line = tokenize_find_line(tokenizer, tokenizer->next_line);
+        char* line_end = tokenizer->line_end;
+        if (*tokenizer->line == '#' ||
+            scan_find_either(tokenizer->line, line_end, '/', '/') != line_end) {
+            break;
         }
-        src_pos += strlen(str);
+        tokenizer->next_line = next_line;
     }
+    return tokenize_next_line(tokenizer);
 }
 
-void tokenize_comments(Tokens* tokens, StrVector* str_split) {
-    int src_pos = 0;
-    int comment_src_pos;
-    bool seeking_block_comment_end = false;
-    bool is_inside_string = false;
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str = str_split->elems[i];
-        while (*str) {
-            if (!seeking_block_comment_end) {
-                // We need to ignore comments inside strings
-                if (*(str) == '\"' && (str == str_split->elems[i] || *(str - 1) != '\\')) {
-                    is_inside_string = !is_inside_string;
-                }
-                // Check for start of multiline comment
-                else if (!is_inside_string && *str == '/' && *(str + 1) == '*') {
-                    comment_src_pos = src_pos;
-                    *str = ' ';
-                    src_pos++;
-                    str++;
-                    *str = ' ';
-                    seeking_block_comment_end = true;
-                }
-                // Check for single line comment
-                else if (!is_inside_string && *str == '/' && *(str + 1) == '/') {
-                    // Single line comment, can clear out to end of line
-                    tokens_set(tokens, src_pos, TK_COMMENT, str_substr(str, strlen(str)),
-                               true);
-                    str_fill(str, strlen(str), ' ');
-                }
-            }
-            else {
-                // Check for end of multiline comment
-                if (*str == '*' && *(str + 1) == '/') {
-                    tokens_set(tokens, comment_src_pos, TK_COMMENT, "BLOCK COMMENT N/A",
-                               false);
-                    seeking_block_comment_end = false;
-                    *str = ' ';
-                    str++;
-                    src_pos++;
-                }
-                *str = ' ';
-            }
+char* tokenize_find_line(Tokenizer* tokenizer, char* str) {
+    char* end = scan_line_end(str);
+    char* next_line = end;
+    if (*next_line == '\n') {
+        next_line++;
+    }
+    // Leading and trailing whitespace is not part of the line
+    str = scan_skip_blanks(str, end);
+    while (end > str && (*(end - 1) == ' ' || *(end - 1) == '\t')) {
+        end--;
+    }
+    tokenizer->line = str;
+    tokenizer->line_end = end;
+    return next_line;
+}
 
-            str++;
-            src_pos++;
-        }
+void tokenize_line(Tokenizer* tokenizer) {
+    char* str = tokenizer->line;
+    if (tokenizer->in_block_comment) {
+        str = tokenize_block_comment_end(tokenizer, str);
+    }
+    else if (*str == '#') {
+        // Preprocessor directives take up the whole line
+        tokenize_preprocessor(tokenizer);
+        return;
+    }
+    while (str < tokenizer->line_end) {
+        str = tokenize_next(tokenizer, str);
     }
 }
 
-void tokenize_strings(Tokens* tokens, StrVector* str_split) {
-    int src_pos = 0;
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str = str_split->elems[i];
-        while (*str) {
-            // Strings, double quotes ""
-            if (*str == '\"') {
-                char* str_start = str + 1;
-                bool char_escaped = false;
-                str++;
-                src_pos++;
-                while (*str != '\"' || char_escaped) {
-                    char_escaped = (*str == '\\' && !char_escaped);
-                    str++;
-                    src_pos++;
-                }
-                char* str_value = str_substr(str_start, str - str_start);
-                // Escape ` characters which don't play well with NASM
-                str_value = str_escape_nasm_chars(str_value);
-                tokens_set(tokens, src_pos, TK_LSTRING, str_value, true);
-                str_fill(str_start - 1, str - str_start + 2, ' ');
-            }
-            // Chars, single quotes ''
-            else if (*str == '\'') {
-                char* char_start = str + 1;
-                bool char_escaped = false;
-                str++;
-                src_pos++;
-                while (*str != '\'' || char_escaped) {
-                    char_escaped = (*str == '\\' && !char_escaped);
-                    str++;
-                    src_pos++;
-                }
-                char* str_value = str_substr(char_start, str - char_start);
-                // Escape ` characters which don't play well with NASM
-                str_value = str_escape_nasm_chars(str_value);
-                tokens_set(tokens, src_pos, TK_LCHAR, str_value, true);
-                str_fill(char_start - 1, str - char_start + 2, ' ');
-            }
-            str++;
-            src_pos++;
-        }
+char* tokenize_next(Tokenizer* tokenizer, char* str) {
+    char c = *str;
+    if (c == ' ' || c == '\t') {
+        return scan_skip_blanks(str + 1, tokenizer->line_end);
+    }
+    if (c_isalpha(c) || c == '_') {
+        return tokenize_word(tokenizer, str);
+    }
+    if (c_isdigit(c) || (c == '.' && c_isdigit(*(str + 1)))) {
+        return tokenize_number(tokenizer, str);
+    }
+    if (c == '\"') {
+        return tokenize_quoted(tokenizer, str, '\"', TK_LSTRING);
+    }
+    if (c == '\'') {
+        return tokenize_quoted(tokenizer, str, '\'', TK_LCHAR);
+    }
+    if (c == '/' && *(str + 1) == '/') {
+        // Single line comment, consumes the rest of the line
+        tokenizer_add(tokenizer, str, tokenizer->line_end - str, TK_COMMENT);
+        return tokenizer->line_end;
     }
+    if (c == '/' && *(str + 1) == '*') {
+        tokenize_block_comment_start(tokenizer, str);
+        return tokenize_block_comment_end(tokenizer, str + 2);
+    }
+    return tokenize_punctuator(tokenizer, str);
+}
+
+int tokenizer_add(Tokenizer* tokenizer, char* str, int length, TokenType type) {
+    TokenSpan span;
+    span.file_id = tokenizer->file_id;
+    span.offset = str - tokenizer->src;
+    span.length = length;
+    return tokens_push(tokenizer->tokens, type, span);
 }
 
-void tokenize_keywords(Tokens* tokens, StrVector* str_split) {
-    tokenize_keyword(tokens, str_split, "while", TK_KW_WHILE);
-    tokenize_keyword(tokens, str_split, "do", TK_KW_DO);
-    tokenize_keyword(tokens, str_split, "if", TK_KW_IF);
-    tokenize_keyword(tokens, str_split, "else", TK_KW_ELSE);
-    tokenize_keyword(tokens, str_split, "for", TK_KW_FOR);
-    tokenize_keyword(tokens, str_split, "break", TK_KW_BREAK);
-    tokenize_keyword(tokens, str_split, "continue", TK_KW_CONTINUE);
-    tokenize_keyword(tokens, str_split, "return", TK_KW_RETURN);
-    tokenize_keyword(tokens, str_split, "switch", TK_KW_SWITCH);
-    tokenize_keyword(tokens, str_split, "case", TK_KW_CASE);
-    tokenize_keyword(tokens, str_split, "default", TK_KW_DEFAULT);
-    tokenize_keyword(tokens, str_split, "goto", TK_KW_GOTO);
-    tokenize_keyword(tokens, str_split, "typedef", TK_KW_TYPEDEF);
-    tokenize_keyword(tokens, str_split, "const", TK_KW_CONST);
-    tokenize_keyword(tokens, str_split, "long", TK_KW_LONG);
-    tokenize_keyword(tokens, str_split, "short", TK_KW_SHORT);
-    tokenize_keyword(tokens, str_split, "signed", TK_KW_SIGNED);
-    tokenize_keyword(tokens, str_split, "unsigned", TK_KW_UNSIGNED);
-    tokenize_keyword(tokens, str_split, "extern", TK_KW_EXTERN);
-    tokenize_keyword(tokens, str_split, "static", TK_KW_STATIC);
-    tokenize_keyword(tokens, str_split, "struct", TK_KW_STRUCT);
-    tokenize_keyword(tokens, str_split, "enum", TK_KW_ENUM);
-    tokenize_keyword(tokens, str_split, "union", TK_KW_UNION);
-    tokenize_keyword(tokens, str_split, "int", TK_KW_INT);
-    tokenize_keyword(tokens, str_split, "float", TK_KW_FLOAT);
-    tokenize_keyword(tokens, str_split, "double", TK_KW_DOUBLE);
-    tokenize_keyword(tokens, str_split, "char", TK_KW_CHAR);
-    tokenize_keyword(tokens, str_split, "void", TK_KW_VOID);
-    tokenize_keyword(tokens, str_split, "...", TK_KW_VARIADIC_DOTS);
-}
-
-void tokenize_keyword(Tokens* tokens, StrVector* str_split, char* keyword,
-                      enum TokenType type) {
-    int src_pos = 0;
-    int keyword_length = strlen(keyword);
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str = str_split->elems[i];
-        int match_i = 0;
-        while ((match_i = str_contains_word(str, keyword))) {
-            char* start = str + match_i - 1;
-            int keyword_src_index = src_pos + match_i - 1;
-            str_fill(start, keyword_length, ' ');
-            tokens_set(tokens, keyword_src_index, type, keyword, false);
+void tokenize_preprocessor(Tokenizer* tokenizer) {
+    // Comments are blanked out of the directive string, but still produce their own tokens
+    char* line = tokenizer->line;
+    int length = tokenizer->line_end - line;
+    char* directive = str_substr(line, length);
+    int directive_index = tokenizer_add(tokenizer, line, length, TK_PREPROCESSOR);
+    bool is_inside_string = false;
+    int i = 0;
+    while (i < length) {
+        if (line[i] == '\"' && (i == 0 || line[i - 1] != '\\')) {
+            is_inside_string = !is_inside_string;
         }
-        src_pos += strlen(str);
-    }
-}
-
-void tokenize_ops(Tokens* tokens, StrVector* str_split) {
-    // Similar to keywords tokenization, except we want to isolate words
-    tokenize_op(tokens, str_split, "sizeof", TK_OP_SIZEOF);
-    tokenize_op(tokens, str_split, "->", TK_OP_PTR_MEMBER);
-    tokenize_op(tokens, str_split, "+=", TK_OP_ASSIGN_ADD);
-    tokenize_op(tokens, str_split, "-=", TK_OP_ASSIGN_SUB);
-    tokenize_op(tokens, str_split, "*=", TK_OP_ASSIGN_MULT);
-    tokenize_op(tokens, str_split, "/=", TK_OP_ASSIGN_DIV);
-    tokenize_op(tokens, str_split, "%=", TK_OP_ASSIGN_MOD);
-    tokenize_op(tokens, str_split, "<<=", TK_OP_ASSIGN_LEFTSHIFT);
-    tokenize_op(tokens, str_split, ">>=", TK_OP_ASSIGN_RIGHTSHIFT);
-    tokenize_op(tokens, str_split, "&=", TK_OP_ASSIGN_BITAND);
-    tokenize_op(tokens, str_split, "|=", TK_OP_ASSIGN_BITOR);
-    tokenize_op(tokens, str_split, "^=", TK_OP_ASSIGN_BITXOR);
-
-    tokenize_op(tokens, str_split, "||", TK_OP_OR);
-    tokenize_op(tokens, str_split, "&&", TK_OP_AND);
-    tokenize_op(tokens, str_split, "==", TK_OP_EQ);
-    tokenize_op(tokens, str_split, "!=", TK_OP_NEQ);
-    tokenize_op(tokens, str_split, ">=", TK_OP_GTE);
-    tokenize_op(tokens, str_split, "<=", TK_OP_LTE);
-
-    tokenize_op(tokens, str_split, ">>", TK_OP_RIGHTSHIFT);
-    tokenize_op(tokens, str_split, "<<", TK_OP_LEFTSHIFT);
-
-    tokenize_op(tokens, str_split, "++", TK_OP_INCR);
-    tokenize_op(tokens, str_split, "--", TK_OP_DECR);
-
-    tokenize_op(tokens, str_split, "=", TK_OP_ASSIGN);
-    tokenize_op(tokens, str_split, "+", TK_OP_PLUS);
-    tokenize_op(tokens, str_split, "-", TK_OP_MINUS);
-    tokenize_op(tokens, str_split, "*", TK_OP_MULT);
-    tokenize_op(tokens, str_split, "/", TK_OP_DIV);
-    tokenize_op(tokens, str_split, "%", TK_OP_MOD);
-
-    tokenize_op(tokens, str_split, ">", TK_OP_GT);
-    tokenize_op(tokens, str_split, "<", TK_OP_LT);
-    tokenize_op(tokens, str_split, "!", TK_OP_NOT);
-
-    tokenize_op(tokens, str_split, "|", TK_OP_BITOR);
-    tokenize_op(tokens, str_split, "&", TK_OP_BITAND);
-    tokenize_op(tokens, str_split, "~", TK_OP_COMPL);
-    tokenize_op(tokens, str_split, "^", TK_OP_BITXOR);
-    tokenize_op(tokens, str_split, "?", TK_OP_QST);
-}
-
-void tokenize_op(Tokens* tokens, StrVector* str_split, char* op, enum TokenType type) {
-    int src_pos = 0;
-    int op_length = strlen(op);
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str = str_split->elems[i];
-        int match_i = 0;
-        while ((match_i = str_contains(str, op))) {
-            char* start = str + match_i - 1;
-            int keyword_src_index = src_pos + match_i - 1;
-            str_fill(start, op_length, ' ');
-            tokens_set(tokens, keyword_src_index, type, op, false);
+        else if (!is_inside_string && line[i] == '/' && line[i + 1] == '/') {
+            tokenizer_add(tokenizer, line + i, length - i, TK_COMMENT);
+            str_fill(directive + i, length - i, ' ');
+            break;
         }
-        src_pos += strlen(str);
-    }
-}
-
-void tokenize_idents(Tokens* tokens, StrVector* str_split) {
-    // Find words (separated by non-alphanum characters) which
-    // starts with an alpha char or _, made up of only alphanum characters
-    // Make a new version of str_contains_word? str_contains_alpha_word?
-    int src_pos = 0;
-    char* ident_start;
-    bool matching_ident = false;
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str_start = str_split->elems[i];
-        char* str = str_start;
-        bool prev_is_whitespace = true;
-        while (*str != '\0') {
-            if (!matching_ident) {
-                if ((c_isalpha(*str) || *str == '_') &&
-                    prev_is_whitespace) { // Found start of identifier
-                    matching_ident = true;
-                    ident_start = str;
-                }
-            }
-            else {
-                if (!(c_isalnum(*str)) && *str != '_') { // Found end of identifier
-                    int length = str - ident_start;
-                    tokens_set(tokens, src_pos - length, TK_IDENT,
-                               str_substr(ident_start, length), true);
-                    str_fill(ident_start, length, ' ');
-                    matching_ident = false;
-                }
-            }
-            if (!c_isalnum(*str) && *str != '_') {
-                prev_is_whitespace = true;
-            }
-            else {
-                prev_is_whitespace = false;
-            }
-            str++;
-            src_pos++;
+        else if (!is_inside_string && line[i] == '/' && line[i + 1] == '*') {
+            tokenize_block_comment_start(tokenizer, line + i);
+            int comment_end = tokenize_block_comment_end(tokenizer, line + i + 2) - line;
+            str_fill(directive + i, comment_end - i, ' ');
+            i = comment_end;
+            continue;
         }
-        if (matching_ident) { // Found end of identifier, line ended
-            int length = str - ident_start;
-            tokens_set(tokens, src_pos - length, TK_IDENT,
-                       str_substr(ident_start, length), true);
-            str_fill(ident_start, length, ' ');
-            matching_ident = false;
+        i++;
+    }
+    tokens_set_string(tokenizer->tokens, directive_index, directive);
+    if (tokenizer->index_conditionals) {
+        tokenize_index_conditional(tokenizer, directive, directive_index);
+    }
+    free(directive);
+}
+
+void tokenize_index_conditional(Tokenizer* tokenizer, char* directive, int directive_index) {
+    Vec* conditionals = &tokenizer->tokens->conditionals;
+    if (str_startswith(directive, "#ifdef") || str_startswith(directive, "#ifndef")) {
+        // The #endif is filled in when it is found
+        int pair = conditionals->size;
+        int no_end = -1;
+        vec_push(conditionals, &directive_index);
+        vec_push(conditionals, &no_end);
+        vec_push(&tokenizer->open_conditionals, &pair);
+    }
+    else if (str_startswith(directive, "#endif") && tokenizer->open_conditionals.size > 0) {
+        int pair = *(int*)vec_pop(&tokenizer->open_conditionals);
+        int* pairs = conditionals->elems;
+        pairs[pair + 1] = directive_index;
+    }
+}
+
+void tokenize_block_comment_start(Tokenizer* tokenizer, char* str) {
+    tokenizer->in_block_comment = true;
+    tokenizer->comment_start = str;
+}
+
+char* tokenize_block_comment_end(Tokenizer* tokenizer, char* str) {
+    str = scan_comment_end(str, tokenizer->line_end);
+    if (str == tokenizer->line_end) {
+        return str;
+    }
+    // Block comments are only tokenized once they are terminated
+    TokenSpan span;
+    span.file_id = tokenizer->file_id;
+    span.offset = tokenizer->comment_start - tokenizer->src;
+    span.length = str + 2 - tokenizer->comment_start;
+    tokens_push(tokenizer->tokens, TK_COMMENT, span);
+    tokenizer->in_block_comment = false;
+    return str + 2;
+}
+
+char* tokenize_quoted(Tokenizer* tokenizer, char* str, char quote, TokenType type) {
+    // The token text is the contents between the quotes
+    char* start = str + 1;
+    char* line_end = tokenizer->line_end;
+    char* end = scan_find_either(start, line_end, quote, '\\');
+    while (end < line_end && *end == '\\') {
+        // Skip the escaped character
+        end += 2;
+        if (end > line_end) {
+            end = line_end;
         }
+        end = scan_find_either(end, line_end, quote, '\\');
+    }
+    tokenizer_add(tokenizer, start, end - start, type);
+    if (end < tokenizer->line_end) {
+        end++;
+    }
+    return end;
+}
+
+char* tokenize_word(Tokenizer* tokenizer, char* str) {
+    char* end = scan_ident_end(str + 1, tokenizer->line_end);
+    int length = end - str;
+    tokenizer_add(tokenizer, str, length, tokenize_keyword_type(str, length));
+    return end;
+}
+
+TokenType tokenize_keyword_type(char* str, int length) {
+    if (length > KEYWORD_MAX_LENGTH) {
+        return TK_IDENT;
     }
+    // Every keyword has its own slot, so a single comparison decides
+    int slot = tokenize_keyword_hash(str, length);
+    if (keyword_hash_lengths[slot] != length ||
+        strncmp(keyword_hash_strings[slot], str, length) != 0) {
+        return TK_IDENT;
+    }
+    return keyword_hash_types[slot];
+}
+
+int tokenize_keyword_hash(char* str, int length) {
+    int first = str[0];
+    int last = str[length - 1];
+    int hash = first * KEYWORD_HASH_FIRST_MULT + last * KEYWORD_HASH_LAST_MULT +
+               length * KEYWORD_HASH_LENGTH_MULT;
+    return hash & (KEYWORD_HASH_SIZE - 1);
 }
 
 // Tokenize int and float literals
-// Floats: 1.3f, 1.3, .3
-// Ints: 34312, 0xFAFA, don't do binary for now
-void tokenize_values(Tokens* tokens, StrVector* str_split) {
-    tokenize_ints(tokens, str_split);
-    tokenize_floats(tokens, str_split);
-}
-
-void tokenize_ints(Tokens* tokens, StrVector* str_split) {
-    int src_pos = 0;
-    char* ident_start;
-    bool matching = false;
-    for (size_t i = 0; i < str_split->size; i++) {
-        bool prev_is_whitespace = true;
-        char* str = str_split->elems[i];
-        while (*str != '\0') {
-            if (!matching) {
-                if (c_isdigit(*str) && prev_is_whitespace) { // Found start of int
-                    matching = true;
-                    ident_start = str;
-                }
-            }
-            else {
-                if (c_isalpha(*str) || *str == '_' ||
-                    *str == '.') { // Invalid character in int
-                    matching = false;
-                    prev_is_whitespace = false;
-                    continue;
-                }
-                else if (!c_isalnum(*str)) { // End of int
-                    int length = str - ident_start;
-                    //char* substr = str_substr(ident_start, length);
-                    //printf("Found int %s\n", substr);
-                    tokens_set(tokens, src_pos - length, TK_LINT,
-                               str_substr(ident_start, length), true);
-                    str_fill(ident_start, length, ' ');
-                    matching = false;
-                }
-            }
-            if (!c_isalnum(*str) && *str != '_' && *str != '.') {
-                prev_is_whitespace = true;
-            }
-            else {
-                prev_is_whitespace = false;
-            }
-            str++;
-            src_pos++;
+// Floats: 1.3, .3, 3.
+// Ints: 34312, no hex or binary for now
+char* tokenize_number(Tokenizer* tokenizer, char* str) {
+    char* end = str;
+    bool found_dot = false;
+    while (c_isdigit(*end) || *end == '.') {
+        if (*end == '.') {
+            found_dot = true;
         }
-        if (matching) { // Found end of identifier, line ended
-            int length = str - ident_start;
-            tokens_set(tokens, src_pos - length, TK_LINT, str_substr(ident_start, length),
-                       true);
-            str_fill(ident_start, length, ' ');
-            matching = false;
+        end++;
+    }
+    if (c_isalpha(*end) || *end == '_') {
+        // Invalid literal such as 53asd, only the dots in it are kept as delimiters
+        end = str;
+        while (c_isalnum(*end) || *end == '_' || *end == '.') {
+            if (*end == '.') {
+                tokenizer_add(tokenizer, end, 1, TK_DL_DOT);
+            }
+            end++;
         }
+        return end;
     }
+    TokenType type = TK_LINT;
+    if (found_dot) {
+        type = TK_LFLOAT;
+    }
+    tokenizer_add(tokenizer, str, end - str, type);
+    return end;
 }
 
-// Very similar to int, except there has to be a dot somewhere, either as first char or somewhere inside
-void tokenize_floats(Tokens* tokens, StrVector* str_split) {
-    int src_pos = 0;
-    char* ident_start;
-    bool matching = false;
-    bool found_dot = false;
-    bool found_digit = false;
-    for (size_t i = 0; i < str_split->size; i++) {
-        bool prev_is_whitespace = true;
-        char* str = str_split->elems[i];
-        while (*str != '\0') {
-            if (!matching) {
-                if ((c_isdigit(*str) || *str == '.') &&
-                    prev_is_whitespace) { // Found start of int
-                    matching = true;
-                    ident_start = str;
-                    if (*str == '.') {
-                        found_dot = true;
-                    }
-                    else if (c_isdigit(*str)) {
-                        found_digit = true;
-                    }
-                }
+int tokenize_op(Tokenizer* tokenizer, char* str, char* op, TokenType type) {
+    int length = strlen(op);
+    if (strncmp(str, op, length) != 0) {
+        return 0;
+    }
+    tokenizer_add(tokenizer, str, length, type);
+    return length;
+}
+
+char* tokenize_punctuator(Tokenizer* tokenizer, char* str) {
+    // Operators are matched longest first
+    int length = 0;
+    switch (*str) {
+        case '{':
+            length = tokenize_op(tokenizer, str, "{", TK_DL_OPENBRACE);
+            break;
+        case '}':
+            length = tokenize_op(tokenizer, str, "}", TK_DL_CLOSEBRACE);
+            break;
+        case '(':
+            length = tokenize_op(tokenizer, str, "(", TK_DL_OPENPAREN);
+            break;
+        case ')':
+            length = tokenize_op(tokenizer, str, ")", TK_DL_CLOSEPAREN);
+            break;
+        case '[':
+            length = tokenize_op(tokenizer, str, "[", TK_DL_OPENBRACKET);
+            break;
+        case ']':
+            length = tokenize_op(tokenizer, str, "]", TK_DL_CLOSEBRACKET);
+            break;
+        case ',':
+            length = tokenize_op(tokenizer, str, ",", TK_DL_COMMA);
+            break;
+        case ';':
+            length = tokenize_op(tokenizer, str, ";", TK_DL_SEMICOLON);
+            break;
+        case ':':
+            length = tokenize_op(tokenizer, str, ":", TK_DL_COLON);
+            break;
+        case '.':
+            length = tokenize_op(tokenizer, str, "...", TK_KW_VARIADIC_DOTS);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, ".", TK_DL_DOT);
             }
-            else {
-                if (*str == '.') {
-                    found_dot = true;
-                }
-                else if (c_isdigit(*str)) {
-                    found_digit = true;
-                }
-                else if (c_isalpha(*str) || *str == '_' ||
-                         (!c_isalpha(*str) &&
-                          (!found_digit || !found_dot))) { // Invalid character in float
-                    matching = false;
-                    prev_is_whitespace = false;
-                    found_dot = false;
-                    continue;
-                }
-                else if (!c_isalnum(*str)) { // End of float
-                    int length = str - ident_start;
-                    tokens_set(tokens, src_pos - length, TK_LFLOAT,
-                               str_substr(ident_start, length), true);
-                    str_fill(ident_start, length, ' ');
-                    matching = false;
-                    found_dot = false;
-                    found_digit = false;
-                }
+            break;
+        case '+':
+            length = tokenize_op(tokenizer, str, "++", TK_OP_INCR);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "+=", TK_OP_ASSIGN_ADD);
             }
-            if (!c_isalnum(*str) && *str != '_' && *str != '.') {
-                prev_is_whitespace = true;
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "+", TK_OP_PLUS);
             }
-            else {
-                prev_is_whitespace = false;
+            break;
+        case '-':
+            length = tokenize_op(tokenizer, str, "--", TK_OP_DECR);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "-=", TK_OP_ASSIGN_SUB);
             }
-            str++;
-            src_pos++;
-        }
-        if (matching) { // Found end of identifier, line ended
-            int length = str - ident_start;
-            tokens_set(tokens, src_pos - length, TK_LFLOAT,
-                       str_substr(ident_start, length), true);
-            str_fill(ident_start, length, ' ');
-            matching = false;
-            found_dot = false;
-            found_digit = false;
-        }
-    }
-}
-
-void tokenize_delims(Tokens* tokens, StrVector* str_split) {
-    int src_pos = 0;
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str = str_split->elems[i];
-        while (*str != '\0') {
-            Token* t = tokens_get(tokens, src_pos);
-            t->src_line = i;
-            switch (*str) {
-                case '{':
-                    *str = ' ';
-                    t->type = TK_DL_OPENBRACE;
-                    t->string_repr = "{";
-                    break;
-                case '}':
-                    *str = ' ';
-                    t->type = TK_DL_CLOSEBRACE;
-                    t->string_repr = "}";
-                    break;
-                case '(':
-                    *str = ' ';
-                    t->type = TK_DL_OPENPAREN;
-                    t->string_repr = "(";
-                    break;
-                case ')':
-                    *str = ' ';
-                    t->type = TK_DL_CLOSEPAREN;
-                    t->string_repr = ")";
-                    break;
-                case '[':
-                    *str = ' ';
-                    t->type = TK_DL_OPENBRACKET;
-                    t->string_repr = "[";
-                    break;
-                case ']':
-                    *str = ' ';
-                    t->type = TK_DL_CLOSEBRACKET;
-                    t->string_repr = "]";
-                    break;
-                case '.':
-                    *str = ' ';
-                    t->type = TK_DL_DOT;
-                    t->string_repr = ".";
-                    break;
-                case ',':
-                    *str = ' ';
-                    t->type = TK_DL_COMMA;
-                    t->string_repr = ",";
-                    break;
-                case ';':
-                    *str = ' ';
-                    t->type = TK_DL_SEMICOLON;
-                    t->string_repr = ";";
-                    break;
-                case ':':
-                    *str = ' ';
-                    t->type = TK_DL_COLON;
-                    t->string_repr = ":";
-                    break;
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "->", TK_OP_PTR_MEMBER);
             }
-            src_pos++;
-            str++;
-        }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "-", TK_OP_MINUS);
+            }
+            break;
+        case '*':
+            length = tokenize_op(tokenizer, str, "*=", TK_OP_ASSIGN_MULT);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "*", TK_OP_MULT);
+            }
+            break;
+        case '/':
+            length = tokenize_op(tokenizer, str, "/=", TK_OP_ASSIGN_DIV);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "/", TK_OP_DIV);
+            }
+            break;
+        case '%':
+            length = tokenize_op(tokenizer, str, "%=", TK_OP_ASSIGN_MOD);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "%", TK_OP_MOD);
+            }
+            break;
+        case '<':
+            length = tokenize_op(tokenizer, str, "<<=", TK_OP_ASSIGN_LEFTSHIFT);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "<<", TK_OP_LEFTSHIFT);
+            }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "<=", TK_OP_LTE);
+            }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "<", TK_OP_LT);
+            }
+            break;
+        case '>':
+            length = tokenize_op(tokenizer, str, ">>=", TK_OP_ASSIGN_RIGHTSHIFT);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, ">>", TK_OP_RIGHTSHIFT);
+            }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, ">=", TK_OP_GTE);
+            }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, ">", TK_OP_GT);
+            }
+            break;
+        case '&':
+            length = tokenize_op(tokenizer, str, "&&", TK_OP_AND);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "&=", TK_OP_ASSIGN_BITAND);
+            }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "&", TK_OP_BITAND);
+            }
+            break;
+        case '|':
+            length = tokenize_op(tokenizer, str, "||", TK_OP_OR);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "|=", TK_OP_ASSIGN_BITOR);
+            }
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "|", TK_OP_BITOR);
+            }
+            break;
+        case '^':
+            length = tokenize_op(tokenizer, str, "^=", TK_OP_ASSIGN_BITXOR);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "^", TK_OP_BITXOR);
+            }
+            break;
+        case '=':
+            length = tokenize_op(tokenizer, str, "==", TK_OP_EQ);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "=", TK_OP_ASSIGN);
+            }
+            break;
+        case '!':
+            length = tokenize_op(tokenizer, str, "!=", TK_OP_NEQ);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "!", TK_OP_NOT);
+            }
+            break;
+        case '~':
+            length = tokenize_op(tokenizer, str, "~", TK_OP_COMPL);
+            break;
+        case '?':
+            length = tokenize_op(tokenizer, str, "?", TK_OP_QST);
+            break;
+        case '#':
+            length = tokenize_op(tokenizer, str, "##", TK_PP_HASHHASH);
+            if (!length) {
+                length = tokenize_op(tokenizer, str, "#", TK_PP_HASH);
+            }
+            break;
+    }
+    // Unknown characters are skipped
+    if (!length) {
+        length = 1;
     }
+    return str + length;
 }
 
 void tokens_print(Tokens* tokens) {
     for (size_t i = 0; i < tokens->size; i++) {
-        Token* t = tokens_get(tokens, i);
-        if (t->type == TK_NONE) {
+        TokenType type = tokens_get_type(tokens, i);
+        if (type == TK_NONE) {
             continue;
         }
-        char* type_str = token_type_to_string(t->type);
-        if (t->string_repr != 0) {
-            printf("[T: %-18s free: %d   STR: \"%s\"]\n", type_str,
-                   t->requires_string_free, t->string_repr);
+        char* type_str = token_type_to_string(type);
+        char* string_repr = tokens_get_string(tokens, i);
+        if (string_repr != 0) {
+            printf("[T: %-18s STR: \"%s\"]\n", type_str, string_repr);
         }
         else {
             printf("[T: %s]\n", type_str);
@@ -608,35 +839,61 @@ void tokens_print(Tokens* tokens) {
 
 Tokens tokens_copy(Tokens* tokens) {
     Tokens tokens_copy = *tokens;
-    tokens_copy.elems = vec_copy(&tokens->elems);
-    for (size_t i = 0; i < tokens->size; i++) {
-        Token* token = tokens_get(tokens, i);
-        Token* token_copy = tokens_get(&tokens_copy, i);
-        if (token->requires_string_free) {
-            token_copy->string_repr = str_copy(token->string_repr);
+    tokens_copy.types = vec_copy(&tokens->types);
+    tokens_copy.spans = vec_copy(&tokens->spans);
+    // Token texts are interned, so they are shared with the copy
+    tokens_copy.texts = vec_copy(&tokens->texts);
+    tokens_copy.conditionals = vec_copy(&tokens->conditionals);
+    return tokens_copy;
+}
+
+int tokens_find_conditional_end(Tokens* tokens, int i) {
+    // Binary search for the pair of the conditional, the pairs are sorted by their start
+    int* pairs = tokens->conditionals.elems;
+    int low = 0;
+    int high = tokens->conditionals.size / 2 - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        int start = pairs[mid * 2];
+        if (start == i) {
+            return pairs[mid * 2 + 1];
+        }
+        if (start < i) {
+            low = mid + 1;
+        }
+        else {
+            high = mid - 1;
         }
     }
-    return tokens_copy;
+    return -1;
+}
+
+void tokens_drop_conditionals(Tokens* tokens) {
+    vec_free(&tokens->conditionals);
+    tokens->conditionals.elems = NULL;
+    tokens->conditionals.size = 0;
+    tokens->conditionals.max_size = 0;
 }
 
 void tokens_pretty_print(Tokens* tokens) {
     for (size_t i = 0; i < tokens->size; i++) {
-        Token* t = tokens_get(tokens, i);
-        if (t->type == TK_DL_CLOSEBRACE) {
+        TokenType type = tokens_get_type(tokens, i);
+        char* string_repr = tokens_get_string(tokens, i);
+        if (type == TK_DL_CLOSEBRACE) {
             printf("\n");
         }
-        if (t->string_repr != 0) {
-            printf("%s ", t->string_repr);
+        if (string_repr != 0) {
+            printf("%s ", string_repr);
         }
-        if (t->type == TK_DL_SEMICOLON || t->type == TK_DL_OPENBRACE ||
-            t->type == TK_PREPROCESSOR || t->type == TK_COMMENT) {
+        if (type == TK_DL_SEMICOLON || type == TK_DL_OPENBRACE || type == TK_PREPROCESSOR ||
+            type == TK_COMMENT) {
             printf("\n");
         }
     }
 }
 
 char* token_type_to_string(enum TokenType type) {
-    static char* type_strings[87] = {
+    static char* type_strings[89] = {
         "TK_NONE",
         "TK_IDENT",
         "TK_TYPE",
@@ -727,22 +984,97 @@ char* token_type_to_string(enum TokenType type) {
         "TK_KW_CHAR",
         "TK_KW_VOID",
         "TK_KW_VARIADIC_DOTS",
+        "TK_PP_HASH",
+        "TK_PP_HASHHASH",
     };
     return type_strings[type];
 }
 
-void tag_tokens_with_src_lines(Tokens* tokens, StrVector* str_split) {
-    tokens->line_string_vec = str_vec_copy(str_split);
-    int tokens_i = 0;
-    for (size_t i = 0; i < str_split->size; i++) {
-        char* str_start = tokens->line_string_vec.elems[i];
-        char* str = str_start;
-        while (*str) {
-            Token* token = tokens_get(tokens, tokens_i);
-            token->src_line = i + 1;
-            tokens_get(tokens, tokens_i)->src_line_str = str_start;
-            tokens_i++;
-            str++;
-        }
+char* token_type_spelling(enum TokenType type) {
+    // Indexed from TK_DL_SEMICOLON, the first token type with a fixed spelling
+    static char* type_spellings[79] = {
+        ";",
+        ",",
+        ":",
+        ".",
+        "(",
+        ")",
+        "{",
+        "}",
+        "[",
+        "]",
+        "+",
+        "-",
+        "*",
+        "/",
+        "%",
+        ">>",
+        "<<",
+        "|",
+        "&",
+        "^",
+        "~",
+        "!",
+        "&&",
+        "||",
+        "==",
+        "!=",
+        ">",
+        "<",
+        "<=",
+        ">=",
+        "?",
+        "++",
+        "--",
+        "=",
+        "+=",
+        "-=",
+        "*=",
+        "/=",
+        "%=",
+        ">>=",
+        "<<=",
+        "&=",
+        "|=",
+        "^=",
+        "sizeof",
+        "->",
+        "if",
+        "else",
+        "while",
+        "do",
+        "for",
+        "break",
+        "continue",
+        "return",
+        "switch",
+        "case",
+        "default",
+        "goto",
+        "typedef",
+        "include",
+        "define",
+        "const",
+        "long",
+        "short",
+        "signed",
+        "unsigned",
+        "extern",
+        "static",
+        "struct",
+        "enum",
+        "union",
+        "int",
+        "float",
+        "double",
+        "char",
+        "void",
+        "...",
+        "#",
+        "##",
+    };
+    if (type < TK_DL_SEMICOLON) {
+        return NULL;
     }
-}
\ No newline at end of file
+    return type_spellings[type - TK_DL_SEMICOLON];
+}
@@ -2,8 +2,9 @@
 These functions perform tokenization of C source code. 
 This is the first step of a compiler. The semantics of the language are 
 separated into the Token type. To minimize dependencies to allow for self-compilation,
-the tokenization is done manually using various string helpers found in string_helpers.c
-Normally a task like this is more suited to regex.
+the tokenization is done manually in a single pass over the source lines, using
+the character helpers found in string_helpers.c. Tokens refer back into the
+source buffer instead of holding their own copy of the text.
 */
 #pragma once
 #include <stdlib.h>
@@ -12,6 +13,9 @@ Normally a task like this is more suited to regex.
 
 #include "util/vector.h"
 #include "util/string_helpers.h"
+#include "util/scan.h"
+#include "util/intern.h"
+#include "util/file_helpers.h"
 
 // Represents different token types in the C language
 enum TokenType {
@@ -104,51 +108,145 @@ enum TokenType {
     TK_KW_CHAR,
     TK_KW_VOID,
     TK_KW_VARIADIC_DOTS,
+    // Stringizing and token pasting operators of function-like defines
+    TK_PP_HASH,
+    TK_PP_HASHHASH,
 };
 
 typedef enum TokenType TokenType;
 
-// Represents a token object with various useful information
-struct Token {
-    enum TokenType type;
-    int src_pos;
-    int src_line;
-    // Further token origin information used for error messages and debugging
-    char* string_repr;
-    char* src_filename;
-    char* src_line_str;
-    bool requires_string_free;
-    bool src_line_requires_free;
+// A source buffer which token spans point into. Source files are kept for the
+// whole compilation, so file ids stay valid when tokens are moved between tables.
+// Files opened from disk are mapped read-only and shared between every include of the path
+struct SourceFile {
+    char* filename;
+    char* path; // Interned path the file was opened from, NULL for in-memory sources
+    char* src; // Followed by SCAN_PADDING zero bytes, which scan_line_end reads into
+    int size;
+    bool is_mapped; // src is a file mapping instead of an owned buffer
+    bool tag_debug_line_info;
+    Vec line_offsets; // int vec of line start offsets, built on the first line lookup
+    Vec line_strs; // char* vec of stripped lines, NULL until the line is requested
+};
+
+// Location of a token in its source file
+struct TokenSpan {
+    int file_id;
+    int offset;
+    int length;
 };
 
-// Represents a vector of tokens
+// Represents a table of tokens, with one array per token field.
+// Token text is only materialized from the source span when it is requested
 struct Tokens {
     int size;
-    Vec elems; // Token vec
-    StrVector line_string_vec; // Used for freeing
+    Vec types; // TokenType vec
+    Vec spans; // TokenSpan vec
+    Vec texts; // char* vec of interned strings, NULL until the token text has been materialized
+    // int vec of (#ifdef/#ifndef index, matching #endif index or -1) pairs in source order.
+    // Only built when a whole file is tokenized, empty otherwise
+    Vec conditionals;
 };
 
-typedef struct Token Token;
+typedef struct SourceFile SourceFile;
+typedef struct TokenSpan TokenSpan;
 typedef struct Tokens Tokens;
 
+#define TOKENS_INITIAL_CAPACITY 64
+
+// State of the single pass tokenizer, which scans the source one line at a time.
+// Block comments are the only tokens which can span several lines
+struct Tokenizer {
+    Tokens* tokens;
+    int file_id;
+    char* src;
+    char* next_line; // Start of the next line to tokenize
+    char* line; // Start of the current line, after leading whitespace
+    char* line_end; // End of the current line, before trailing whitespace
+    bool in_block_comment;
+    char* comment_start;
+    bool index_conditionals; // Record the #endif of every #ifdef/#ifndef in tokens->conditionals
+    Vec open_conditionals; // int vec, positions of the pairs waiting for their #endif
+};
+
+typedef struct Tokenizer Tokenizer;
+
+// ========= Source file functionality ===========
+
+// Add a copy of a source buffer to the source files, returns the file id
+int source_file_new(char* src, bool tag_debug_line_info);
+
+// Open a source file from disk without copying it, returns the file id.
+// A path which has already been opened returns the existing file
+int source_file_open(char* path, bool tag_debug_line_info);
+// Helper for the above, adds a source buffer which the source files take ownership of.
+// The buffer has to be padded like the ones of load_file_to_string
+int source_file_add(char* src, int size, bool tag_debug_line_info);
+
+// Get a source file from its file id
+SourceFile* source_file_get(int file_id);
+
+// Number of source files, file ids go from 0 up to this
+int source_file_count();
+
+// Free all source files. Token text and line information can not be
+// looked up after this, so this is done after code generation
+void source_files_free();
+
+// Line information for a source offset, found by binary search in the line offsets.
+// The line string is NULL if the file was not tagged with debug line info.
+// The lookups lock the line information, so threads can share it
+int source_file_get_line(int file_id, int offset);
+char* source_file_get_line_str(int file_id, int offset);
+// Helpers for the lookups, the line information has to be locked
+int source_file_find_line(SourceFile* file, int offset);
+void source_file_index_lines(SourceFile* file);
+void source_lines_lock();
+void source_lines_unlock();
+
 // ========= Tokens object functionality ===========
 
 // Create a new Tokens object
 Tokens tokens_new(int size);
 
-// Free the Tokens object
+// Reserve room for capacity tokens
+void tokens_reserve(Tokens* tokens, int capacity);
+
+// Free the Tokens object. Token texts are interned and stay valid
 void tokens_free(Tokens* tokens);
 
-// Free the Tokens line strings
-// This is separate, as we do not always want to free this
-void tokens_free_line_strings(Tokens* tokens);
+// Get and set the type of the token at index i
+TokenType tokens_get_type(Tokens* tokens, int i);
+void tokens_set_type(Tokens* tokens, int i, TokenType type);
 
-// Get a token from index i in Tokens
-Token* tokens_get(Tokens* tokens, int i);
+// Get the source span of the token at index i
+TokenSpan* tokens_get_span(Tokens* tokens, int i);
 
-// Set a token at index i in Tokens
-void tokens_set(Tokens* tokens, int i, TokenType type, char* string_repr,
-                bool requires_free);
+// Get the interned text of the token at index i, materializing it from the source if needed.
+// Token texts can be compared by pointer
+char* tokens_get_string(Tokens* tokens, int i);
+// Set the text of the token at index i to an interned copy of string_repr
+void tokens_set_string(Tokens* tokens, int i, char* string_repr);
+
+// Token origin information used for error messages and debugging
+int tokens_get_src_line(Tokens* tokens, int i);
+char* tokens_get_src_line_str(Tokens* tokens, int i);
+char* tokens_get_src_filename(Tokens* tokens, int i);
+
+// Append a token to the end of Tokens, returns the index of the new token
+int tokens_push(Tokens* tokens, TokenType type, TokenSpan span);
+
+// Append a copy of the token at src_i in src, returns the index of the new token
+int tokens_push_token(Tokens* dest, Tokens* src, int src_i);
+
+// Remove the last token
+void tokens_pop(Tokens* tokens);
+
+// Remove all tokens, keeping the allocated capacity
+void tokens_clear(Tokens* tokens);
+
+// Copy the token at src_i in src over the token at dest_i in dest
+void tokens_set_token(Tokens* dest, int dest_i, Tokens* src, int src_i);
 
 // Remove NULL elements from the token array
 void tokens_trim(Tokens* tokens);
@@ -156,6 +254,12 @@ void tokens_trim(Tokens* tokens);
 // Necessary to free correctly with tokens_free in some cases
 Tokens tokens_copy(Tokens* tokens);
 
+// Index of the #endif matching the #ifdef/#ifndef at index i, found with the conditional
+// index of the tokenizer. Returns -1 if the tokens have no index or there is no #endif
+int tokens_find_conditional_end(Tokens* tokens, int i);
+// Remove the conditional index, when the token indices change
+void tokens_drop_conditionals(Tokens* tokens);
+
 void tokens_tag_src_filename(Tokens* tokens, char* filename);
 
 // Print a Tokens object
@@ -172,41 +276,67 @@ Tokens* tokens_insert(Tokens* tokens1, Tokens* tokens2, int tokens1_index);
 // Convert a source string into a tokens object
 Tokens tokenize(char* source, bool tag_debug_line_info);
 
-// Tokenize preprocessor tokens
-void tokenize_preprocessor(Tokens* tokens, StrVector* split_src);
+// Tokenize a source file directly from its buffer
+Tokens tokenize_source_file(int file_id);
 
-// Tokenize comments
-void tokenize_comments(Tokens* tokens, StrVector* str_split);
+// Tokenize the value of a define, where # is an operator instead of the start of a
+// directive. The tokens do not end in EOF
+Tokens tokenize_define_value(char* source);
 
-// Tokenize strings
-void tokenize_strings(Tokens* tokens, StrVector* str_split);
-// Tokenize characters
-void tokenize_chars(Tokens* tokens, StrVector* str_split);
+// Start tokenizing a source file into tokens, one line at a time
+void tokenizer_init(Tokenizer* tokenizer, Tokens* tokens, int file_id);
 
-// Tokenize keywords
-void tokenize_keywords(Tokens* tokens, StrVector* str_split);
-// Helper for tokenize_keywords, tokenize a specific keyword
-void tokenize_keyword(Tokens* tokens, StrVector* str_split, char* keyword,
-                      enum TokenType type);
+// Tokenize the next line of the source file, appending to the tokens.
+// At the end of the source an EOF token is appended instead and false is returned
+bool tokenize_next_line(Tokenizer* tokenizer);
 
-void tokenize_ops(Tokens* tokens, StrVector* str_split);
-// Helper for tokenize_ops, tokenize a specific op
-void tokenize_op(Tokens* tokens, StrVector* str_split, char* op, enum TokenType type);
+// Like tokenize_next_line, but lines which can neither be a directive nor start or end
+// a block comment are skipped without producing tokens. Used for unused conditional blocks
+bool tokenize_next_directive_line(Tokenizer* tokenizer);
 
-// Tokenize all identifiers
-void tokenize_idents(Tokens* tokens, StrVector* str_split);
+// Tokenize a single line, continuing any block comment from the previous line
+void tokenize_line(Tokenizer* tokenizer);
 
-// Tokenize all literal values
-void tokenize_values(Tokens* tokens, StrVector* str_split);
-// Helpers for tokenize_values()
-void tokenize_ints(Tokens* tokens, StrVector* str_split);
-void tokenize_floats(Tokens* tokens, StrVector* str_split);
+// Set up the line boundaries for the line starting at str, returns the start of the next line
+char* tokenize_find_line(Tokenizer* tokenizer, char* str);
 
-// Tokenize delimiters
-void tokenize_delims(Tokens* tokens, StrVector* str_split);
+// Tokenize the token starting at str, returns the position after it
+char* tokenize_next(Tokenizer* tokenizer, char* str);
 
-// Tag tokens with their original source line
-void tag_tokens_with_src_lines(Tokens* tokens, StrVector* str_split);
+// Add a token of length characters starting at str on the current line,
+// returns the index of the new token
+int tokenizer_add(Tokenizer* tokenizer, char* str, int length, TokenType type);
+
+// Tokenize a preprocessor line and any comments on it
+void tokenize_preprocessor(Tokenizer* tokenizer);
+// Helper for tokenize_preprocessor, add a directive to the conditional index
+void tokenize_index_conditional(Tokenizer* tokenizer, char* directive, int directive_index);
+
+// Tokenize comments. Block comments may span several lines,
+// tokenize_block_comment_end returns the end of the line if the comment continues
+void tokenize_block_comment_start(Tokenizer* tokenizer, char* str);
+char* tokenize_block_comment_end(Tokenizer* tokenizer, char* str);
+
+// Tokenize strings and characters
+char* tokenize_quoted(Tokenizer* tokenizer, char* str, char quote, TokenType type);
+
+// Tokenize keywords and identifiers
+char* tokenize_word(Tokenizer* tokenizer, char* str);
+// Helpers for tokenize_word, classify a word as a keyword or TK_IDENT using
+// the perfect hash table generated into keyword_hash.h
+TokenType tokenize_keyword_type(char* str, int length);
+int tokenize_keyword_hash(char* str, int length);
+
+// Tokenize int and float literals
+char* tokenize_number(Tokenizer* tokenizer, char* str);
+
+// Tokenize operators and delimiters
+char* tokenize_punctuator(Tokenizer* tokenizer, char* str);
+// Helper for tokenize_punctuator, returns the length of op if it was matched
+int tokenize_op(Tokenizer* tokenizer, char* str, char* op, TokenType type);
 
 // Debug helper
-char* token_type_to_string(enum TokenType type);
\ No newline at end of file
+char* token_type_to_string(enum TokenType type);
+
+// Fixed spelling of keyword, operator and delimiter tokens, NULL for other tokens
+char* token_type_spelling(enum TokenType type);
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "type_table.h"
+
+static TypeTable* type_table = NULL;
+
+// Threads share the table, so it is locked while used. A CCIC build has no threads
+#ifndef CCIC
+#include <pthread.h>
+static pthread_mutex_t type_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void type_table_lock() {
+    pthread_mutex_lock(&type_table_mutex);
+}
+
+void type_table_unlock() {
+    pthread_mutex_unlock(&type_table_mutex);
+}
+#endif
+#ifdef CCIC
+void type_table_lock() {
+}
+
+void type_table_unlock() {
+}
+#endif
+
+int type_intern(VarType type) {
+    type_table_lock();
+    int id = type_table_insert(type_table_get(), type);
+    type_table_unlock();
+    return id;
+}
+
+// Intern a type, the table has to be locked
+int type_table_insert(TypeTable* table, VarType type) {
+    int hash = type_hash(&type);
+    int mask = table->capacity - 1;
+    int slot = hash & mask;
+    // Linear probing, the table is kept at most half full
+    while (table->slots[slot] != -1) {
+        int id = table->slots[slot];
+        VarType* existing = type_table_lookup(table, id);
+        if (table->hashes[slot] == hash && type_equals(existing, &type)) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    int id = table->count;
+    int chunk_index = id / TYPE_TABLE_CHUNK_SIZE;
+    if (chunk_index >= TYPE_TABLE_MAX_CHUNKS) {
+        fprintf(stderr, "Error: Too many distinct types\n");
+        exit(1);
+    }
+    if (id % TYPE_TABLE_CHUNK_SIZE == 0) {
+        table->chunks[chunk_index] = malloc(sizeof(VarType*) * TYPE_TABLE_CHUNK_SIZE);
+    }
+    VarType* stored = arena_alloc(table->arena, sizeof(VarType));
+    *stored = type;
+    VarType** chunk = table->chunks[chunk_index];
+    chunk[id % TYPE_TABLE_CHUNK_SIZE] = stored;
+    table->count++;
+    table->slots[slot] = id;
+    table->hashes[slot] = hash;
+    if (table->count * 2 > table->capacity) {
+        type_table_grow(table);
+    }
+    return id;
+}
+
+VarType* type_get(int id) {
+    // Stored types never move and an id is only handed out after its type is stored,
+    // so the table is only locked if it has not been created yet
+    TypeTable* table = type_table;
+    if (table == NULL) {
+        type_table_lock();
+        table = type_table_get();
+        type_table_unlock();
+    }
+    return type_table_lookup(table, id);
+}
+
+int type_count() {
+    type_table_lock();
+    int count = type_table_get()->count;
+    type_table_unlock();
+    return count;
+}
+
+VarType* type_table_lookup(TypeTable* table, int id) {
+    VarType** chunk = table->chunks[id / TYPE_TABLE_CHUNK_SIZE];
+    return chunk[id % TYPE_TABLE_CHUNK_SIZE];
+}
+
+void type_table_free() {
+    type_table_lock();
+    if (type_table == NULL) {
+        type_table_unlock();
+        return;
+    }
+    for (int i = 0; i * TYPE_TABLE_CHUNK_SIZE < type_table->count; i++) {
+        free(type_table->chunks[i]);
+    }
+    free(type_table->chunks);
+    free(type_table->slots);
+    free(type_table->hashes);
+    arena_free(type_table->arena);
+    free(type_table);
+    type_table = NULL;
+    type_table_unlock();
+}
+
+// The table is created on first use, with the zeroed type as id 0. It has to be locked
+TypeTable* type_table_get() {
+    if (type_table == NULL) {
+        // The table is only published once it is complete, as type_get reads it unlocked
+        TypeTable* table = calloc(1, sizeof(TypeTable));
+        table->chunks = calloc(TYPE_TABLE_MAX_CHUNKS, sizeof(VarType**));
+        table->capacity = TYPE_TABLE_INITIAL_CAPACITY;
+        table->slots = malloc(sizeof(int) * TYPE_TABLE_INITIAL_CAPACITY);
+        table->hashes = malloc(sizeof(int) * TYPE_TABLE_INITIAL_CAPACITY);
+        for (int i = 0; i < TYPE_TABLE_INITIAL_CAPACITY; i++) {
+            table->slots[i] = -1;
+        }
+        table->arena = arena_new();
+        VarType none;
+        memset(&none, 0, sizeof(VarType));
+        type_table_insert(table, none);
+        type_table = table;
+    }
+    return type_table;
+}
+
+int type_hash(VarType* type) {
+    long hash = 5381;
+    hash = (hash * 33 + type->type) & 1073741823;
+    hash = (hash * 33 + type->bytes) & 1073741823;
+    hash = (hash * 33 + type->ptr_level) & 1073741823;
+    hash = (hash * 33 + type->ptr_value_bytes) & 1073741823;
+    hash = (hash * 33 + type->array_size) & 1073741823;
+    hash = (hash * 33 + type->struct_bytes_offset) & 1073741823;
+    // Names are interned, so their pointers identify them
+    hash = (hash * 33 + (((long)type->struct_name / 8) & 1073741823)) & 1073741823;
+    hash = (hash * 33 + (((long)type->struct_member_name / 8) & 1073741823)) & 1073741823;
+    return (int)hash;
+}
+
+bool type_equals(VarType* type1, VarType* type2) {
+    return type1->type == type2->type && type1->bytes == type2->bytes &&
+           type1->ptr_level == type2->ptr_level &&
+           type1->ptr_value_bytes == type2->ptr_value_bytes &&
+           type1->is_unsigned == type2->is_unsigned &&
+           type1->is_extern == type2->is_extern &&
+           type1->is_static == type2->is_static && type1->is_const == type2->is_const &&
+           type1->is_array == type2->is_array && type1->array_size == type2->array_size &&
+           type1->array_has_initializer == type2->array_has_initializer &&
+           type1->struct_name == type2->struct_name &&
+           type1->struct_member_name == type2->struct_member_name &&
+           type1->struct_bytes_offset == type2->struct_bytes_offset &&
+           type1->is_struct_member == type2->is_struct_member &&
+           type1->widest_struct_member == type2->widest_struct_member;
+}
+
+// Double the table capacity and reinsert every type id
+void type_table_grow(TypeTable* table) {
+    int new_capacity = table->capacity * 2;
+    int* slots = malloc(sizeof(int) * new_capacity);
+    int* hashes = malloc(sizeof(int) * new_capacity);
+    for (int i = 0; i < new_capacity; i++) {
+        slots[i] = -1;
+    }
+    int mask = new_capacity - 1;
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->slots[i] != -1) {
+            int slot = table->hashes[i] & mask;
+            while (slots[slot] != -1) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = table->slots[i];
+            hashes[slot] = table->hashes[i];
+        }
+    }
+    free(table->slots);
+    free(table->hashes);
+    table->slots = slots;
+    table->hashes = hashes;
+    table->capacity = new_capacity;
+}
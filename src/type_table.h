@@ -0,0 +1,60 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/vector.h"
+#include "util/arena.h"
+#include "symbol_table.h"
+
+/*
+Global table of the types of expressions. Every distinct VarType is stored once and
+referred to by a small integer id, so AST nodes hold an id instead of a copy of the
+type and two types are equal exactly when their ids are equal.
+Id 0 is the zeroed type, the type of nodes which never had one set.
+Stored types are shared and must not be modified, copy the type and intern the copy
+to derive a new type. Types live until type_table_free is called at the end of
+compilation. The table is locked while types are interned, so parses in several
+threads can share it.
+*/
+
+#define TYPE_TABLE_INITIAL_CAPACITY 256
+#define TYPE_NONE 0
+// Ids are split into a chunk index and an index within the chunk
+#define TYPE_TABLE_CHUNK_SIZE 1024
+#define TYPE_TABLE_MAX_CHUNKS 4096
+
+struct TypeTable {
+    // Type pointers indexed by id, in chunks which never move once allocated. The chunk
+    // directory has a fixed size, so type_get can read without taking the lock
+    VarType*** chunks;
+    int count;
+    int capacity; // Power of two
+    int* slots; // Open addressing table of type ids, -1 if empty
+    int* hashes;
+    Arena* arena; // The types themselves, so pointers to them stay valid
+};
+
+typedef struct TypeTable TypeTable;
+
+// Intern a type, returns the id of the stored copy
+int type_intern(VarType type);
+
+// The stored type of an id
+VarType* type_get(int id);
+
+// Number of distinct types interned
+int type_count();
+
+// Free every interned type
+void type_table_free();
+
+// Helpers for the table
+void type_table_lock();
+void type_table_unlock();
+int type_table_insert(TypeTable* table, VarType type);
+VarType* type_table_lookup(TypeTable* table, int id);
+TypeTable* type_table_get();
+int type_hash(VarType* type);
+bool type_equals(VarType* type1, VarType* type2);
+void type_table_grow(TypeTable* table);
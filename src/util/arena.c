@@ -0,0 +1,42 @@
+#include "arena.h"
+
+Arena* arena_new() {
+    Arena* arena = calloc(1, sizeof(Arena));
+    arena->blocks = vec_new(sizeof(char*), 8);
+    return arena;
+}
+
+void* arena_alloc(Arena* arena, int size) {
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if (arena->block == NULL || arena->block_used + size > arena->block_size) {
+        // Start a new block, the rest of the current block is left unused
+        arena->block_size = ARENA_BLOCK_SIZE;
+        if (size > arena->block_size) {
+            arena->block_size = size;
+        }
+        arena->block = calloc(1, arena->block_size);
+        arena->block_used = 0;
+        vec_push(&arena->blocks, &arena->block);
+    }
+    void* memory = arena->block + arena->block_used;
+    arena->block_used += size;
+    arena->allocations++;
+    arena->bytes_allocated += size;
+    return memory;
+}
+
+char* arena_str(Arena* arena, char* str) {
+    int length = strlen(str);
+    char* copy = arena_alloc(arena, length + 1);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+void arena_free(Arena* arena) {
+    char** blocks = arena->blocks.elems;
+    for (int i = 0; i < arena->blocks.size; i++) {
+        free(blocks[i]);
+    }
+    vec_free(&arena->blocks);
+    free(arena);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vector.h"
+
+/*
+Bump pointer arena allocator. Allocations are carved out of large zeroed blocks
+and are never freed one by one, every block is released at once by arena_free.
+Used for memory which lives until the end of a compilation step, like the AST.
+*/
+
+#define ARENA_BLOCK_SIZE 262144
+// Allocations are aligned to this many bytes
+#define ARENA_ALIGNMENT 8
+
+struct Arena {
+    Vec blocks; // char* vec
+    char* block;
+    int block_used;
+    int block_size;
+    // Statistics
+    int allocations;
+    long bytes_allocated;
+};
+
+typedef struct Arena Arena;
+
+// Create an arena, the first block is allocated on the first allocation
+Arena* arena_new();
+
+// Allocate zeroed memory, which lives until the arena is freed
+void* arena_alloc(Arena* arena, int size);
+
+// Copy a C string into the arena
+char* arena_str(Arena* arena, char* str);
+
+// Free the arena and every allocation made from it
+void arena_free(Arena* arena);
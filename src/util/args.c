@@ -10,6 +10,22 @@ char* isolate_file_from_path(char* filepath) {
     return str_copy(filepath + index + 1);
 }
 
+char* object_filename(char* src_filename) {
+    char* filename = isolate_file_from_path(src_filename);
+    filename[strlen(filename) - 1] = 'o';
+    return filename;
+}
+
+char* dependency_filename(char* output_filename) {
+    char* filename = str_add(output_filename, ".d");
+    int length = strlen(filename);
+    if (str_endswith(output_filename, ".o")) {
+        filename[length - 3] = 'd';
+        filename[length - 2] = '\0';
+    }
+    return filename;
+}
+
 // Parse commandline options using getopt
 CompileOptions parse_compiler_options(int argc, char** argv) {
     opterr = 0;
@@ -18,7 +34,15 @@ CompileOptions parse_compiler_options(int argc, char** argv) {
     options.output_filename = "a.out";
     options.debug_annotate_assembly = false;
     options.keep_assembly = false;
+    options.build_pch = false;
+    options.token_cache_dir = NULL;
+    options.time_report = false;
+    options.dependency_filename = NULL;
+    options.src_filenames = NULL;
+    options.src_count = 0;
+    options.jobs = 1;
     bool output_file_set = false;
+    bool write_dependencies = false;
     int option_index = 0;
     struct option long_options[25];
     long_options[0].name = "outfile";
@@ -41,12 +65,38 @@ CompileOptions parse_compiler_options(int argc, char** argv) {
     long_options[3].flag = (int*)0;
     long_options[3].val = 'k';
 
-    long_options[4].name = 0;
-    long_options[4].has_arg = 0;
+    long_options[4].name = "build-pch";
+    long_options[4].has_arg = no_argument;
     long_options[4].flag = 0;
-    long_options[4].val = 0;
+    long_options[4].val = 'p';
+
+    long_options[5].name = "token-cache";
+    long_options[5].has_arg = required_argument;
+    long_options[5].flag = 0;
+    long_options[5].val = 't';
 
-    int opt_c = getopt_long(argc, argv, ":cgko:", long_options,
+    long_options[6].name = "MD";
+    long_options[6].has_arg = no_argument;
+    long_options[6].flag = 0;
+    long_options[6].val = 'M';
+
+    long_options[7].name = "MF";
+    long_options[7].has_arg = required_argument;
+    long_options[7].flag = 0;
+    long_options[7].val = 'F';
+
+    long_options[8].name = "time";
+    long_options[8].has_arg = no_argument;
+    long_options[8].flag = 0;
+    long_options[8].val = 'T';
+
+    long_options[9].name = 0;
+    long_options[9].has_arg = 0;
+    long_options[9].flag = 0;
+    long_options[9].val = 0;
+
+    // Long options can be given with a single dash, like -MD for gcc compatibility
+    int opt_c = getopt_long_only(argc, argv, ":cgkpo:t:j:", long_options,
                             &option_index);
     // Get command line flags
     while (opt_c != -1) {
@@ -64,37 +114,88 @@ CompileOptions parse_compiler_options(int argc, char** argv) {
             case 'k':
                 options.keep_assembly = true;
                 break;
+            case 'p':
+                options.build_pch = true;
+                break;
+            case 't':
+                options.token_cache_dir = optarg;
+                break;
+            case 'T':
+                options.time_report = true;
+                break;
+            case 'M':
+                write_dependencies = true;
+                break;
+            case 'F':
+                write_dependencies = true;
+                options.dependency_filename = optarg;
+                break;
+            case 'j':
+                options.jobs = atoi(optarg);
+                if (options.jobs < 1) {
+                    fprintf(stderr, "Error: Option '-j' requires a positive job count\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case '?':
-                if (optopt == 'o') {
+                if (optopt == 'o' || optopt == 't' || optopt == 'F' ||
+                    optopt == 'j') {
                     fprintf(stderr, "Error: Option '-%c' requires a file argument\n", optopt);
                 }
+                else if (optopt == 0) {
+                    // Unknown or ambiguous long option
+                    fprintf(stderr, "Error: Unknown option '%s' provided\n", argv[optind - 1]);
+                }
                 else {
                     fprintf(stderr, "Error: Unknown option '-%c' provided\n", optopt);
                 }
-                fprintf(stderr, "Usage: ./ccic [-c] [-o FILENAME] [-g] [--keepasm] <FILE> [FILES ...]\n");
+                fprintf(stderr, "Usage: ./ccic [-c] [-o FILENAME] [-g] [--keepasm] [--build-pch] [--token-cache DIR] [--time] [-MD] [-MF FILE] [-j JOBS] <FILE> [FILES ...]\n");
                 exit(EXIT_FAILURE);
             default:
                 exit(EXIT_FAILURE);
         }
-        opt_c = getopt_long(argc, argv, ":cgko:", long_options,
+        opt_c = getopt_long_only(argc, argv, ":cgkpo:t:j:", long_options,
                     &option_index);
     }
     // Isolate files to compile
     if (optind < argc) {
         options.src_filename = argv[optind];
+        options.src_filenames = &argv[optind];
+        options.src_count = argc - optind;
+        // Every object and make rule file is named after its source file when there are
+        // several source files, so a single output file can only be given when linking
+        if (options.src_count > 1 && output_file_set && !options.link_with_gcc) {
+            fprintf(stderr, "Error: Cannot specify '-o' with '-c' and multiple files\n");
+            exit(EXIT_FAILURE);
+        }
+        if (options.src_count > 1 && options.dependency_filename != NULL) {
+            fprintf(stderr, "Error: Cannot specify '-MF' with multiple files\n");
+            exit(EXIT_FAILURE);
+        }
+        // The objects of several linked files are removed, so they get no make rules
+        if (options.src_count > 1 && write_dependencies && options.link_with_gcc) {
+            fprintf(stderr, "Error: Cannot specify '-MD' with multiple files without '-c'\n");
+            exit(EXIT_FAILURE);
+        }
         if (!output_file_set && !options.link_with_gcc) {
             // If an output filename was not given and we are linking, use
             // the source file as output name
-            options.output_filename = isolate_file_from_path(options.src_filename);
-            options.output_filename[strlen(options.output_filename) - 1] = 'o';
+            options.output_filename = object_filename(options.src_filename);
         }
         else {
             options.output_filename = str_copy(options.output_filename);
         }
+        if (write_dependencies && options.dependency_filename == NULL) {
+            // Written next to the output, replacing an object file extension
+            options.dependency_filename = dependency_filename(options.output_filename);
+        }
+        else if (write_dependencies) {
+            options.dependency_filename = str_copy(options.dependency_filename);
+        }
     }
     else {
         fprintf(stderr, "Error: Please specify a source file to compile.\n");
-        fprintf(stderr, "Usage: ./ccic [-c] [-o FILENAME] [-g] [--keepasm] <FILE> [FILES ...]\n");
+        fprintf(stderr, "Usage: ./ccic [-c] [-o FILENAME] [-g] [--keepasm] [--build-pch] [--token-cache DIR] [--time] [-MD] [-MF FILE] [-j JOBS] <FILE> [FILES ...]\n");
         exit(EXIT_FAILURE);
     }
     return options;
@@ -10,16 +10,30 @@
 
 struct CompileOptions {
     char* src_filename;
+    char** src_filenames; // Every source file given, src_filename is the first
+    int src_count;
+    int jobs; // Source files compiled at once, or codegen threads of one file, set by -j
     char* output_filename;
     bool link_with_gcc;
     bool debug_annotate_assembly;
     bool keep_assembly;
+    bool build_pch; // Precompile the source file, which is a header, instead of compiling it
+    char* token_cache_dir; // Directory of the token cache, NULL if tokens are not cached
+    bool time_report; // Print the time spent in each compilation phase, set by --time
+    // Make rule file listing the files the output depends on, NULL if it is not written.
+    // Set by -MD to the output file with a .d extension, or by -MF FILE
+    char* dependency_filename;
 };
 
 typedef struct CompileOptions CompileOptions;
 
 CompileOptions parse_compiler_options(int argc, char** argv);
 
+// Object file of a source file compiled with -c, the source file name with a .o extension
+char* object_filename(char* src_filename);
+// Make rule file written next to an output file, replacing an object file extension
+char* dependency_filename(char* output_filename);
+
 // Isolate the directory of a filepath (exclude the file)
 char* isolate_file_dir(char* filepath);
 // Isolate the file of a filepath (exclude the dirs)
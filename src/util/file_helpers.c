@@ -16,8 +16,8 @@ char* load_file_to_string(char* filename) {
     size = ftell(file);
     rewind(file);
 
-    // Allocate memory for entire content
-    buffer = calloc(1, size + 1);
+    // Allocate memory for entire content, and the zero padding read by scan_line_end
+    buffer = calloc(1, size + SCAN_PADDING);
 
     // Copy the file contents into the buffer
     fread(buffer, size, 1, file);
@@ -26,6 +26,31 @@ char* load_file_to_string(char* filename) {
     return buffer;
 }
 
+char* map_file_to_string(char* filename, int* size) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror(filename);
+        exit(-1);
+    }
+    *size = lseek(fd, 0, SEEK_END);
+    int tail = FILE_MAP_PAGE_SIZE - *size % FILE_MAP_PAGE_SIZE;
+    if (*size == 0 || tail < SCAN_PADDING) {
+        close(fd);
+        return NULL;
+    }
+    char* src = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    // MAP_FAILED is (void*)-1
+    if ((long)src == -1) {
+        return NULL;
+    }
+    return src;
+}
+
+void unmap_file(char* src, int size) {
+    munmap(src, size);
+}
+
 void write_string_to_file(char* filename, char* src) {
     FILE* file = fopen(filename, "wb");
     fputs(src, file);
@@ -34,8 +59,9 @@ void write_string_to_file(char* filename, char* src) {
 
 // Compile Intel-syntax ASM using NASM and link with gcc
 // Example command: nasm -f elf64 -F dwarf -g output.asm && gcc -g -no-pie -o output output.o && rm output.o
-void compile_asm(char* asm_src, CompileOptions compile_options) {
+bool compile_asm(char* asm_src, CompileOptions compile_options) {
     char cmd_str[256];
+    int status = 0;
     snprintf(cmd_str, 255, "%s.asm", compile_options.output_filename);
     write_string_to_file(cmd_str, asm_src);
 
@@ -46,12 +72,12 @@ void compile_asm(char* asm_src, CompileOptions compile_options) {
                 cmd_str, 255,
                 "nasm -f elf64 -F dwarf -g %1$s.asm -o %1$s.o && gcc -g -no-pie -o %1$s %1$s.o && rm %1$s.o",
                 compile_options.output_filename);
-            system(cmd_str);
+            status = system(cmd_str);
         }
         else {
             snprintf(cmd_str, 255, "nasm -f elf64 -F dwarf -g %1$s.asm -o %1$s",
                      compile_options.output_filename);
-            system(cmd_str);
+            status = system(cmd_str);
         }
     }
     else {
@@ -60,16 +86,36 @@ void compile_asm(char* asm_src, CompileOptions compile_options) {
                 cmd_str, 255,
                 "nasm -f elf64 %1$s.asm -o %1$s.o && gcc -no-pie -o %1$s %1$s.o && rm %1$s.o",
                 compile_options.output_filename);
-            system(cmd_str);
+            status = system(cmd_str);
         }
         else {
             snprintf(cmd_str, 255, "nasm -f elf64 %1$s.asm -o %1$s",
                      compile_options.output_filename);
-            system(cmd_str);
+            status = system(cmd_str);
         }
     }
     if (!compile_options.keep_assembly) {
         snprintf(cmd_str, 255, "rm %1$s.asm", compile_options.output_filename);
         system(cmd_str);
     }
-}
\ No newline at end of file
+    return status == 0;
+}
+
+// Example command: gcc -g -no-pie -o output output.0.o output.1.o
+bool link_objects(char** object_filenames, int count, CompileOptions compile_options) {
+    StrVector args = str_vec_new(count + 5);
+    str_vec_push(&args, "gcc");
+    if (compile_options.debug_annotate_assembly) {
+        str_vec_push(&args, "-g");
+    }
+    str_vec_push(&args, "-no-pie -o");
+    str_vec_push(&args, compile_options.output_filename);
+    for (int i = 0; i < count; i++) {
+        str_vec_push(&args, object_filenames[i]);
+    }
+    char* cmd_str = str_vec_join_with_delim(&args, ' ');
+    int status = system(cmd_str);
+    free(cmd_str);
+    str_vec_free(&args);
+    return status == 0;
+}
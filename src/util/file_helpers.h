@@ -4,14 +4,33 @@
 #include <stdbool.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include "string_helpers.h"
+#include "scan.h"
 #include "args.h"
 
-// Load a file to a C string
+// Files are mapped in pages of this size
+#define FILE_MAP_PAGE_SIZE 4096
+
+// Load a file to a C string, followed by SCAN_PADDING zero bytes
 char* load_file_to_string(char* filename);
 
+// Map a file read-only as a C string, the mapping is size bytes long.
+// The zero filled tail of the last page terminates and pads the string, so NULL is
+// returned if the file is empty or the tail is shorter than SCAN_PADDING, and also if
+// mapping fails
+char* map_file_to_string(char* filename, int* size);
+
+// Unmap a file mapped with map_file_to_string
+void unmap_file(char* src, int size);
+
 // Write a C string to file
 void write_string_to_file(char* filename, char* src);
 
-// Compile Intel-syntax ASM using the NASM assembler and link with gcc
-void compile_asm(char* asm_src, CompileOptions compile_options);
\ No newline at end of file
+// Compile Intel-syntax ASM using the NASM assembler and link with gcc.
+// Returns false if assembling or linking failed
+bool compile_asm(char* asm_src, CompileOptions compile_options);
+
+// Link object files to the output file of the options with gcc, returns false on failure
+bool link_objects(char** object_filenames, int count, CompileOptions compile_options);
\ No newline at end of file
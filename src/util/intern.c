@@ -0,0 +1,134 @@
+#include "intern.h"
+
+static InternPool* intern_pool = NULL;
+
+// Threads share the pool, so it is locked while used. A CCIC build has no threads
+#ifndef CCIC
+#include <pthread.h>
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void intern_pool_lock() {
+    pthread_mutex_lock(&intern_mutex);
+}
+
+void intern_pool_unlock() {
+    pthread_mutex_unlock(&intern_mutex);
+}
+#endif
+#ifdef CCIC
+void intern_pool_lock() {
+}
+
+void intern_pool_unlock() {
+}
+#endif
+
+char* intern_str(char* str) {
+    return intern_str_n(str, strlen(str));
+}
+
+char* intern_str_n(char* str, int length) {
+    int hash = intern_hash(str, length);
+    intern_pool_lock();
+    char* interned = intern_pool_insert(str, length, hash);
+    intern_pool_unlock();
+    return interned;
+}
+
+// Intern a string, the pool has to be locked
+char* intern_pool_insert(char* str, int length, int hash) {
+    if (intern_pool == NULL) {
+        intern_pool = calloc(1, sizeof(InternPool));
+        intern_pool->capacity = INTERN_INITIAL_CAPACITY;
+        intern_pool->slots = calloc(INTERN_INITIAL_CAPACITY, sizeof(char*));
+        intern_pool->hashes = calloc(INTERN_INITIAL_CAPACITY, sizeof(int));
+        intern_pool->blocks = vec_new(sizeof(char*), 4);
+    }
+    InternPool* pool = intern_pool;
+    int mask = pool->capacity - 1;
+    int slot = hash & mask;
+    // Linear probing, the table is kept at most half full
+    while (pool->slots[slot] != NULL) {
+        char* interned = pool->slots[slot];
+        if (pool->hashes[slot] == hash && strncmp(interned, str, length) == 0 &&
+            interned[length] == '\0') {
+            return interned;
+        }
+        slot = (slot + 1) & mask;
+    }
+    char* interned = intern_pool_store(pool, str, length);
+    pool->slots[slot] = interned;
+    pool->hashes[slot] = hash;
+    pool->size++;
+    if (pool->size * 2 > pool->capacity) {
+        intern_pool_grow(pool);
+    }
+    return interned;
+}
+
+void intern_pool_free() {
+    intern_pool_lock();
+    if (intern_pool == NULL) {
+        intern_pool_unlock();
+        return;
+    }
+    char** blocks = intern_pool->blocks.elems;
+    for (size_t i = 0; i < intern_pool->blocks.size; i++) {
+        free(blocks[i]);
+    }
+    vec_free(&intern_pool->blocks);
+    free(intern_pool->slots);
+    free(intern_pool->hashes);
+    free(intern_pool);
+    intern_pool = NULL;
+    intern_pool_unlock();
+}
+
+int intern_hash(char* str, int length) {
+    long hash = 5381;
+    for (int i = 0; i < length; i++) {
+        hash = (hash * 33 + (((int)str[i]) & 255)) & 1073741823;
+    }
+    return (int)hash;
+}
+
+// Copy a string into the current block, starting a new block if it does not fit
+char* intern_pool_store(InternPool* pool, char* str, int length) {
+    if (pool->block == NULL || pool->block_used + length + 1 > pool->block_size) {
+        pool->block_size = INTERN_BLOCK_SIZE;
+        if (length + 1 > pool->block_size) {
+            pool->block_size = length + 1;
+        }
+        pool->block = malloc(pool->block_size);
+        pool->block_used = 0;
+        vec_push(&pool->blocks, &pool->block);
+    }
+    char* interned = pool->block + pool->block_used;
+    memcpy(interned, str, length);
+    interned[length] = '\0';
+    pool->block_used += length + 1;
+    return interned;
+}
+
+// Double the table capacity and reinsert every string
+void intern_pool_grow(InternPool* pool) {
+    int new_capacity = pool->capacity * 2;
+    int mask = new_capacity - 1;
+    char** slots = calloc(new_capacity, sizeof(char*));
+    int* hashes = calloc(new_capacity, sizeof(int));
+    for (int i = 0; i < pool->capacity; i++) {
+        if (pool->slots[i] != NULL) {
+            int slot = pool->hashes[i] & mask;
+            while (slots[slot] != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = pool->slots[i];
+            hashes[slot] = pool->hashes[i];
+        }
+    }
+    free(pool->slots);
+    free(pool->hashes);
+    pool->slots = slots;
+    pool->hashes = hashes;
+    pool->capacity = new_capacity;
+}
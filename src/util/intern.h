@@ -0,0 +1,47 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vector.h"
+
+/*
+Global string interning pool. Every distinct string is stored once, so
+interned strings can be compared by pointer instead of with strcmp.
+Token texts, preprocessor names and symbol names are all interned.
+Interned strings live until intern_pool_free is called at the end of compilation.
+The pool is locked while it is used, so parses in several threads can share it.
+*/
+
+#define INTERN_INITIAL_CAPACITY 1024
+#define INTERN_BLOCK_SIZE 65536
+
+struct InternPool {
+    int size;
+    int capacity; // Power of two
+    char** slots; // Open addressing table of interned strings, NULL if empty
+    int* hashes;
+    // Strings are stored back to back in large blocks
+    Vec blocks; // char* vec
+    char* block;
+    int block_used;
+    int block_size;
+};
+
+typedef struct InternPool InternPool;
+
+// Intern a C string, returns the pooled copy
+char* intern_str(char* str);
+
+// Intern the first length characters of str, returns the pooled copy
+char* intern_str_n(char* str, int length);
+
+// Free every interned string
+void intern_pool_free();
+
+// Helpers for the pool
+void intern_pool_lock();
+void intern_pool_unlock();
+char* intern_pool_insert(char* str, int length, int hash);
+int intern_hash(char* str, int length);
+char* intern_pool_store(InternPool* pool, char* str, int length);
+void intern_pool_grow(InternPool* pool);
@@ -0,0 +1,291 @@
+#include "scan.h"
+
+// Kernel level used by the dispatching functions, scalar until scan_init is called
+static ScanLevel scan_level = SCAN_SCALAR;
+
+// SIMD kernels, these are not available when bootstrapping
+#ifndef CCIC
+#ifdef __x86_64__
+#define SCAN_HAS_SIMD
+#include <immintrin.h>
+
+// Find a '\n' or '\0'. A block without either is before the terminator, so the last
+// block starts at or before it and ends within the SCAN_PADDING of the buffer
+static char* scan_line_end_sse2(char* str) {
+    __m128i newline = _mm_set1_epi8('\n');
+    __m128i zero = _mm_setzero_si128();
+    while (true) {
+        __m128i chunk = _mm_loadu_si128((__m128i*)str);
+        unsigned int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, zero)));
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 16;
+    }
+}
+
+static char* scan_skip_blanks_sse2(char* str, char* end) {
+    __m128i space = _mm_set1_epi8(' ');
+    __m128i tab = _mm_set1_epi8('\t');
+    while (str + 16 <= end) {
+        __m128i chunk = _mm_loadu_si128((__m128i*)str);
+        unsigned int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)));
+        mask = ~mask & 65535;
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 16;
+    }
+    return scan_skip_blanks_scalar(str, end);
+}
+
+// Identifier characters are [a-zA-Z0-9_]. Characters above 127 compare as negative
+// and are never identifier characters
+static unsigned int scan_ident_mask_sse2(__m128i chunk) {
+    __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(32));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+    __m128i underscore = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), underscore));
+}
+
+static char* scan_ident_end_sse2(char* str, char* end) {
+    while (str + 16 <= end) {
+        unsigned int mask = ~scan_ident_mask_sse2(_mm_loadu_si128((__m128i*)str)) & 65535;
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 16;
+    }
+    return scan_ident_end_scalar(str, end);
+}
+
+static char* scan_find_either_sse2(char* str, char* end, char c1, char c2) {
+    __m128i match1 = _mm_set1_epi8(c1);
+    __m128i match2 = _mm_set1_epi8(c2);
+    while (str + 16 <= end) {
+        __m128i chunk = _mm_loadu_si128((__m128i*)str);
+        unsigned int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, match1), _mm_cmpeq_epi8(chunk, match2)));
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 16;
+    }
+    return scan_find_either_scalar(str, end, c1, c2);
+}
+
+__attribute__((target("avx2"))) static char* scan_line_end_avx2(char* str) {
+    __m256i newline = _mm256_set1_epi8('\n');
+    __m256i zero = _mm256_setzero_si256();
+    while (true) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*)str);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, zero)));
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 32;
+    }
+}
+
+__attribute__((target("avx2"))) static char* scan_skip_blanks_avx2(char* str, char* end) {
+    __m256i space = _mm256_set1_epi8(' ');
+    __m256i tab = _mm256_set1_epi8('\t');
+    while (str + 32 <= end) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*)str);
+        unsigned int mask = ~_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)));
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 32;
+    }
+    return scan_skip_blanks_sse2(str, end);
+}
+
+__attribute__((target("avx2"))) static char* scan_ident_end_avx2(char* str, char* end) {
+    __m256i a_before = _mm256_set1_epi8('a' - 1);
+    __m256i z_after = _mm256_set1_epi8('z' + 1);
+    __m256i zero_before = _mm256_set1_epi8('0' - 1);
+    __m256i nine_after = _mm256_set1_epi8('9' + 1);
+    __m256i underscore = _mm256_set1_epi8('_');
+    __m256i case_bit = _mm256_set1_epi8(32);
+    while (str + 32 <= end) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*)str);
+        __m256i lower = _mm256_or_si256(chunk, case_bit);
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, a_before),
+                                         _mm256_cmpgt_epi8(z_after, lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, zero_before),
+                                         _mm256_cmpgt_epi8(nine_after, chunk));
+        __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit),
+                                        _mm256_cmpeq_epi8(chunk, underscore));
+        unsigned int mask = ~_mm256_movemask_epi8(ident);
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 32;
+    }
+    return scan_ident_end_sse2(str, end);
+}
+
+__attribute__((target("avx2"))) static char* scan_find_either_avx2(char* str, char* end,
+                                                                   char c1, char c2) {
+    __m256i match1 = _mm256_set1_epi8(c1);
+    __m256i match2 = _mm256_set1_epi8(c2);
+    while (str + 32 <= end) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*)str);
+        unsigned int mask = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, match1), _mm256_cmpeq_epi8(chunk, match2)));
+        if (mask != 0) {
+            return str + __builtin_ctz(mask);
+        }
+        str += 32;
+    }
+    return scan_find_either_sse2(str, end, c1, c2);
+}
+
+#endif
+#endif
+
+// ================ Kernel selection ===================
+
+void scan_init() {
+    scan_set_level(SCAN_AVX2);
+}
+
+ScanLevel scan_set_level(ScanLevel level) {
+    // Every x86-64 CPU has SSE2, AVX2 has to be checked with CPUID
+    ScanLevel max_level = SCAN_SCALAR;
+#ifdef SCAN_HAS_SIMD
+    max_level = SCAN_SSE2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        max_level = SCAN_AVX2;
+    }
+#endif
+    if (level > max_level) {
+        level = max_level;
+    }
+    scan_level = level;
+    return level;
+}
+
+ScanLevel scan_get_level() {
+    return scan_level;
+}
+
+char* scan_level_to_string(ScanLevel level) {
+    switch (level) {
+        case SCAN_SCALAR:
+            return "scalar";
+        case SCAN_SSE2:
+            return "sse2";
+        case SCAN_AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+// ================ Dispatching kernels ===================
+
+char* scan_line_end(char* str) {
+#ifdef SCAN_HAS_SIMD
+    if (scan_level == SCAN_AVX2) {
+        return scan_line_end_avx2(str);
+    }
+    if (scan_level == SCAN_SSE2) {
+        return scan_line_end_sse2(str);
+    }
+#endif
+    return scan_line_end_scalar(str);
+}
+
+char* scan_skip_blanks(char* str, char* end) {
+#ifdef SCAN_HAS_SIMD
+    if (scan_level == SCAN_AVX2) {
+        return scan_skip_blanks_avx2(str, end);
+    }
+    if (scan_level == SCAN_SSE2) {
+        return scan_skip_blanks_sse2(str, end);
+    }
+#endif
+    return scan_skip_blanks_scalar(str, end);
+}
+
+char* scan_ident_end(char* str, char* end) {
+#ifdef SCAN_HAS_SIMD
+    if (scan_level == SCAN_AVX2) {
+        return scan_ident_end_avx2(str, end);
+    }
+    if (scan_level == SCAN_SSE2) {
+        return scan_ident_end_sse2(str, end);
+    }
+#endif
+    return scan_ident_end_scalar(str, end);
+}
+
+char* scan_find_either(char* str, char* end, char c1, char c2) {
+#ifdef SCAN_HAS_SIMD
+    if (scan_level == SCAN_AVX2) {
+        return scan_find_either_avx2(str, end, c1, c2);
+    }
+    if (scan_level == SCAN_SSE2) {
+        return scan_find_either_sse2(str, end, c1, c2);
+    }
+#endif
+    return scan_find_either_scalar(str, end, c1, c2);
+}
+
+char* scan_comment_end(char* str, char* end) {
+    // The character after end is never a '/', as end is the end of a line
+    while (str < end) {
+        str = scan_find_either(str, end, '*', '*');
+        if (str < end && *(str + 1) == '/') {
+            return str;
+        }
+        str++;
+    }
+    return end;
+}
+
+char* scan_padded_copy(char* str) {
+    int length = strlen(str);
+    char* copy = calloc(1, length + SCAN_PADDING);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+// ================ Scalar kernels ===================
+
+char* scan_line_end_scalar(char* str) {
+    while (*str != '\n' && *str != '\0') {
+        str++;
+    }
+    return str;
+}
+
+char* scan_skip_blanks_scalar(char* str, char* end) {
+    while (str < end && (*str == ' ' || *str == '\t')) {
+        str++;
+    }
+    return str;
+}
+
+char* scan_ident_end_scalar(char* str, char* end) {
+    while (str < end && (c_isalnum(*str) || *str == '_')) {
+        str++;
+    }
+    return str;
+}
+
+char* scan_find_either_scalar(char* str, char* end, char c1, char c2) {
+    while (str < end && *str != c1 && *str != c2) {
+        str++;
+    }
+    return str;
+}
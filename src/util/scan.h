@@ -0,0 +1,59 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "string_helpers.h"
+
+/*
+Scanning primitives used by the tokenizer and string helpers. Each kernel has
+a scalar version and, when built with gcc for x86-64, SSE2 and AVX2 versions
+which compare 16 or 32 characters at a time. The kernel level is selected
+at runtime from the CPU features by scan_init. A CCIC build only has the
+scalar versions, so bootstrapping does not need any intrinsics.
+*/
+
+enum ScanLevel {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+};
+
+typedef enum ScanLevel ScanLevel;
+
+// Zero bytes after the content of every source buffer. Source files are loaded, mapped
+// and copied with at least this padding, which scan_line_end relies on
+#define SCAN_PADDING 32
+
+// Select the fastest kernel level supported by the CPU
+void scan_init();
+
+// Set the kernel level, capped to what the CPU supports. Returns the level used
+ScanLevel scan_set_level(ScanLevel level);
+ScanLevel scan_get_level();
+
+// Name of a kernel level, for benchmarks
+char* scan_level_to_string(ScanLevel level);
+
+// Return the first '\n' or '\0' at or after str. The kernels read whole blocks of up
+// to 32 bytes, so str has to be in a buffer with SCAN_PADDING bytes after its content
+char* scan_line_end(char* str);
+
+// Return the first character in [str, end) which is not a space or a tab, or end
+char* scan_skip_blanks(char* str, char* end);
+
+// Return the first character in [str, end) which can not be part of an identifier, or end
+char* scan_ident_end(char* str, char* end);
+
+// Return the first c1 or c2 in [str, end), or end
+char* scan_find_either(char* str, char* end, char c1, char c2);
+
+// Return the start of the first "*/" in [str, end), or end
+char* scan_comment_end(char* str, char* end);
+
+// Copy a string into a buffer with SCAN_PADDING zero bytes after it, owned by the caller
+char* scan_padded_copy(char* str);
+
+// Scalar versions of the kernels
+char* scan_line_end_scalar(char* str);
+char* scan_skip_blanks_scalar(char* str, char* end);
+char* scan_ident_end_scalar(char* str, char* end);
+char* scan_find_either_scalar(char* str, char* end, char c1, char c2);
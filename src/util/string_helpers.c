@@ -1,4 +1,5 @@
 #include "string_helpers.h"
+#include "scan.h"
 
 // ======================== String Vector =============================
 
@@ -138,15 +139,16 @@ StrVector str_split(char* str, char delimiter) {
 
 StrVector str_split_lines(char* str) {
     StrVector str_vec = str_vec_new(4);
+    // The string is not padded for scan_line_end, so its lines are found before its end
+    char* end = str + strlen(str);
     char* start = str;
+    str = scan_find_either(str, end, '\n', '\n');
     while (*str != '\0') {
-        if (*str == '\n') {
-            int length = str - start;
-            char* word = str_substr(start, length);
-            str_vec_push_no_copy(&str_vec, word);
-            start = str + 1;
-        }
-        str++;
+        int length = str - start;
+        char* word = str_substr(start, length);
+        str_vec_push_no_copy(&str_vec, word);
+        start = str + 1;
+        str = scan_find_either(start, end, '\n', '\n');
     }
     if (start != str) {
         char* word = str_substr(start, str - start);
@@ -416,21 +418,3 @@ int min(int a, int b) {
     else
         return b;
 }
-
-// These are implemented manually because this compiler does not support
-// macro functions which is how they are implemented in GCC
-bool c_isdigit(char c) {
-    return (c >= 48 && c <= 57);
-}
-
-bool c_isalpha(char c) {
-    return (c >= 65 && c <= 90) || (c >= 97 && c <= 122);
-}
-
-bool c_isalnum(char c) {
-    return (c_isdigit(c) || c_isalpha(c));
-}
-
-bool c_isspace(char c) {
-    return c == ' ' || c == '\n' || c == '\t';
-}
\ No newline at end of file
@@ -108,12 +108,12 @@ int max(int a, int b);
 
 int min(int a, int b);
 
-// These are implemented manually because this compiler does not support
-// macro functions which is how they are implemented in GCC
-bool c_isdigit(char c);
+// Character classes, as macros so the tokenizer does not make a call per character.
+// The argument is evaluated more than once
+#define c_isdigit(c) ((c) >= '0' && (c) <= '9')
 
-bool c_isalpha(char c);
+#define c_isalpha(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
 
-bool c_isalnum(char c);
+#define c_isalnum(c) (c_isdigit(c) || c_isalpha(c))
 
-bool c_isspace(char c);
\ No newline at end of file
+#define c_isspace(c) ((c) == ' ' || (c) == '\n' || (c) == '\t')
\ No newline at end of file
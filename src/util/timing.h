@@ -0,0 +1,10 @@
+#pragma once
+#include <time.h>
+
+/*
+Wall clock timing, used by the time report of the compiler. The monotonic clock
+is used, so the time includes the assembler process and every codegen thread.
+*/
+
+// Microseconds on the monotonic clock, only differences between two calls are meaningful
+long time_now_us();
@@ -0,0 +1,32 @@
+#include <stdio.h>
+
+#include "tokenizer_bench.h"
+#include "scan_bench.h"
+#include "preprocessor_bench.h"
+#include "pch_bench.h"
+#include "token_cache_bench.h"
+#include "parser_bench.h"
+#include "symbol_table_bench.h"
+
+// Benchmarks take the source files to measure on as arguments
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("Usage: ccic-bench <source files>\n");
+        return 1;
+    }
+    StrVector files = str_vec_new(argc - 1);
+    for (int i = 1; i < argc; i++) {
+        str_vec_push(&files, argv[i]);
+    }
+    scan_init();
+    printf("[BENCH] Running benchmarks on %d files...\n", (int) files.size);
+    bench_tokenizer(&files);
+    bench_scan(&files);
+    bench_preprocessor(&files);
+    bench_pch();
+    bench_token_cache(&files);
+    bench_parser(&files);
+    bench_symbol_table();
+    str_vec_free(&files);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <time.h>
+#include "tokenizer_bench.h"
+#include "../../src/preprocess.h"
+#include "../../src/parser.h"
+#include "../../src/codegen.h"
+
+#define PARSER_BENCH_ITERATIONS 20
+#define PARSER_BENCH_FILE "build/parser_bench.c"
+#define PARSER_BENCH_STATEMENTS 100000
+#define PARSER_BENCH_CODEGEN_THREADS 4
+
+// Parse preprocessed tokens and generate assembly for them, timing the parse, the code
+// generation and the teardown of the AST separately. Code is not generated if
+// codegen_seconds is NULL. Returns the number of nodes
+long bench_parser_tokens(Tokens* tokens, double* parse_seconds, double* codegen_seconds,
+                         double* free_seconds) {
+    clock_t start = clock();
+    SymbolTable* symbols = symbol_table_new();
+    AST ast = parse(tokens, symbols);
+    *parse_seconds += bench_seconds_since(start);
+    long node_count = ast_node_count(&ast);
+    if (codegen_seconds != NULL) {
+        start = clock();
+        char* asm_src = generate_assembly(&ast, symbols, false);
+        *codegen_seconds += bench_seconds_since(start);
+        free(asm_src);
+    }
+    start = clock();
+    ast_free(&ast);
+    *free_seconds += bench_seconds_since(start);
+    symbol_table_free(symbols);
+    return node_count;
+}
+
+// Parse every C source file, as the compiler does after preprocessing
+void bench_parser_files(StrVector* files) {
+    long node_count = 0;
+    int file_count = 0;
+    double parse_seconds = 0;
+    double codegen_seconds = 0;
+    double free_seconds = 0;
+    for (size_t i = 0; i < files->size; i++) {
+        if (!str_endswith(files->elems[i], ".c")) {
+            continue;
+        }
+        file_count++;
+        PreprocessorTable table = preprocessor_table_new();
+        Tokens tokens = preprocess_first(files->elems[i], &table);
+        for (int n = 0; n < PARSER_BENCH_ITERATIONS; n++) {
+            node_count +=
+                bench_parser_tokens(&tokens, &parse_seconds, &codegen_seconds,
+                                    &free_seconds);
+        }
+        tokens_free(&tokens);
+        preprocessor_table_free(&table);
+        source_files_free();
+    }
+    node_count = node_count / PARSER_BENCH_ITERATIONS;
+    printf("[BENCH] parse, per file:   %8.2f ms (%d files, %ld nodes)\n",
+           parse_seconds * 1e3 / PARSER_BENCH_ITERATIONS, file_count, node_count);
+    printf("[BENCH] codegen, per file: %8.2f ms\n",
+           codegen_seconds * 1e3 / PARSER_BENCH_ITERATIONS);
+    printf("[BENCH] AST teardown:      %8.2f ms (%.2f ns/node)\n",
+           free_seconds * 1e3 / PARSER_BENCH_ITERATIONS,
+           free_seconds * 1e9 / PARSER_BENCH_ITERATIONS / node_count);
+}
+
+// Wall clock time in seconds, as clock() adds up the time of every thread
+double bench_wall_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Generate the assembly of every C source file on one thread and on several threads
+void bench_codegen_threads(StrVector* files) {
+    double serial_seconds = 0;
+    double threaded_seconds = 0;
+    for (size_t i = 0; i < files->size; i++) {
+        if (!str_endswith(files->elems[i], ".c")) {
+            continue;
+        }
+        PreprocessorTable table = preprocessor_table_new();
+        Tokens tokens = preprocess_first(files->elems[i], &table);
+        SymbolTable* symbols = symbol_table_new();
+        AST ast = parse(&tokens, symbols);
+        for (int n = 0; n < PARSER_BENCH_ITERATIONS; n++) {
+            double start = bench_wall_seconds();
+            char* asm_src = generate_assembly(&ast, symbols, false);
+            serial_seconds += bench_wall_seconds() - start;
+            free(asm_src);
+            start = bench_wall_seconds();
+            asm_src = generate_assembly_threaded(&ast, symbols, false,
+                                                 PARSER_BENCH_CODEGEN_THREADS);
+            threaded_seconds += bench_wall_seconds() - start;
+            free(asm_src);
+        }
+        ast_free(&ast);
+        symbol_table_free(symbols);
+        tokens_free(&tokens);
+        preprocessor_table_free(&table);
+        source_files_free();
+    }
+    printf("[BENCH] codegen, 1 thread:   %8.2f ms/pass (wall clock)\n",
+           serial_seconds * 1e3 / PARSER_BENCH_ITERATIONS);
+    printf("[BENCH] codegen, %d threads:  %8.2f ms/pass (wall clock)\n",
+           PARSER_BENCH_CODEGEN_THREADS,
+           threaded_seconds * 1e3 / PARSER_BENCH_ITERATIONS);
+}
+
+// One function with a very long body, the AST has hundreds of thousands of nodes.
+// Code generation recurses once per statement, so only the parse is measured
+void bench_parser_large_function() {
+    StrVector lines = str_vec_new(PARSER_BENCH_STATEMENTS + 4);
+    str_vec_push(&lines, "int main() {");
+    str_vec_push(&lines, "    int x = 0;");
+    for (int i = 0; i < PARSER_BENCH_STATEMENTS; i++) {
+        str_vec_push(&lines, "    x = x + 1;");
+    }
+    str_vec_push(&lines, "    return x;");
+    str_vec_push(&lines, "}");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file(PARSER_BENCH_FILE, src);
+    free(src);
+    str_vec_free(&lines);
+
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first(PARSER_BENCH_FILE, &table);
+    double parse_seconds = 0;
+    double free_seconds = 0;
+    long node_count = bench_parser_tokens(&tokens, &parse_seconds, NULL, &free_seconds);
+    printf("[BENCH] parse, large function: %8.2f ms (%ld nodes, teardown %.2f ms)\n",
+           parse_seconds * 1e3, node_count, free_seconds * 1e3);
+    tokens_free(&tokens);
+    preprocessor_table_free(&table);
+    source_files_free();
+    remove(PARSER_BENCH_FILE);
+}
+
+void bench_parser(StrVector* files) {
+    bench_parser_files(files);
+    bench_codegen_threads(files);
+    bench_parser_large_function();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <time.h>
+#include "tokenizer_bench.h"
+#include "../../src/pch.h"
+#include "../../src/parser.h"
+#include "../../src/codegen.h"
+
+#define PCH_BENCH_ITERATIONS 200
+#define PCH_BENCH_HEADER "build/pch_bench.h"
+#define PCH_BENCH_FILE "build/pch_bench.c"
+
+// A hello world program, which includes the libc headers through one header
+void bench_pch_write_files() {
+    StrVector lines = str_vec_new(16);
+    str_vec_push(&lines, "#pragma once");
+    str_vec_push(&lines, "#include <stdio.h>");
+    str_vec_push(&lines, "#include <stdlib.h>");
+    str_vec_push(&lines, "#include <string.h>");
+    str_vec_push(&lines, "#include <ctype.h>");
+    str_vec_push(&lines, "#include <math.h>");
+    str_vec_push(&lines, "#include <unistd.h>");
+    str_vec_push(&lines, "#include <stdint.h>");
+    str_vec_push(&lines, "#include <stdbool.h>");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file(PCH_BENCH_HEADER, src);
+    free(src);
+    str_vec_free(&lines);
+    write_string_to_file(PCH_BENCH_FILE, "#include \"pch_bench.h\"\n\nint main() {\n"
+                                         "    printf(\"Hello, world!\\n\");\n    return 0;\n}\n");
+}
+
+// Preprocess, parse and generate assembly for the hello world program, like the compiler does
+// apart from assembling. Returns the time per compile in seconds
+double bench_pch_compile() {
+    clock_t start = clock();
+    for (int n = 0; n < PCH_BENCH_ITERATIONS; n++) {
+        PreprocessorTable table = preprocessor_table_new();
+        TokenStream stream = token_stream_new(PCH_BENCH_FILE, &table);
+        SymbolTable* symbols = symbol_table_new();
+        AST ast = parse_token_stream(&stream, symbols);
+        char* asm_src = generate_assembly(&ast, symbols, false);
+        symbol_table_free(symbols);
+        preprocessor_table_free(&table);
+        token_stream_free(&stream);
+        source_files_free();
+        ast_free(&ast);
+        free(asm_src);
+    }
+    return bench_seconds_since(start) / PCH_BENCH_ITERATIONS;
+}
+
+// Compile hello world with the libc headers preprocessed every time, and with them precompiled
+void bench_pch() {
+    bench_pch_write_files();
+    char* pch_file = pch_path(PCH_BENCH_HEADER);
+    remove(pch_file);
+    double seconds = bench_pch_compile();
+
+    source_files_free();
+    int token_count = pch_build(PCH_BENCH_HEADER);
+    source_files_free();
+    int loaded_before = pch_headers_loaded();
+    double pch_seconds = bench_pch_compile();
+
+    printf("[BENCH] hello world compile:     %8.2f us\n", seconds * 1e6);
+    printf("[BENCH] hello world compile pch: %8.2f us (%d header tokens, %d loads)\n",
+           pch_seconds * 1e6, token_count, pch_headers_loaded() - loaded_before);
+    remove(pch_file);
+    remove(PCH_BENCH_HEADER);
+    remove(PCH_BENCH_FILE);
+    free(pch_file);
+}
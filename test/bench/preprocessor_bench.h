@@ -0,0 +1,205 @@
+#pragma once
+#include <time.h>
+#include "tokenizer_bench.h"
+#include "../../src/preprocess.h"
+
+#define PREPROCESSOR_BENCH_DEFINES 4096
+#define PREPROCESSOR_BENCH_USES 8
+#define PREPROCESSOR_BENCH_ITERATIONS 20
+#define PREPROCESSOR_BENCH_LOOKUP_ITERATIONS 1000
+#define PREPROCESSOR_BENCH_FILE "build/preprocessor_bench.c"
+#define PREPROCESSOR_BENCH_BLOCKS 512
+#define PREPROCESSOR_BENCH_BLOCK_LINES 64
+
+// Interned names of the benchmark defines, and of identifiers which are not defined
+void bench_preprocessor_names(StrVector* defined, StrVector* undefined) {
+    char name[64];
+    for (int i = 0; i < PREPROCESSOR_BENCH_DEFINES; i++) {
+        snprintf(name, 64, "BENCH_MACRO_%d", i);
+        str_vec_push_no_copy(defined, intern_str(name));
+        snprintf(name, 64, "bench_var_%d", i);
+        str_vec_push_no_copy(undefined, intern_str(name));
+    }
+}
+
+// Insert thousands of defines, then look up defined and undefined names and undefine them
+void bench_preprocessor_table() {
+    StrVector defined = str_vec_new(PREPROCESSOR_BENCH_DEFINES);
+    StrVector undefined = str_vec_new(PREPROCESSOR_BENCH_DEFINES);
+    bench_preprocessor_names(&defined, &undefined);
+
+    clock_t start = clock();
+    PreprocessorTable table = preprocessor_table_new();
+    for (size_t i = 0; i < defined.size; i++) {
+        preprocessor_table_add_simple_define(&table, defined.elems[i]);
+    }
+    double insert_seconds = bench_seconds_since(start);
+
+    long found = 0;
+    start = clock();
+    for (int n = 0; n < PREPROCESSOR_BENCH_LOOKUP_ITERATIONS; n++) {
+        for (size_t i = 0; i < defined.size; i++) {
+            if (preprocessor_table_lookup_define(&table, defined.elems[i]) != NULL) {
+                found++;
+            }
+            if (preprocessor_table_lookup_define(&table, undefined.elems[i]) != NULL) {
+                found++;
+            }
+        }
+    }
+    double lookup_seconds = bench_seconds_since(start);
+
+    start = clock();
+    for (size_t i = 0; i < defined.size; i++) {
+        preprocessor_table_remove(&table, defined.elems[i]);
+    }
+    double remove_seconds = bench_seconds_since(start);
+    preprocessor_table_free(&table);
+
+    double lookups = (double)PREPROCESSOR_BENCH_LOOKUP_ITERATIONS * defined.size * 2;
+    printf("[BENCH] table insert:  %8.2f ns/define\n", insert_seconds * 1e9 / defined.size);
+    printf("[BENCH] table lookup:  %8.2f ns/lookup (%ld found of %.0f)\n",
+           lookup_seconds * 1e9 / lookups, found, lookups);
+    printf("[BENCH] table #undef:  %8.2f ns/define\n", remove_seconds * 1e9 / defined.size);
+    // The names are interned, so they are not freed with the vectors
+    free(defined.elems);
+    free(undefined.elems);
+}
+
+// Write a translation unit with thousands of defines, which are each used several times
+// between identifiers which are not defines
+void bench_preprocessor_write_file() {
+    StrVector lines = str_vec_new(PREPROCESSOR_BENCH_DEFINES * 2);
+    char line[128];
+    for (int i = 0; i < PREPROCESSOR_BENCH_DEFINES; i++) {
+        snprintf(line, 128, "#define BENCH_MACRO_%d %d", i, i);
+        str_vec_push(&lines, line);
+    }
+    str_vec_push(&lines, "int bench_uses() {");
+    for (int n = 0; n < PREPROCESSOR_BENCH_USES; n++) {
+        for (int i = 0; i < PREPROCESSOR_BENCH_DEFINES; i++) {
+            snprintf(line, 128, "    bench_var_%d = BENCH_MACRO_%d + bench_var_%d;", i, i, i);
+            str_vec_push(&lines, line);
+        }
+    }
+    str_vec_push(&lines, "}");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file(PREPROCESSOR_BENCH_FILE, src);
+    free(src);
+    str_vec_free(&lines);
+}
+
+// Stream the generated translation unit through the preprocessor, as the compiler does.
+// This mostly measures define lookups
+void bench_preprocessor_file() {
+    bench_preprocessor_write_file();
+    long token_count = 0;
+    clock_t start = clock();
+    for (int n = 0; n < PREPROCESSOR_BENCH_ITERATIONS; n++) {
+        PreprocessorTable table = preprocessor_table_new();
+        TokenStream stream = token_stream_new(PREPROCESSOR_BENCH_FILE, &table);
+        int i = 0;
+        while (tokens_get_type(&stream.ring, token_stream_slot(&stream, i)) != TK_EOF) {
+            i++;
+        }
+        token_count += i;
+        token_stream_free(&stream);
+        preprocessor_table_free(&table);
+        source_files_free();
+    }
+    double seconds = bench_seconds_since(start);
+    printf("[BENCH] preprocess %d defines: %8.2f ms/file (%ld tokens)\n",
+           PREPROCESSOR_BENCH_DEFINES, seconds * 1000 / PREPROCESSOR_BENCH_ITERATIONS,
+           token_count / PREPROCESSOR_BENCH_ITERATIONS);
+    remove(PREPROCESSOR_BENCH_FILE);
+}
+
+// Write a translation unit like a platform header, where only one of every four
+// conditional blocks is used
+void bench_preprocessor_write_conditionals() {
+    StrVector lines = str_vec_new(PREPROCESSOR_BENCH_BLOCKS * PREPROCESSOR_BENCH_BLOCK_LINES);
+    char line[128];
+    str_vec_push(&lines, "#define BENCH_PLATFORM_0");
+    for (int i = 0; i < PREPROCESSOR_BENCH_BLOCKS; i++) {
+        snprintf(line, 128, "#ifdef BENCH_PLATFORM_%d", i % 4);
+        str_vec_push(&lines, line);
+        for (int j = 0; j < PREPROCESSOR_BENCH_BLOCK_LINES; j++) {
+            snprintf(line, 128, "int bench_func_%d_%d(int a, int b) { return a * b + %d; }", i, j, j);
+            str_vec_push(&lines, line);
+        }
+        str_vec_push(&lines, "#endif");
+    }
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file(PREPROCESSOR_BENCH_FILE, src);
+    free(src);
+    str_vec_free(&lines);
+}
+
+// Preprocess the generated header with the whole file and the token stream preprocessors.
+// This mostly measures skipping unused blocks
+void bench_preprocessor_conditionals() {
+    bench_preprocessor_write_conditionals();
+    long token_count = 0;
+    clock_t start = clock();
+    for (int n = 0; n < PREPROCESSOR_BENCH_ITERATIONS; n++) {
+        PreprocessorTable table = preprocessor_table_new();
+        Tokens tokens = preprocess_first(PREPROCESSOR_BENCH_FILE, &table);
+        token_count += tokens.size;
+        tokens_free(&tokens);
+        preprocessor_table_free(&table);
+        source_files_free();
+    }
+    double file_seconds = bench_seconds_since(start);
+
+    start = clock();
+    for (int n = 0; n < PREPROCESSOR_BENCH_ITERATIONS; n++) {
+        PreprocessorTable table = preprocessor_table_new();
+        TokenStream stream = token_stream_new(PREPROCESSOR_BENCH_FILE, &table);
+        int i = 0;
+        while (tokens_get_type(&stream.ring, token_stream_slot(&stream, i)) != TK_EOF) {
+            i++;
+        }
+        token_stream_free(&stream);
+        preprocessor_table_free(&table);
+        source_files_free();
+    }
+    double stream_seconds = bench_seconds_since(start);
+    printf("[BENCH] preprocess %d conditionals: %8.2f ms/file, %8.2f ms/file streamed (%ld tokens)\n",
+           PREPROCESSOR_BENCH_BLOCKS, file_seconds * 1000 / PREPROCESSOR_BENCH_ITERATIONS,
+           stream_seconds * 1000 / PREPROCESSOR_BENCH_ITERATIONS,
+           token_count / PREPROCESSOR_BENCH_ITERATIONS);
+    remove(PREPROCESSOR_BENCH_FILE);
+}
+
+// Stream each source file on its own, as separate compilations do, and count how many
+// file opens the include guards saved
+void bench_preprocessor_includes(StrVector* files) {
+    int opened_before = preprocess_files_opened();
+    int skipped_before = preprocess_guarded_includes_skipped();
+    clock_t start = clock();
+    for (size_t i = 0; i < files->size; i++) {
+        PreprocessorTable table = preprocessor_table_new();
+        TokenStream stream = token_stream_new(files->elems[i], &table);
+        int n = 0;
+        while (tokens_get_type(&stream.ring, token_stream_slot(&stream, n)) != TK_EOF) {
+            n++;
+        }
+        token_stream_free(&stream);
+        preprocessor_table_free(&table);
+        source_files_free();
+    }
+    double seconds = bench_seconds_since(start);
+    int opened = preprocess_files_opened() - opened_before;
+    int skipped = preprocess_guarded_includes_skipped() - skipped_before;
+    printf("[BENCH] preprocess %d files: %8.2f ms, %d files opened, "
+           "%d includes skipped by include guards\n",
+           (int)files->size, seconds * 1000, opened, skipped);
+}
+
+void bench_preprocessor(StrVector* files) {
+    printf("[BENCH] Preprocessor table with %d defines\n", PREPROCESSOR_BENCH_DEFINES);
+    bench_preprocessor_table();
+    bench_preprocessor_file();
+    bench_preprocessor_conditionals();
+    bench_preprocessor_includes(files);
+}
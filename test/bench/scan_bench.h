@@ -0,0 +1,126 @@
+#pragma once
+#include "tokenizer_bench.h"
+#include "../../src/util/scan.h"
+
+#define SCAN_BENCH_ITERATIONS 200
+
+enum ScanKernel {
+    SCAN_KERNEL_LINE_END,
+    SCAN_KERNEL_SKIP_BLANKS,
+    SCAN_KERNEL_IDENT_END,
+    SCAN_KERNEL_FIND_EITHER,
+    SCAN_KERNEL_COMMENT_END,
+};
+
+typedef enum ScanKernel ScanKernel;
+
+// Find the offsets the lexer would call a kernel at: line starts, identifier
+// starts, string contents and block comment contents. Each position is stored
+// as a start and line end offset pair
+Vec bench_scan_positions(char* src, ScanKernel kernel) {
+    Vec positions = vec_new(sizeof(int), 1024);
+    char* str = src;
+    bool line_start = true;
+    while (*str) {
+        bool add = false;
+        switch (kernel) {
+            case SCAN_KERNEL_LINE_END:
+            case SCAN_KERNEL_SKIP_BLANKS:
+                add = line_start;
+                break;
+            case SCAN_KERNEL_IDENT_END:
+                add = (c_isalpha(*str) || *str == '_') && (str == src || !c_isalnum(*(str - 1)));
+                break;
+            case SCAN_KERNEL_FIND_EITHER:
+                add = str != src && *(str - 1) == '\"';
+                break;
+            case SCAN_KERNEL_COMMENT_END:
+                add = str - src >= 2 && *(str - 2) == '/' && *(str - 1) == '*';
+                break;
+        }
+        if (add) {
+            int offset = str - src;
+            vec_push(&positions, &offset);
+            offset = scan_line_end_scalar(str) - src;
+            vec_push(&positions, &offset);
+        }
+        line_start = *str == '\n';
+        str++;
+    }
+    return positions;
+}
+
+// Call a kernel at every position, returns the number of bytes scanned
+long bench_scan_run(char* src, Vec* positions, ScanKernel kernel) {
+    int* offsets = positions->elems;
+    char* src_end = src + strlen(src);
+    long scanned = 0;
+    for (int i = 0; i < positions->size; i += 2) {
+        char* str = src + offsets[i];
+        char* end = src + offsets[i + 1];
+        char* result = str;
+        switch (kernel) {
+            case SCAN_KERNEL_LINE_END:
+                result = scan_line_end(str);
+                break;
+            case SCAN_KERNEL_SKIP_BLANKS:
+                result = scan_skip_blanks(str, end);
+                break;
+            case SCAN_KERNEL_IDENT_END:
+                result = scan_ident_end(str, end);
+                break;
+            case SCAN_KERNEL_FIND_EITHER:
+                result = scan_find_either(str, end, '\"', '\\');
+                break;
+            case SCAN_KERNEL_COMMENT_END:
+                // Block comments may span lines, the lexer scans them one line at a time
+                result = scan_comment_end(str, src_end);
+                break;
+        }
+        scanned += result - str;
+    }
+    return scanned;
+}
+
+void bench_scan_kernel(char* src, ScanKernel kernel, char* name) {
+    Vec positions = bench_scan_positions(src, kernel);
+    double scalar_seconds = 0;
+    for (int level = SCAN_SCALAR; level <= SCAN_AVX2; level++) {
+        if (scan_set_level(level) != level) {
+            break;
+        }
+        long scanned = 0;
+        clock_t start = clock();
+        for (int n = 0; n < SCAN_BENCH_ITERATIONS; n++) {
+            scanned += bench_scan_run(src, &positions, kernel);
+        }
+        double seconds = bench_seconds_since(start);
+        if (level == SCAN_SCALAR) {
+            scalar_seconds = seconds;
+        }
+        printf("[BENCH] %-18s %-6s %8.2f MB/s %6.2f ns/call %5.2fx\n", name,
+               scan_level_to_string(level), bench_megabytes(scanned) / seconds,
+               seconds * 1e9 / ((double)positions.size / 2 * SCAN_BENCH_ITERATIONS),
+               scalar_seconds / seconds);
+    }
+    vec_free(&positions);
+    scan_init();
+}
+
+// Measure every scanning kernel at every level the CPU supports
+void bench_scan(StrVector* files) {
+    StrVector srcs = str_vec_new(files->size);
+    for (size_t i = 0; i < files->size; i++) {
+        str_vec_push_no_copy(&srcs, load_file_to_string(files->elems[i]));
+    }
+    char* src = str_vec_join_with_delim(&srcs, '\n');
+    str_vec_free(&srcs);
+    printf("[BENCH] Scan kernels, %d iterations, best level is %s\n", SCAN_BENCH_ITERATIONS,
+           scan_level_to_string(scan_get_level()));
+    bench_scan_kernel(src, SCAN_KERNEL_LINE_END, "scan_line_end");
+    bench_scan_kernel(src, SCAN_KERNEL_SKIP_BLANKS, "scan_skip_blanks");
+    bench_scan_kernel(src, SCAN_KERNEL_IDENT_END, "scan_ident_end");
+    bench_scan_kernel(src, SCAN_KERNEL_FIND_EITHER, "scan_find_either");
+    bench_scan_kernel(src, SCAN_KERNEL_COMMENT_END, "scan_comment_end");
+    free(src);
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <time.h>
+#include "parser_bench.h"
+
+#define SYMBOL_TABLE_BENCH_ITERATIONS 5
+#define SYMBOL_TABLE_BENCH_FILE "build/symbol_table_bench.c"
+#define SYMBOL_TABLE_BENCH_GLOBALS 4000
+#define SYMBOL_TABLE_BENCH_FUNCS 2000
+#define SYMBOL_TABLE_BENCH_LOCALS 400
+#define SYMBOL_TABLE_BENCH_BLOCKS 20
+#define SYMBOL_TABLE_BENCH_MEMBERS 300
+
+// A translation unit with thousands of globals and function declarations, and a function
+// with hundreds of locals in nested scopes, which uses the globals and locals repeatedly
+void bench_symbol_table_write_source() {
+    StrVector lines = str_vec_new(16);
+    char line[256];
+    for (int i = 0; i < SYMBOL_TABLE_BENCH_GLOBALS; i++) {
+        sprintf(line, "int global%d;", i);
+        str_vec_push(&lines, line);
+    }
+    for (int i = 0; i < SYMBOL_TABLE_BENCH_FUNCS; i++) {
+        sprintf(line, "int func%d(int a, int b);", i);
+        str_vec_push(&lines, line);
+    }
+    str_vec_push(&lines, "int main() {");
+    int locals_per_block = SYMBOL_TABLE_BENCH_LOCALS / SYMBOL_TABLE_BENCH_BLOCKS;
+    int local = 0;
+    for (int block = 0; block < SYMBOL_TABLE_BENCH_BLOCKS; block++) {
+        str_vec_push(&lines, "{");
+        for (int i = 0; i < locals_per_block; i++) {
+            sprintf(line, "int local%d = global%d;", local,
+                    (local * 7) % SYMBOL_TABLE_BENCH_GLOBALS);
+            str_vec_push(&lines, line);
+            local++;
+        }
+        for (int i = 0; i < local; i++) {
+            sprintf(line, "local%d = local%d + global%d + func%d(local%d, global%d);", i,
+                    (i * 13) % local, SYMBOL_TABLE_BENCH_GLOBALS - 1 - i,
+                    (i * 11) % SYMBOL_TABLE_BENCH_FUNCS, i, i * 3);
+            str_vec_push(&lines, line);
+        }
+    }
+    for (int block = 0; block < SYMBOL_TABLE_BENCH_BLOCKS; block++) {
+        str_vec_push(&lines, "}");
+    }
+    str_vec_push(&lines, "return 0;");
+    str_vec_push(&lines, "}");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file(SYMBOL_TABLE_BENCH_FILE, src);
+    free(src);
+    str_vec_free(&lines);
+}
+
+// A struct with hundreds of members, and a function accessing every member many times
+void bench_symbol_table_write_struct_source() {
+    StrVector lines = str_vec_new(16);
+    char line[256];
+    str_vec_push(&lines, "struct Large {");
+    for (int i = 0; i < SYMBOL_TABLE_BENCH_MEMBERS; i++) {
+        sprintf(line, "int member%d;", i);
+        str_vec_push(&lines, line);
+    }
+    str_vec_push(&lines, "};");
+    str_vec_push(&lines, "int main() {");
+    str_vec_push(&lines, "struct Large s;");
+    str_vec_push(&lines, "struct Large* p = &s;");
+    for (int n = 0; n < 10; n++) {
+        for (int i = 0; i < SYMBOL_TABLE_BENCH_MEMBERS; i++) {
+            sprintf(line, "s.member%d = p->member%d + 1;", i,
+                    SYMBOL_TABLE_BENCH_MEMBERS - 1 - i);
+            str_vec_push(&lines, line);
+        }
+    }
+    str_vec_push(&lines, "return 0;");
+    str_vec_push(&lines, "}");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file(SYMBOL_TABLE_BENCH_FILE, src);
+    free(src);
+    str_vec_free(&lines);
+}
+
+// Parse the generated source file, returns the parse time in seconds per iteration
+double bench_symbol_table_parse(long* node_count) {
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first(SYMBOL_TABLE_BENCH_FILE, &table);
+    double parse_seconds = 0;
+    double free_seconds = 0;
+    for (int n = 0; n < SYMBOL_TABLE_BENCH_ITERATIONS; n++) {
+        *node_count = bench_parser_tokens(&tokens, &parse_seconds, NULL, &free_seconds);
+    }
+    tokens_free(&tokens);
+    preprocessor_table_free(&table);
+    source_files_free();
+    remove(SYMBOL_TABLE_BENCH_FILE);
+    return parse_seconds / SYMBOL_TABLE_BENCH_ITERATIONS;
+}
+
+void bench_symbol_table() {
+    long node_count = 0;
+    bench_symbol_table_write_source();
+    double seconds = bench_symbol_table_parse(&node_count);
+    printf("[BENCH] parse, many symbols:   %8.2f ms (%d globals, %d locals, %ld nodes)\n",
+           seconds * 1e3, SYMBOL_TABLE_BENCH_GLOBALS, SYMBOL_TABLE_BENCH_LOCALS, node_count);
+    bench_symbol_table_write_struct_source();
+    seconds = bench_symbol_table_parse(&node_count);
+    printf("[BENCH] parse, struct members: %8.2f ms (%d members, %ld nodes)\n",
+           seconds * 1e3, SYMBOL_TABLE_BENCH_MEMBERS, node_count);
+}
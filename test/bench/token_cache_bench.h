@@ -0,0 +1,48 @@
+#pragma once
+#include <time.h>
+#include <sys/stat.h>
+#include "tokenizer_bench.h"
+#include "../../src/token_cache.h"
+
+#define TOKEN_CACHE_BENCH_ITERATIONS 20
+#define TOKEN_CACHE_BENCH_DIR "build/token_cache_bench"
+
+// Tokenize every file through the token cache, returns the time per pass over the files
+double bench_token_cache_pass(StrVector* files, int iterations) {
+    clock_t start = clock();
+    for (int n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < files->size; i++) {
+            Tokens tokens = token_cache_tokenize(source_file_open(files->elems[i], false));
+            tokens_free(&tokens);
+        }
+        source_files_free();
+    }
+    return bench_seconds_since(start) / iterations;
+}
+
+// Remove the entries of the cache directory
+void bench_token_cache_clear() {
+    system("rm -rf " TOKEN_CACHE_BENCH_DIR);
+    mkdir(TOKEN_CACHE_BENCH_DIR, 0755);
+}
+
+// Compare tokenizing the files without the cache, with an empty cache like a clean build,
+// and with every file cached like an incremental build
+void bench_token_cache(StrVector* files) {
+    double uncached_seconds = bench_token_cache_pass(files, TOKEN_CACHE_BENCH_ITERATIONS);
+
+    bench_token_cache_clear();
+    token_cache_set_dir(TOKEN_CACHE_BENCH_DIR);
+    double clean_seconds = bench_token_cache_pass(files, 1);
+    int hits_before = token_cache_hits();
+    double incremental_seconds = bench_token_cache_pass(files, TOKEN_CACHE_BENCH_ITERATIONS);
+    int hits = (token_cache_hits() - hits_before) / TOKEN_CACHE_BENCH_ITERATIONS;
+    token_cache_set_dir(NULL);
+
+    printf("[BENCH] token cache, uncached:    %8.2f ms/pass\n", uncached_seconds * 1000);
+    printf("[BENCH] token cache, clean:       %8.2f ms/pass (writing entries)\n",
+           clean_seconds * 1000);
+    printf("[BENCH] token cache, incremental: %8.2f ms/pass (%d of %d files cached)\n",
+           incremental_seconds * 1000, hits, (int)files->size);
+    system("rm -rf " TOKEN_CACHE_BENCH_DIR);
+}
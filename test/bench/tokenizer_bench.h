@@ -0,0 +1,103 @@
+#pragma once
+#include <time.h>
+#include "../../src/tokens.h"
+#include "../../src/util/file_helpers.h"
+
+#define TOKENIZER_BENCH_ITERATIONS 20
+#define TOKENIZER_BENCH_LEXER_ITERATIONS 1000
+
+double bench_seconds_since(clock_t start) {
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+double bench_megabytes(long bytes) {
+    return (double) bytes / (1024 * 1024);
+}
+
+// Tokenize every file separately, as the preprocessor does
+void bench_tokenizer_files(StrVector* srcs, long total_bytes) {
+    long token_count = 0;
+    clock_t start = clock();
+    for (int n = 0; n < TOKENIZER_BENCH_ITERATIONS; n++) {
+        for (size_t i = 0; i < srcs->size; i++) {
+            Tokens tokens = tokenize(srcs->elems[i], true);
+            token_count += tokens.size;
+            tokens_free(&tokens);
+            source_files_free();
+        }
+    }
+    double seconds = bench_seconds_since(start);
+    double megabytes = bench_megabytes(total_bytes) * TOKENIZER_BENCH_ITERATIONS;
+    printf("[BENCH] tokenize, per file:     %8.2f MB/s (%ld tokens, %.3f s)\n",
+           megabytes / seconds, token_count / TOKENIZER_BENCH_ITERATIONS, seconds);
+}
+
+// Tokenize all files concatenated into one large translation unit
+void bench_tokenizer_large_src(StrVector* srcs, long total_bytes) {
+    char* large_src = str_vec_join_with_delim(srcs, '\n');
+    long token_count = 0;
+    clock_t start = clock();
+    for (int n = 0; n < TOKENIZER_BENCH_ITERATIONS; n++) {
+        Tokens tokens = tokenize(large_src, true);
+        token_count += tokens.size;
+        tokens_free(&tokens);
+        source_files_free();
+    }
+    double seconds = bench_seconds_since(start);
+    double megabytes = bench_megabytes(total_bytes) * TOKENIZER_BENCH_ITERATIONS;
+    printf("[BENCH] tokenize, large source: %8.2f MB/s (%ld tokens, %.3f s)\n",
+           megabytes / seconds, token_count / TOKENIZER_BENCH_ITERATIONS, seconds);
+    free(large_src);
+}
+
+void bench_tokenizer_lexer_level(StrVector* files, StrVector* srcs) {
+    long total_bytes = 0;
+    long token_count = 0;
+    clock_t start = clock();
+    for (int n = 0; n < TOKENIZER_BENCH_LEXER_ITERATIONS; n++) {
+        for (size_t i = 0; i < files->size; i++) {
+            if (!str_startswith(files->elems[i], "src/") &&
+                !str_startswith(files->elems[i], "libc/")) {
+                continue;
+            }
+            Tokens tokens = tokenize(srcs->elems[i], false);
+            token_count += tokens.size;
+            total_bytes += strlen(srcs->elems[i]);
+            tokens_free(&tokens);
+            source_files_free();
+        }
+    }
+    double seconds = bench_seconds_since(start);
+    printf("[BENCH] lex src/ and libc/ x%d, %-6s %6.2f MB/s (%ld tokens, %.3f s)\n",
+           TOKENIZER_BENCH_LEXER_ITERATIONS, scan_level_to_string(scan_get_level()),
+           bench_megabytes(total_bytes) / seconds,
+           token_count / TOKENIZER_BENCH_LEXER_ITERATIONS, seconds);
+}
+
+// Lex the compiler sources and libc headers many times, which mostly measures
+// identifier and keyword recognition. Runs once for every scan kernel level
+void bench_tokenizer_lexer(StrVector* files, StrVector* srcs) {
+    for (int level = SCAN_SCALAR; level <= SCAN_AVX2; level++) {
+        if (scan_set_level(level) != level) {
+            break;
+        }
+        bench_tokenizer_lexer_level(files, srcs);
+    }
+    scan_init();
+}
+
+void bench_tokenizer(StrVector* files) {
+    StrVector srcs = str_vec_new(files->size);
+    long total_bytes = 0;
+    for (size_t i = 0; i < files->size; i++) {
+        char* src = load_file_to_string(files->elems[i]);
+        total_bytes += strlen(src);
+        str_vec_push_no_copy(&srcs, src);
+    }
+    printf("[BENCH] Tokenizing %.2f MB, %d iterations\n", bench_megabytes(total_bytes),
+           TOKENIZER_BENCH_ITERATIONS);
+    bench_tokenizer_files(&srcs, total_bytes);
+    bench_tokenizer_large_src(&srcs, total_bytes);
+    bench_tokenizer_lexer(files, &srcs);
+    str_vec_free(&srcs);
+}
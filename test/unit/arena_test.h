@@ -0,0 +1,38 @@
+#pragma once
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/util/arena.h"
+
+void test_arena();
+
+void test_arena() {
+    printf("[CTEST] Running arena tests...\n");
+
+    Arena* arena = arena_new();
+    // Allocations are zeroed and aligned
+    char* a = arena_alloc(arena, 3);
+    int* b = arena_alloc(arena, 4 * sizeof(int));
+    assert(a[0] == 0 && a[2] == 0);
+    assert(b[0] == 0 && b[3] == 0);
+    assert(((long)b) % ARENA_ALIGNMENT == 0);
+    assert((char*)b - a == ARENA_ALIGNMENT);
+
+    char* str = arena_str(arena, "arena");
+    assert(strcmp(str, "arena") == 0);
+
+    // Enough memory for several blocks, and an allocation larger than a block
+    for (int i = 0; i < 1000; i++) {
+        int* elems = arena_alloc(arena, 1000);
+        elems[249] = i;
+    }
+    char* large = arena_alloc(arena, ARENA_BLOCK_SIZE * 2);
+    large[ARENA_BLOCK_SIZE * 2 - 1] = 'x';
+    assert(arena->blocks.size > 2);
+    assert(arena->allocations == 1004);
+    assert(strcmp(str, "arena") == 0);
+    arena_free(arena);
+
+    printf("[CTEST] Passed arena tests!\n");
+}
@@ -13,10 +13,14 @@
 
 void test_codegen();
 void test_codegen_helpers();
+void test_codegen_control_bytes();
+void test_codegen_funcs();
 
 void test_codegen() {
     printf("[CTEST] Running codegen tests...\n");
     test_codegen_helpers();
+    test_codegen_control_bytes();
+    test_codegen_funcs();
     printf("[CTEST] Passed codegen tests!\n");
 }
 
@@ -45,4 +49,73 @@ void test_codegen_helpers() {
     free(*ctx.asm_indent_str);
     str_vec_free(ctx.asm_text_src);
     str_vec_free(ctx.asm_data_src);
-}
\ No newline at end of file
+}
+
+void test_codegen_control_bytes() {
+    // Control bytes in string literals are copied to the assembly as they are, and do not
+    // affect the numbering of the labels
+    char* src = str_copy("char* s = \"a.b.\";\nchar* t = \"c\";\n");
+    src[12] = 1;
+    src[14] = 2;
+    write_string_to_file("build/control_bytes_test.c", src);
+    free(src);
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("build/control_bytes_test.c", &table);
+    SymbolTable* symbols = symbol_table_new();
+    AST ast = parse(&tokens, symbols);
+    char* asm_src = generate_assembly(&ast, symbols, false);
+
+    char* expected = str_copy("G_STR1: db `a.b.`, 0");
+    expected[13] = 1;
+    expected[15] = 2;
+    assert(strstr(asm_src, expected) != NULL);
+    free(expected);
+    assert(strstr(asm_src, "G_STR2: db `c`, 0") != NULL);
+
+    remove("build/control_bytes_test.c");
+    free(asm_src);
+    symbol_table_free(symbols);
+    preprocessor_table_free(&table);
+    tokens_free(&tokens);
+    source_files_free();
+    ast_free(&ast);
+}
+void test_codegen_funcs() {
+    // Every function has its own labels, so generating the functions on several threads
+    // gives the same assembly as generating them one after another
+    StrVector lines = str_vec_new(16);
+    str_vec_push(&lines, "char* s = \"z\";");
+    str_vec_push(&lines, "char* f(int a) {\n    if (a) {\n        return \"x\";\n    }");
+    str_vec_push(&lines, "    return s;\n}");
+    str_vec_push(&lines, "char* g(int a) {\n    while (a) {\n        a--;\n    }");
+    str_vec_push(&lines, "    return \"y\";\n}");
+    str_vec_push(&lines, "int main() {\n    f(1);\n    g(2);\n    return 0;\n}\n");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file("build/codegen_funcs_test.c", src);
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("build/codegen_funcs_test.c", &table);
+    SymbolTable* symbols = symbol_table_new();
+    AST ast = parse(&tokens, symbols);
+    char* asm_src = generate_assembly(&ast, symbols, true);
+    char* threaded_asm_src = generate_assembly_threaded(&ast, symbols, true, 3);
+    assert(strcmp(asm_src, threaded_asm_src) == 0);
+
+    assert(strstr(asm_src, "G_STR1: db `z`, 0") != NULL);
+    assert(strstr(asm_src, "f.S1: db `x`, 0") != NULL);
+    assert(strstr(asm_src, "g.S1: db `y`, 0") != NULL);
+    // The jump labels of each function start from the first one again
+    char* f_label = strstr(strstr(asm_src, "\nf:"), ".L1:");
+    char* g_label = strstr(strstr(asm_src, "\ng:"), ".L1:");
+    assert(f_label != NULL && g_label != NULL && f_label != g_label);
+
+    remove("build/codegen_funcs_test.c");
+    free(src);
+    free(asm_src);
+    free(threaded_asm_src);
+    str_vec_free(&lines);
+    symbol_table_free(symbols);
+    preprocessor_table_free(&table);
+    tokens_free(&tokens);
+    source_files_free();
+    ast_free(&ast);
+}
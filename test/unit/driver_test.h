@@ -0,0 +1,54 @@
+#pragma once
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/driver.h"
+
+void test_driver();
+
+void test_driver() {
+    printf("[CTEST] Running driver tests...\n");
+
+    char* filename = object_filename("src/util/args.c");
+    assert(strcmp(filename, "args.o") == 0);
+    free(filename);
+    filename = dependency_filename("build/args.o");
+    assert(strcmp(filename, "build/args.d") == 0);
+    free(filename);
+    filename = dependency_filename("prog");
+    assert(strcmp(filename, "prog.d") == 0);
+    free(filename);
+
+    char* src_filenames[2];
+    src_filenames[0] = "src/a.c";
+    src_filenames[1] = "test/a.c";
+    CompileOptions options;
+    memset(&options, 0, sizeof(CompileOptions));
+    options.src_filename = src_filenames[0];
+    options.src_filenames = src_filenames;
+    options.src_count = 2;
+    options.jobs = 2;
+    options.output_filename = "prog";
+    options.link_with_gcc = true;
+
+    // Objects which are linked are named after the output
+    CompileOptions file_options = compile_file_options(&options, 1);
+    assert(strcmp(file_options.src_filename, "test/a.c") == 0);
+    assert(file_options.src_count == 1);
+    assert(!file_options.link_with_gcc);
+    assert(strcmp(file_options.output_filename, "prog.1.o") == 0);
+    assert(file_options.dependency_filename == NULL);
+    free(file_options.output_filename);
+
+    // Objects compiled with -c are named after the source file, with their own make rules
+    options.link_with_gcc = false;
+    options.dependency_filename = "a.d";
+    file_options = compile_file_options(&options, 0);
+    assert(strcmp(file_options.output_filename, "a.o") == 0);
+    assert(strcmp(file_options.dependency_filename, "a.d") == 0);
+    free(file_options.output_filename);
+    free(file_options.dependency_filename);
+
+    printf("[CTEST] Passed driver tests!\n");
+}
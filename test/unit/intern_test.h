@@ -0,0 +1,42 @@
+#pragma once
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/util/intern.h"
+
+void test_intern();
+void test_intern_grow();
+
+void test_intern() {
+    printf("[CTEST] Running intern tests...\n");
+
+    char* a = intern_str("intern");
+    char buffer[16];
+    strcpy(buffer, "intern");
+    assert(intern_str(buffer) == a);
+    assert(strcmp(a, "intern") == 0);
+    assert(intern_str("internal") != a);
+    assert(intern_str_n("internal", 6) == a);
+    assert(intern_str("") == intern_str_n("abc", 0));
+
+    test_intern_grow();
+    printf("[CTEST] Passed intern tests!\n");
+}
+
+void test_intern_grow() {
+    // Enough strings to grow the table several times
+    char* first = intern_str("aaa");
+    char buffer[4];
+    buffer[3] = '\0';
+    for (int i = 0; i < 26 * 26 * 26; i++) {
+        buffer[0] = 'a' + i / 676;
+        buffer[1] = 'a' + (i / 26) % 26;
+        buffer[2] = 'a' + i % 26;
+        char* interned = intern_str(buffer);
+        assert(strcmp(interned, buffer) == 0);
+    }
+    assert(intern_str("aaa") == first);
+    assert(strcmp(intern_str("zzz"), "zzz") == 0);
+    assert(intern_str("mno") == intern_str_n("mnop", 3));
+}
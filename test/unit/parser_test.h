@@ -9,15 +9,28 @@
 #include "../../src/util/file_helpers.h"
 #include "../../src/symbol_table.h"
 #include "../../src/parser.h"
+#ifndef CCIC
+#include <pthread.h>
+#endif
 
 void test_parser();
 void test_parser_helpers();
 void test_parser_on_file();
+void test_parser_contexts();
+void test_parser_large_struct();
+#ifndef CCIC
+void test_parser_threads();
+#endif
 
 void test_parser() {
     printf("[CTEST] Running parser tests...\n");
     //test_parser_helpers();
     test_parser_on_file();
+    test_parser_contexts();
+    test_parser_large_struct();
+#ifndef CCIC
+    test_parser_threads();
+#endif
     printf("[CTEST] Passed parser tests!\n");
 }
 
@@ -68,7 +81,7 @@ void test_parser_on_file() {
     assert(node->type == AST_SCOPE);
     node = node->body;
     assert(node->type == AST_RETURN);
-    node = node->ret;
+    node = node->control->ret;
     assert(node->type == AST_EXPR);
     assert(node->expr_type == EXPR_BINOP);
     assert(node->op_type == BOP_ADD);
@@ -88,10 +101,129 @@ void test_parser_on_file() {
     symbol_table_free(symbols);
     preprocessor_table_free(&table);
     tokens_free(&tokens);
-    tokens_free_line_strings(&tokens);
+    source_files_free();
     ast_free(&ast);
 }
 
+void test_parser_contexts() {
+    // Every parse has its own context, so parses do not affect each other
+    Tokens tokens1 = tokenize("while for", false);
+    Tokens tokens2 = tokenize("for while", false);
+    ParserContext ctx1 = parser_context_new(&tokens1, NULL);
+    ParserContext ctx2 = parser_context_new(&tokens2, NULL);
+    assert(accept(&ctx1, TK_KW_WHILE));
+    assert(!accept(&ctx2, TK_KW_WHILE));
+    assert(accept(&ctx2, TK_KW_FOR));
+    assert(accept(&ctx1, TK_KW_FOR));
+    token_go_back(&ctx1, 2);
+    expect(&ctx1, TK_KW_WHILE);
+    assert(accept(&ctx2, TK_KW_WHILE));
+    tokens_free(&tokens1);
+    tokens_free(&tokens2);
+
+    // ASTs parsed from the same tokens are independent
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("test/unit/examples/example2.c", &table);
+    SymbolTable* symbols1 = symbol_table_new();
+    SymbolTable* symbols2 = symbol_table_new();
+    AST ast1 = parse(&tokens, symbols1);
+    AST ast2 = parse(&tokens, symbols2);
+    assert(ast1.program != ast2.program);
+    assert(ast1.arena != ast2.arena);
+    assert(ast_node_count(&ast1) == ast_node_count(&ast2));
+    assert(ast2.program->body->type == AST_FUNC);
+    ast_free(&ast1);
+    assert(ast2.program->body->body->body->type == AST_RETURN);
+
+    symbol_table_free(symbols1);
+    symbol_table_free(symbols2);
+    preprocessor_table_free(&table);
+    tokens_free(&tokens);
+    source_files_free();
+    ast_free(&ast2);
+}
+
+void test_parser_large_struct() {
+    // The type of a global is parsed again after looking ahead, so the token stream keeps
+    // every token of a struct body longer than its ring
+    StrVector lines = str_vec_new(TOKEN_STREAM_CAPACITY);
+    str_vec_push(&lines, "struct S {");
+    char line[32];
+    for (int i = 0; i < 1500; i++) {
+        snprintf(line, 32, "    int m%d;", i);
+        str_vec_push(&lines, line);
+    }
+    str_vec_push(&lines, "} s;");
+    str_vec_push(&lines, "int main() {\n    return s.m1499;\n}\n");
+    char* src = str_vec_join_with_delim(&lines, '\n');
+    write_string_to_file("build/large_struct_test.c", src);
+
+    PreprocessorTable table = preprocessor_table_new();
+    TokenStream stream = token_stream_new("build/large_struct_test.c", &table);
+    SymbolTable* symbols = symbol_table_new();
+    AST ast = parse_token_stream(&stream, symbols);
+    assert(stream.end > TOKEN_STREAM_CAPACITY);
+    assert(stream.ring.size > TOKEN_STREAM_CAPACITY);
+    ASTNode* node = ast.program->body;
+    assert(node->type == AST_NULL_STMT);
+    assert(node->next->type == AST_FUNC);
+    assert(symbol_table_lookup_var(symbols, intern_str("s")).type.bytes == 1500 * 4);
+
+    remove("build/large_struct_test.c");
+    free(src);
+    str_vec_free(&lines);
+    symbol_table_free(symbols);
+    token_stream_free(&stream);
+    preprocessor_table_free(&table);
+    source_files_free();
+    ast_free(&ast);
+}
+
+#ifndef CCIC
+struct ParseJob {
+    Tokens tokens;
+    SymbolTable* symbols;
+    AST ast;
+};
+
+typedef struct ParseJob ParseJob;
+
+void* parse_job_run(void* arg) {
+    ParseJob* job = arg;
+    job->symbols = symbol_table_new();
+    job->ast = parse(&job->tokens, job->symbols);
+    return NULL;
+}
+
+void test_parser_threads() {
+    // Ids are counted per symbol table and the shared pools are locked, so several
+    // parses can run at once. Tokenizing registers source files, so it is done first
+    char* src = "int g;\nint f(int a) {\n    int b = a;\n    switch (b) {\n"
+                "    case 1:\n        return 2;\n    }\n    return b;\n}\n";
+    ParseJob jobs[2];
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        jobs[i].tokens = tokenize(src, false);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&threads[i], NULL, parse_job_run, &jobs[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(ast_node_count(&jobs[0].ast) == ast_node_count(&jobs[1].ast));
+    assert(jobs[0].symbols->next_label_id == jobs[1].symbols->next_label_id);
+    for (int i = 0; i < 2; i++) {
+        assert(jobs[i].ast.program->body->next->type == AST_FUNC);
+        assert(symbol_table_lookup_var(jobs[i].symbols, intern_str("g")).unique_id == 0);
+        ast_free(&jobs[i].ast);
+        symbol_table_free(jobs[i].symbols);
+        tokens_free(&jobs[i].tokens);
+    }
+    source_files_free();
+}
+#endif
+
 //int main() {
 //test_parser();
 //}
\ No newline at end of file
@@ -5,35 +5,328 @@
 
 #include "../../src/tokens.h"
 #include "../../src/preprocess.h"
+#include "../../src/pch.h"
 #include "../../src/util/file_helpers.h"
 
 // Declarations
 void test_preprocessor();
 void test_preprocessor_table();
+void test_preprocessor_table_grow(PreprocessorTable* table);
+void test_preprocessor_stream();
+void test_preprocessor_include_guard();
+void test_preprocessor_pch();
+void test_preprocessor_conditional_index();
+void test_preprocessor_function_macro();
+void test_preprocessor_rescan();
+void test_preprocessor_expansion_location();
+void test_preprocessor_dependencies();
+int test_preprocessor_stream_tokens(char* filename, Tokens* tokens);
+int test_preprocessor_guard_state(char* src);
 
 // Definitions
 void test_preprocessor() {
     printf("[CTEST] Running preprocessor tests...\n");
     test_preprocessor_table();
+    test_preprocessor_stream();
+    test_preprocessor_include_guard();
+    test_preprocessor_pch();
+    test_preprocessor_conditional_index();
+    test_preprocessor_function_macro();
+    test_preprocessor_rescan();
+    test_preprocessor_expansion_location();
+    test_preprocessor_dependencies();
     printf("[CTEST] Passed preprocessor tests!\n");
 }
 
 void test_preprocessor_table() {
     PreprocessorTable table = preprocessor_table_new();
     PreprocessorItem item;
-    item.type = 4;
-    item.name = "item1";
-    preprocessor_table_insert(&table, item);
-    item.type = 3;
-    item.name = "item2";
+    item.type = PP_INCLUDED_FILE;
+    item.name = intern_str("item1");
+    item.include_file_only_once = true;
     preprocessor_table_insert(&table, item);
+    preprocessor_table_insert(&table, preprocessor_define_new(intern_str("item2"), tokens_new(0)));
+
+    // Defines and included files are looked up separately
+    assert(preprocessor_table_lookup_file(&table, intern_str("item1"))->include_file_only_once);
+    assert(preprocessor_table_lookup_define(&table, intern_str("item1")) == NULL);
+    assert(preprocessor_table_lookup_define(&table, intern_str("item2"))->type == PP_DEFINE);
+    assert(preprocessor_table_lookup_define(&table, intern_str("CCIC")) != NULL);
 
-    assert(preprocessor_table_lookup(&table, "item1")->type == 4);
-    assert(preprocessor_table_lookup(&table, "item2")->type == 3);
+    // Removed defines can be defined again
+    assert(preprocessor_table_remove(&table, intern_str("item2")) == 1);
+    assert(preprocessor_table_lookup_define(&table, intern_str("item2")) == NULL);
+    assert(preprocessor_table_remove(&table, intern_str("item2")) == 0);
+    preprocessor_table_insert(&table, preprocessor_define_new(intern_str("item2"), tokens_new(0)));
+    assert(preprocessor_table_lookup_define(&table, intern_str("item2")) != NULL);
 
+    test_preprocessor_table_grow(&table);
     preprocessor_table_free(&table);
 }
 
+void test_preprocessor_table_grow(PreprocessorTable* table) {
+    // Enough defines to grow the map several times
+    char name[8];
+    strcpy(name, "DEF_aaa");
+    for (int i = 0; i < 1000; i++) {
+        name[4] = 'a' + i / 100;
+        name[5] = 'a' + (i / 10) % 10;
+        name[6] = 'a' + i % 10;
+        preprocessor_table_insert(table, preprocessor_define_new(intern_str(name), tokens_new(0)));
+        if (i % 2 == 0) {
+            preprocessor_table_remove(table, intern_str(name));
+        }
+    }
+    assert(preprocessor_table_lookup_define(table, intern_str("DEF_aaa")) == NULL);
+    assert(preprocessor_table_lookup_define(table, intern_str("DEF_aab")) != NULL);
+    assert(preprocessor_table_lookup_define(table, intern_str("DEF_jjj")) != NULL);
+    assert(preprocessor_table_lookup_define(table, intern_str("DEF_jji")) == NULL);
+    assert(preprocessor_table_lookup_define(table, intern_str("item2")) != NULL);
+}
+
+void test_preprocessor_stream() {
+    // Preprocessing the whole file drains the tokens the parser pulls from the stream
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("test/unit/examples/example1.c", &table);
+    PreprocessorTable stream_table = preprocessor_table_new();
+    TokenStream stream = token_stream_new("test/unit/examples/example1.c", &stream_table);
+
+    for (int i = 0; i < tokens.size; i++) {
+        int slot = token_stream_slot(&stream, i);
+        assert(tokens_get_type(&stream.ring, slot) == tokens_get_type(&tokens, i));
+        assert(tokens_get_string(&stream.ring, slot) == tokens_get_string(&tokens, i));
+    }
+    // The stream keeps returning EOF at the end
+    int slot = token_stream_slot(&stream, tokens.size + 1);
+    assert(tokens_get_type(&stream.ring, slot) == TK_EOF);
+
+    token_stream_free(&stream);
+    preprocessor_table_free(&stream_table);
+    tokens_free(&tokens);
+    preprocessor_table_free(&table);
+}
+
+// Feed a tokenized source through include guard detection and return the final state
+int test_preprocessor_guard_state(char* src) {
+    Tokens tokens = tokenize(src, false);
+    IncludeGuard guard;
+    preprocess_guard_init(&guard);
+    for (int i = 0; i < tokens.size; i++) {
+        preprocess_guard_feed(&guard, &tokens, i);
+    }
+    tokens_free(&tokens);
+    return guard.state;
+}
+
+void test_preprocessor_include_guard() {
+    // Comments and nested conditionals are allowed around and inside the guard
+    char* guarded = "// Header\n#ifndef GUARD_H\n#define GUARD_H\n#ifdef X\nint x;\n#endif\n#endif\n";
+    assert(test_preprocessor_guard_state(guarded) == GUARD_CLOSED);
+    // Code or directives outside of the guard, or a define of a different macro
+    assert(test_preprocessor_guard_state("int x;\n#ifndef GUARD_H\n#define GUARD_H\n#endif\n") ==
+           GUARD_NONE);
+    assert(test_preprocessor_guard_state("#ifndef GUARD_H\n#define GUARD_H\n#endif\nint x;\n") ==
+           GUARD_NONE);
+    assert(test_preprocessor_guard_state("#ifndef GUARD_H\n#define OTHER_H\n#endif\n") ==
+           GUARD_NONE);
+    assert(test_preprocessor_guard_state("#ifndef GUARD_H\n#define GUARD_H\nint x;\n") ==
+           GUARD_INSIDE);
+
+    // A recorded guard only skips the include while its define is still defined
+    PreprocessorTable table = preprocessor_table_new();
+    IncludeGuard guard;
+    preprocess_guard_init(&guard);
+    guard.state = GUARD_CLOSED;
+    guard.define_ident = intern_str("GUARD_H");
+    preprocess_guard_record(&guard, &table, "guarded.h");
+    assert(!preprocess_guard_skips_include(&table, "guarded.h"));
+    preprocessor_table_add_simple_define(&table, intern_str("GUARD_H"));
+    assert(preprocess_guard_skips_include(&table, "guarded.h"));
+    assert(!preprocess_guard_skips_include(&table, "other.h"));
+    preprocessor_table_remove(&table, intern_str("GUARD_H"));
+    assert(!preprocess_guard_skips_include(&table, "guarded.h"));
+    preprocessor_table_free(&table);
+}
+
+// Stream a file into tokens with their texts, returns the number of precompiled headers loaded
+int test_preprocessor_stream_tokens(char* filename, Tokens* tokens) {
+    int loaded_before = pch_headers_loaded();
+    PreprocessorTable table = preprocessor_table_new();
+    TokenStream stream = token_stream_new(filename, &table);
+    int slot = token_stream_slot(&stream, 0);
+    while (tokens_get_type(&stream.ring, slot) != TK_EOF) {
+        // Materialize the text, so it stays valid after the source files are freed
+        tokens_get_string(&stream.ring, slot);
+        tokens_push_token(tokens, &stream.ring, slot);
+        slot = token_stream_slot(&stream, tokens->size);
+    }
+    token_stream_free(&stream);
+    preprocessor_table_free(&table);
+    return pch_headers_loaded() - loaded_before;
+}
+
+void test_preprocessor_pch() {
+    write_string_to_file("build/pch_test.h", "#include <stdio.h>\n#define PCH_TEST 1\n");
+    write_string_to_file("build/pch_test.c", "#include \"pch_test.h\"\nint x = PCH_TEST + EOF;\n");
+    Tokens tokens = tokens_new(0);
+    tokens_reserve(&tokens, TOKENS_INITIAL_CAPACITY);
+    assert(test_preprocessor_stream_tokens("build/pch_test.c", &tokens) == 0);
+    source_files_free();
+
+    // The precompiled header gives the same tokens, with the defines of the header
+    assert(pch_build("build/pch_test.h") > 0);
+    source_files_free();
+    Tokens pch_tokens = tokens_new(0);
+    tokens_reserve(&pch_tokens, TOKENS_INITIAL_CAPACITY);
+    assert(test_preprocessor_stream_tokens("build/pch_test.c", &pch_tokens) == 1);
+    assert(pch_tokens.size == tokens.size);
+    for (int i = 0; i < tokens.size; i++) {
+        assert(tokens_get_type(&pch_tokens, i) == tokens_get_type(&tokens, i));
+        // Block comment texts are not kept, so comments are not compared
+        if (tokens_get_type(&tokens, i) != TK_COMMENT) {
+            assert(tokens_get_string(&pch_tokens, i) == tokens_get_string(&tokens, i));
+        }
+    }
+    source_files_free();
+
+    // The precompiled header is not used once the header has changed
+    write_string_to_file("build/pch_test.h", "#include <stdio.h>\n#define PCH_TEST 2\n");
+    tokens_clear(&pch_tokens);
+    assert(test_preprocessor_stream_tokens("build/pch_test.c", &pch_tokens) == 0);
+    source_files_free();
+
+    remove("build/pch_test.h.pch");
+    remove("build/pch_test.h");
+    remove("build/pch_test.c");
+    tokens_free(&pch_tokens);
+    tokens_free(&tokens);
+}
+
+void test_preprocessor_conditional_index() {
+    // The tokenizer finds the #endif of every conditional, including nested ones
+    Tokens tokens = tokenize("#ifdef A\n#ifndef B\nint a;\n#endif\n#endif\n#ifdef C\n#endif\n", false);
+    assert(tokens_find_conditional_end(&tokens, 0) == 6);
+    assert(tokens_find_conditional_end(&tokens, 1) == 5);
+    assert(tokens_find_conditional_end(&tokens, 7) == 8);
+    assert(tokens_find_conditional_end(&tokens, 2) == -1);
+    tokens_free(&tokens);
+
+    // Unused blocks are skipped, also when a block comment hides directives inside them.
+    write_string_to_file("build/conditional_test.c", "#define B\n#ifdef A\n/* x\n#ifdef B\n*/ int a;\n#ifndef B\nint b; // b\n#endif\n#endif\n#ifdef B\nint c;\n#endif\nint d;\n");
+    PreprocessorTable table = preprocessor_table_new();
+    tokens = preprocess_first("build/conditional_test.c", &table);
+    assert(tokens.size == 7);
+    assert(tokens_get_string(&tokens, 1) == intern_str("c"));
+    assert(tokens_get_string(&tokens, 4) == intern_str("d"));
+    Tokens stream_tokens = tokens_new(0);
+    tokens_reserve(&stream_tokens, TOKENS_INITIAL_CAPACITY);
+    test_preprocessor_stream_tokens("build/conditional_test.c", &stream_tokens);
+    assert(stream_tokens.size == tokens.size - 1);
+    for (int i = 0; i < stream_tokens.size; i++) {
+        assert(tokens_get_string(&stream_tokens, i) == tokens_get_string(&tokens, i));
+    }
+    remove("build/conditional_test.c");
+    tokens_free(&stream_tokens);
+    tokens_free(&tokens);
+    preprocessor_table_free(&table);
+}
+
+void test_preprocessor_function_macro() {
+    // Parameters, # and ##, __VA_ARGS__ and rescanning the expansion for other defines
+    write_string_to_file("build/function_macro_test.c", "#define SQ(x) ((x) * (x))\n#define ADD(a, b) (a + b)\n#define STR(x) #x\n#define CAT(a, b) a ## b\n#define CALL(f, ...) f(__VA_ARGS__)\n#define LOG(fmt, ...) printf(fmt, ## __VA_ARGS__)\n#define ONE 1\n#define REC(x) REC(x + ONE)\n#define EMPTY()\nint a = SQ(ADD(1, 2));\nchar* s = STR(a + \"b\");\nint CAT(var, 2) = CAT(1, 0);\nint c = CALL(ADD, 3, 4);\nLOG(\"x\");\nLOG(\"x %d\", 1);\nint r = REC(0) EMPTY();\nint SQ = SQ;\nint m = ADD(\n    5, /* six */ 6);\n");
+    Tokens expected = tokenize("int a = (((1 + 2)) * ((1 + 2)));\nchar* s = \"a + \\\"b\\\"\";\nint var2 = 10;\nint c = (3 + 4);\nprintf(\"x\");\nprintf(\"x %d\", 1);\nint r = REC(0 + 1);\nint SQ = SQ;\nint m = (5 + 6);\n", false);
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("build/function_macro_test.c", &table);
+    assert(tokens.size == expected.size);
+    for (int i = 0; i < tokens.size; i++) {
+        assert(tokens_get_type(&tokens, i) == tokens_get_type(&expected, i));
+        assert(tokens_get_string(&tokens, i) == tokens_get_string(&expected, i));
+    }
+    // The token stream expands the defines the same way, also with arguments on several lines
+    Tokens stream_tokens = tokens_new(0);
+    tokens_reserve(&stream_tokens, TOKENS_INITIAL_CAPACITY);
+    test_preprocessor_stream_tokens("build/function_macro_test.c", &stream_tokens);
+    assert(stream_tokens.size == tokens.size - 1);
+    for (int i = 0; i < stream_tokens.size; i++) {
+        assert(tokens_get_type(&stream_tokens, i) == tokens_get_type(&tokens, i));
+        assert(tokens_get_string(&stream_tokens, i) == tokens_get_string(&tokens, i));
+    }
+    remove("build/function_macro_test.c");
+    tokens_free(&stream_tokens);
+    tokens_free(&tokens);
+    tokens_free(&expected);
+    preprocessor_table_free(&table);
+}
+
+void test_preprocessor_rescan() {
+    // Expansions are rescanned together with the tokens after them, so a function-like
+    // define named at the end of an expansion takes the arguments which follow it.
+    // Values are only expanded when used, so they can use defines which come later
+    write_string_to_file("build/rescan_test.c", "#define INC(x) (x + 1)\n#define G INC\n#define LATER DOUBLE\n#define ID(x) x\n#define A B\n#define B 1\n#define DOUBLE(x) (x * 2)\nint a = G(3);\nint b = LATER(4);\nint c = ID(INC)(5);\nint d = G\n(6);\nint e = G;\nint f = A;\n#undef B\n#define B 2\nint g = A;\n");
+    Tokens expected = tokenize("int a = (3 + 1);\nint b = (4 * 2);\nint c = (5 + 1);\nint d = (6 + 1);\nint e = INC;\nint f = 1;\nint g = 2;\n", false);
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("build/rescan_test.c", &table);
+    assert(tokens.size == expected.size);
+    for (int i = 0; i < tokens.size; i++) {
+        assert(tokens_get_type(&tokens, i) == tokens_get_type(&expected, i));
+        assert(tokens_get_string(&tokens, i) == tokens_get_string(&expected, i));
+    }
+    remove("build/rescan_test.c");
+    tokens_free(&tokens);
+    tokens_free(&expected);
+    preprocessor_table_free(&table);
+}
+
+void test_preprocessor_expansion_location() {
+    // Tokens of an expansion are reported at the use of the define in the file
+    write_string_to_file("build/location_test.c", "#define ONE 1\n#define ADD(a, b) (a + b)\n#define ADD_ONE(a) ADD(a, ONE)\nint x =\n  ADD_ONE(2);\n");
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("build/location_test.c", &table);
+    assert(tokens.size == 10);
+    for (int i = 3; i < 8; i++) {
+        assert(strcmp(tokens_get_src_filename(&tokens, i), "build/location_test.c") == 0);
+        assert(tokens_get_src_line(&tokens, i) == 4);
+    }
+    assert(tokens_get_type(&tokens, 5) == TK_OP_PLUS);
+    assert(tokens_get_string(&tokens, 6) == intern_str("1"));
+    remove("build/location_test.c");
+    tokens_free(&tokens);
+    preprocessor_table_free(&table);
+}
+
+void test_preprocessor_dependencies() {
+    write_string_to_file("build/dep_test.h", "#ifndef DEP_TEST_H\n#define DEP_TEST_H\n#endif\n");
+    write_string_to_file("build/dep_test.c",
+                         "#include \"dep_test.h\"\n#include <stddef.h>\n#include \"dep_test.h\"\n");
+    char* expected_rule =
+        "dep_test.o: \\\n  build/dep_test.c \\\n  build/dep_test.h \\\n  libc/stddef.h\n\nbuild/dep_test.h:\n\nlibc/stddef.h:\n";
+
+    // Every file is recorded once, including the skipped guarded include
+    PreprocessorTable table = preprocessor_table_new();
+    Tokens tokens = preprocess_first("build/dep_test.c", &table);
+    assert(table.dependencies->size == 3);
+    char* rule = preprocessor_table_dependency_rule(&table, "dep_test.o");
+    assert(strcmp(rule, expected_rule) == 0);
+    free(rule);
+    tokens_free(&tokens);
+    preprocessor_table_free(&table);
+
+    // The token stream records the same files
+    PreprocessorTable stream_table = preprocessor_table_new();
+    TokenStream stream = token_stream_new("build/dep_test.c", &stream_table);
+    int i = 0;
+    while (tokens_get_type(&stream.ring, token_stream_slot(&stream, i)) != TK_EOF) {
+        i++;
+    }
+    rule = preprocessor_table_dependency_rule(&stream_table, "dep_test.o");
+    assert(strcmp(rule, expected_rule) == 0);
+    free(rule);
+    token_stream_free(&stream);
+    preprocessor_table_free(&stream_table);
+    remove("build/dep_test.h");
+    remove("build/dep_test.c");
+}
+
 //int main() {
 //test_preprocessor();
 //}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/util/scan.h"
+
+void test_scan();
+void test_scan_kernels(char* src);
+
+void test_scan() {
+    printf("[CTEST] Running scan kernel tests...\n");
+    // Runs of every kernel's characters, longer than a 32 byte block,
+    // with the interesting character at varying offsets
+    StrVector lines = str_vec_new(8);
+    str_vec_push(&lines, "int long_identifier_name_which_spans_blocks_0123456789 = 5;");
+    str_vec_push(&lines, "\t\t                                        x;");
+    str_vec_push(&lines, "char* str = \"a string with \\\" an escaped quote and \\\\ a backslash\";");
+    str_vec_push(&lines, "/* a block comment which is long enough to span several blocks * / */");
+    str_vec_push(&lines, "\n");
+    str_vec_push(&lines, "_a9\t \t \t \t \t \t \t \t \t \t \t \t \t \t \t \t \t \t \t \tb ;");
+    str_vec_push(&lines, "€_utf8_is_not_an_identifier_character€");
+    str_vec_push(&lines, "no_newline_at_the_end_of_the_source_string_so_the_line_end_is_the_terminator");
+    char* joined = str_vec_join_with_delim(&lines, '\n');
+    // The joined string ends with a newline, remove it
+    joined[strlen(joined) - 1] = '\0';
+    char* src = scan_padded_copy(joined);
+    free(joined);
+    // Compare every level against the scalar kernels, at every start offset
+    for (int level = SCAN_SCALAR; level <= SCAN_AVX2; level++) {
+        scan_set_level(level);
+        test_scan_kernels(src);
+    }
+    scan_init();
+    str_vec_free(&lines);
+    free(src);
+    printf("[CTEST] Passed scan kernel tests!\n");
+}
+
+void test_scan_kernels(char* src) {
+    char* end = src + strlen(src);
+    for (char* str = src; str < end; str++) {
+        assert(scan_line_end(str) == scan_line_end_scalar(str));
+        assert(scan_skip_blanks(str, end) == scan_skip_blanks_scalar(str, end));
+        assert(scan_ident_end(str, end) == scan_ident_end_scalar(str, end));
+        assert(scan_find_either(str, end, '\"', '\\') ==
+               scan_find_either_scalar(str, end, '\"', '\\'));
+        char* comment_end = scan_comment_end(str, end);
+        assert(comment_end == end || (*comment_end == '*' && *(comment_end + 1) == '/'));
+        assert(strstr(str, "*/") == NULL || comment_end == strstr(str, "*/"));
+    }
+}
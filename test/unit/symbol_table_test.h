@@ -11,6 +11,8 @@ void test_symbol_table_vars();
 void test_symbol_table_funcs();
 void test_symbol_table_labels();
 void test_symbol_table_objects();
+void test_symbol_table_index();
+void test_symbol_table_struct_layouts();
 
 void test_symbol_table() {
     printf("[CTEST] Running symbol table tests...\n");
@@ -19,6 +21,8 @@ void test_symbol_table() {
     test_symbol_table_funcs();
     test_symbol_table_objects();
     test_symbol_table_labels();
+    test_symbol_table_index();
+    test_symbol_table_struct_layouts();
     printf("[CTEST] Passed symbol table tests!\n");
 }
 
@@ -51,33 +55,33 @@ void test_symbol_table_vars() {
 
     // Inserting
     Variable var;
-    var.name = "var1";
+    var.name = intern_str("var1");
     var.type.bytes = 1;
     var.type.ptr_level = 0;
     var.type.type = TY_INT;
     symbol_table_insert_var(table, var);
     assert(table->var_count == 1);
-    var.name = "var2";
+    var.name = intern_str("var2");
     var.type.bytes = 2;
     symbol_table_insert_var(table, var);
-    var.name = "var3";
+    var.name = intern_str("var3");
     var.type.bytes = 3;
     symbol_table_insert_var(table, var);
     assert(table->var_count == 3);
     assert(table->var_max_count == 4);
 
     // Lookup
-    assert(symbol_table_lookup_var(table, "var1").type.bytes == 1);
-    assert(symbol_table_lookup_var(table, "var2").type.bytes == 2);
-    assert(symbol_table_lookup_var(table, "var3").type.bytes == 3);
+    assert(symbol_table_lookup_var(table, intern_str("var1")).type.bytes == 1);
+    assert(symbol_table_lookup_var(table, intern_str("var2")).type.bytes == 2);
+    assert(symbol_table_lookup_var(table, intern_str("var3")).type.bytes == 3);
 
-    var.name = "var4";
+    var.name = intern_str("var4");
     var.type.bytes = 4;
     symbol_table_insert_var(child, var);
-    assert(symbol_table_lookup_var(child, "var4").type.bytes == 4);
+    assert(symbol_table_lookup_var(child, intern_str("var4")).type.bytes == 4);
     // Check going up a scope
-    assert(symbol_table_lookup_var(child, "var1").type.bytes == 1);
-    // symbol_table_lookup_var(child, "novar"); // This will correctly error!
+    assert(symbol_table_lookup_var(child, intern_str("var1")).type.bytes == 1);
+    // symbol_table_lookup_var(child, intern_str("novar")); // This will correctly error!
     symbol_table_free(table);
 }
 
@@ -87,27 +91,27 @@ void test_symbol_table_funcs() {
 
     // Inserting
     Function func;
-    func.name = "func1";
+    func.name = intern_str("func1");
     func.def_param_count = 1;
     symbol_table_insert_func(table, func);
     assert(table->func_count == 1);
-    func.name = "func2";
+    func.name = intern_str("func2");
     func.def_param_count = 2;
     symbol_table_insert_func(table, func);
-    func.name = "func3";
+    func.name = intern_str("func3");
     func.def_param_count = 3;
     symbol_table_insert_func(table, func);
     assert(table->func_count == 3);
     assert(table->func_max_count == 4);
 
     // Lookup
-    assert(symbol_table_lookup_func(table, "func1").def_param_count == 1);
-    assert(symbol_table_lookup_func(table, "func2").def_param_count == 2);
-    assert(symbol_table_lookup_func(table, "func3").def_param_count == 3);
+    assert(symbol_table_lookup_func(table, intern_str("func1")).def_param_count == 1);
+    assert(symbol_table_lookup_func(table, intern_str("func2")).def_param_count == 2);
+    assert(symbol_table_lookup_func(table, intern_str("func3")).def_param_count == 3);
 
     // Check going up a scope
-    assert(symbol_table_lookup_func(child, "func1").def_param_count == 1);
-    // symbol_table_lookup_var(child, "novar"); // This will correctly error!
+    assert(symbol_table_lookup_func(child, intern_str("func1")).def_param_count == 1);
+    // symbol_table_lookup_var(child, intern_str("novar")); // This will correctly error!
     symbol_table_free(table);
 }
 
@@ -158,31 +162,136 @@ void test_symbol_table_objects() {
 
     // Inserting
     Object obj;
-    obj.name = "obj1";
+    obj.name = intern_str("obj1");
     obj.type = 1;
     symbol_table_insert_object(table, obj);
     assert(table->object_count == 1);
-    obj.name = "obj2";
+    obj.name = intern_str("obj2");
     obj.type = 2;
     symbol_table_insert_object(table, obj);
-    obj.name = "obj3";
+    obj.name = intern_str("obj3");
     obj.type = 3;
     symbol_table_insert_object(table, obj);
     assert(table->object_count == 3);
     assert(table->object_max_count == 4);
 
     // Lookup
-    assert(symbol_table_lookup_object(table, "obj1", 1)->type == 1);
-    assert(symbol_table_lookup_object(table, "obj2", 2)->type == 2);
-    assert(symbol_table_lookup_object(table, "obj3", 3)->type == 3);
+    assert(symbol_table_lookup_object(table, intern_str("obj1"), 1)->type == 1);
+    assert(symbol_table_lookup_object(table, intern_str("obj2"), 2)->type == 2);
+    assert(symbol_table_lookup_object(table, intern_str("obj3"), 3)->type == 3);
 
-    obj.name = "obj4";
+    obj.name = intern_str("obj4");
     obj.type = 4;
     symbol_table_insert_object(child, obj);
-    assert(symbol_table_lookup_object(child, "obj4", 4)->type == 4);
+    assert(symbol_table_lookup_object(child, intern_str("obj4"), 4)->type == 4);
     // Check going up a scope
-    assert(symbol_table_lookup_object(child, "obj1", 1)->type == 1);
-    // symbol_table_lookup_var(child, "novar"); // This will correctly error!
+    assert(symbol_table_lookup_object(child, intern_str("obj1"), 1)->type == 1);
+    // symbol_table_lookup_var(child, intern_str("novar")); // This will correctly error!
+    symbol_table_free(table);
+}
+
+// Test lookups in scopes with enough symbols to grow the hash index several times
+void test_symbol_table_index() {
+    SymbolTable* table = symbol_table_new();
+    SymbolTable* child = symbol_table_create_child(table, 0);
+    char name[32];
+
+    Variable var;
+    var.type.ptr_level = 0;
+    var.type.type = TY_INT;
+    var.type.bytes = 4;
+    Function func;
+    Object obj;
+    obj.type = OBJ_STRUCT;
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "sym%d", i);
+        var.name = intern_str(name);
+        var.type.bytes = i;
+        symbol_table_insert_var(table, var);
+        func.name = var.name;
+        func.def_param_count = i;
+        symbol_table_insert_func(table, func);
+        obj.name = var.name;
+        obj.struct_type.bytes = i;
+        symbol_table_insert_object(table, obj);
+    }
+    assert(table->var_index.size == 1000);
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "sym%d", i);
+        char* sym_name = intern_str(name);
+        assert(symbol_table_lookup_var(child, sym_name).type.bytes == i);
+        assert(symbol_table_lookup_func(child, sym_name).def_param_count == i);
+        Object* obj_found = symbol_table_lookup_object(child, sym_name, OBJ_STRUCT);
+        assert(obj_found->struct_type.bytes == i);
+        assert(symbol_table_lookup_object(child, sym_name, OBJ_ENUM) == NULL);
+    }
+
+    // Shadowing in a child scope
+    var.name = intern_str("sym5");
+    var.type.bytes = 1005;
+    symbol_table_insert_var(child, var);
+    assert(symbol_table_lookup_var(child, var.name).type.bytes == 1005);
+    assert(symbol_table_lookup_var(table, var.name).type.bytes == 5);
+
+    // Lookups find the first declaration of a variable, functions are replaced
+    var.type.bytes = 2005;
+    symbol_table_insert_var(table, var);
+    assert(table->var_count == 1001);
+    assert(symbol_table_lookup_var(table, var.name).type.bytes == 5);
+    func.name = var.name;
+    func.def_param_count = 2005;
+    symbol_table_insert_func(table, func);
+    assert(table->func_count == 1000);
+    assert(symbol_table_lookup_func(table, var.name).def_param_count == 2005);
+
+    // Objects of different types with the same name
+    obj.type = OBJ_ENUM;
+    obj.struct_type.bytes = 3005;
+    symbol_table_insert_object(table, obj);
+    Object* enum_obj = symbol_table_lookup_object(child, obj.name, OBJ_ENUM);
+    Object* struct_obj = symbol_table_lookup_object(child, obj.name, OBJ_STRUCT);
+    assert(enum_obj->struct_type.bytes == 3005);
+    assert(struct_obj->struct_type.bytes == 999);
+    symbol_table_free(table);
+}
+
+// Test member lookup in struct layouts owned by the scopes defining them
+void test_symbol_table_struct_layouts() {
+    SymbolTable* table = symbol_table_new();
+    SymbolTable* child = symbol_table_create_child(table, 0);
+    char name[32];
+
+    StructLayout* layout = symbol_table_new_struct_layout(table, intern_str("s"));
+    VarType member;
+    member.type = TY_INT;
+    member.bytes = 8;
+    member.ptr_level = 0;
+    for (int i = 0; i < 100; i++) {
+        sprintf(name, "member%d", i);
+        member.struct_member_name = intern_str(name);
+        member.struct_bytes_offset = i * 8;
+        struct_layout_add_member(layout, member);
+    }
+    assert(layout->member_count == 100);
+    for (int i = 0; i < 100; i++) {
+        sprintf(name, "member%d", i);
+        VarType* found = struct_layout_lookup_member(layout, intern_str(name));
+        assert(found->struct_bytes_offset == i * 8);
+        assert(found == &layout->members[i]);
+    }
+    assert(struct_layout_lookup_member(layout, intern_str("member100")) == NULL);
+    assert(struct_layout_lookup_member(NULL, intern_str("member0")) == NULL);
+
+    // Unnamed structs in a child scope are owned by it
+    StructLayout* unnamed = symbol_table_new_struct_layout(child, NULL);
+    unnamed->bytes = 16;
+    assert(child->struct_layout_count == 1);
+    assert(child->struct_layouts[0] == unnamed);
+
+    Variable var = variable_new();
+    assert(variable_struct_bytes(&var) == 0);
+    var.struct_layout = unnamed;
+    assert(variable_struct_bytes(&var) == 16);
     symbol_table_free(table);
 }
 
@@ -2,21 +2,35 @@
 
 #include "vector_test.h"
 #include "string_helpers_test.h"
+#include "scan_test.h"
+#include "intern_test.h"
+#include "arena_test.h"
 #include "tokenizer_test.h"
 #include "preprocessor_test.h"
 #include "symbol_table_test.h"
+#include "type_table_test.h"
 #include "parser_test.h"
 #include "codegen_test.h"
+#include "driver_test.h"
 
 int main() {
     printf("[CTEST] Running all unit tests...\n");
+    scan_init();
     test_vector();
     test_string_helpers();
+    test_scan();
+    test_intern();
+    test_arena();
     test_tokenizer();
     test_preprocessor();
     test_symbol_table();
+    test_type_table();
     test_parser();
     test_codegen();
+    test_driver();
+    source_files_free();
+    intern_pool_free();
+    type_table_free();
     printf("[CTEST] Passed all unit tests!\n");
     return 0;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "../../src/tokens.h"
+#include "../../src/token_cache.h"
 #include "../../src/util/file_helpers.h"
 
 // Declarations
@@ -18,6 +19,9 @@ void test_tokenizer_idents();
 void test_tokenizer_values();
 void test_tokenizer_delims();
 void test_tokenizer_large_src();
+void test_tokenizer_mapped_src();
+void test_tokenizer_cache();
+void test_tokenizer_cache_corrupt();
 
 // Definitions
 void test_tokenizer() {
@@ -34,6 +38,9 @@ void test_tokenizer() {
     test_tokenizer_delims();
 
     test_tokenizer_large_src();
+    test_tokenizer_mapped_src();
+    test_tokenizer_cache();
+    test_tokenizer_cache_corrupt();
 
     printf("[CTEST] Passed tokenizer tests!\n");
 }
@@ -48,24 +55,24 @@ void test_tokenizer_helpers() {
     Tokens tokens1 = tokens_new(4);
     //tokens_get(&combined_tokens,
     //tokens_get(&tokens,
-    tokens_get(&tokens1, 0)->type = 1;
-    tokens_get(&tokens1, 1)->type = 2;
-    tokens_get(&tokens1, 2)->type = 6;
-    tokens_get(&tokens1, 3)->type = 7;
+    tokens_set_type(&tokens1, 0, 1);
+    tokens_set_type(&tokens1, 1, 2);
+    tokens_set_type(&tokens1, 2, 6);
+    tokens_set_type(&tokens1, 3, 7);
     Tokens tokens2 = tokens_new(3);
-    tokens_get(&tokens2, 0)->type = 3;
-    tokens_get(&tokens2, 1)->type = 4;
-    tokens_get(&tokens2, 2)->type = 5;
+    tokens_set_type(&tokens2, 0, 3);
+    tokens_set_type(&tokens2, 1, 4);
+    tokens_set_type(&tokens2, 2, 5);
     Tokens* combined_tokens = tokens_insert(&tokens1, &tokens2, 2);
 
     assert(combined_tokens->size == 7);
-    assert(tokens_get(combined_tokens, 0)->type == 1);
-    assert(tokens_get(combined_tokens, 1)->type == 2);
-    assert(tokens_get(combined_tokens, 2)->type == 3);
-    assert(tokens_get(combined_tokens, 3)->type == 4);
-    assert(tokens_get(combined_tokens, 4)->type == 5);
-    assert(tokens_get(combined_tokens, 5)->type == 6);
-    assert(tokens_get(combined_tokens, 6)->type == 7);
+    assert(tokens_get_type(combined_tokens, 0) == 1);
+    assert(tokens_get_type(combined_tokens, 1) == 2);
+    assert(tokens_get_type(combined_tokens, 2) == 3);
+    assert(tokens_get_type(combined_tokens, 3) == 4);
+    assert(tokens_get_type(combined_tokens, 4) == 5);
+    assert(tokens_get_type(combined_tokens, 5) == 6);
+    assert(tokens_get_type(combined_tokens, 6) == 7);
     tokens_free(&tokens1);
     tokens_free(&tokens2);
 }
@@ -74,10 +81,10 @@ void test_tokenizer_preprocessor() {
     // Preproccessor
     char* src = "#define\n   #include test\n";
     Tokens tokens = tokenize(src, false);
-    assert(tokens_get(&tokens, 0)->type == TK_PREPROCESSOR);
-    assert(tokens_get(&tokens, 1)->type == TK_PREPROCESSOR);
-    assert(tokens_get(&tokens, 2)->type == TK_EOF); // Last token should always be EOF
-    assert(strcmp(tokens_get(&tokens, 1)->string_repr, "#include test") == 0);
+    assert(tokens_get_type(&tokens, 0) == TK_PREPROCESSOR);
+    assert(tokens_get_type(&tokens, 1) == TK_PREPROCESSOR);
+    assert(tokens_get_type(&tokens, 2) == TK_EOF); // Last token should always be EOF
+    assert(strcmp(tokens_get_string(&tokens, 1), "#include test") == 0);
     assert(tokens.size == 3);
     tokens_free(&tokens);
 }
@@ -88,19 +95,19 @@ void test_tokenizer_comments() {
         "//#define\n #define \n while // hello \n/*test */ \n while /* \n if \n */while\n /**/ /**/\n \"// \\\"/* */\" \n /*\n*/";
     // "// /* */\"
     Tokens tokens = tokenize(src, false);
-    assert(tokens_get(&tokens, 0)->type == TK_COMMENT);
-    assert(strcmp(tokens_get(&tokens, 1)->string_repr, "#define") == 0);
-    assert(tokens_get(&tokens, 1)->type == TK_PREPROCESSOR);
-    assert(tokens_get(&tokens, 2)->type == TK_KW_WHILE);
-    assert(tokens_get(&tokens, 3)->type == TK_COMMENT);
-    assert(tokens_get(&tokens, 4)->type == TK_COMMENT);
-    assert(tokens_get(&tokens, 5)->type == TK_KW_WHILE);
-    assert(tokens_get(&tokens, 6)->type == TK_COMMENT);
-    assert(tokens_get(&tokens, 7)->type == TK_KW_WHILE);
-    assert(tokens_get(&tokens, 8)->type == TK_COMMENT);
-    assert(tokens_get(&tokens, 9)->type == TK_COMMENT);
-    assert(tokens_get(&tokens, 10)->type == TK_LSTRING);
-    assert(tokens_get(&tokens, 11)->type == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 0) == TK_COMMENT);
+    assert(strcmp(tokens_get_string(&tokens, 1), "#define") == 0);
+    assert(tokens_get_type(&tokens, 1) == TK_PREPROCESSOR);
+    assert(tokens_get_type(&tokens, 2) == TK_KW_WHILE);
+    assert(tokens_get_type(&tokens, 3) == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 4) == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 5) == TK_KW_WHILE);
+    assert(tokens_get_type(&tokens, 6) == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 7) == TK_KW_WHILE);
+    assert(tokens_get_type(&tokens, 8) == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 9) == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 10) == TK_LSTRING);
+    assert(tokens_get_type(&tokens, 11) == TK_COMMENT);
     tokens_free(&tokens);
 }
 
@@ -108,19 +115,19 @@ void test_tokenizer_strings() {
     // Strings
     char* src = "//\"\"\n \"hello\" \n \"hello\\\"\" \n 'c' \n '\\n' '\\\"'\n\"\"while";
     Tokens tokens = tokenize(src, false);
-    assert(tokens_get(&tokens, 0)->type == TK_COMMENT);
-    assert(tokens_get(&tokens, 1)->type == TK_LSTRING);
-    assert(strcmp(tokens_get(&tokens, 1)->string_repr, "hello") == 0);
-    assert(tokens_get(&tokens, 2)->type == TK_LSTRING);
-    assert(strcmp(tokens_get(&tokens, 2)->string_repr, "hello\\\"") == 0);
-    assert(tokens_get(&tokens, 3)->type == TK_LCHAR);
-    assert(strcmp(tokens_get(&tokens, 3)->string_repr, "c") == 0);
-    assert(tokens_get(&tokens, 4)->type == TK_LCHAR);
-    assert(strcmp(tokens_get(&tokens, 4)->string_repr, "\\n") == 0);
-    assert(tokens_get(&tokens, 5)->type == TK_LCHAR);
-    assert(strcmp(tokens_get(&tokens, 5)->string_repr, "\\\"") == 0);
-    assert(tokens_get(&tokens, 6)->type == TK_LSTRING);
-    assert(tokens_get(&tokens, 7)->type == TK_KW_WHILE);
+    assert(tokens_get_type(&tokens, 0) == TK_COMMENT);
+    assert(tokens_get_type(&tokens, 1) == TK_LSTRING);
+    assert(strcmp(tokens_get_string(&tokens, 1), "hello") == 0);
+    assert(tokens_get_type(&tokens, 2) == TK_LSTRING);
+    assert(strcmp(tokens_get_string(&tokens, 2), "hello\\\"") == 0);
+    assert(tokens_get_type(&tokens, 3) == TK_LCHAR);
+    assert(strcmp(tokens_get_string(&tokens, 3), "c") == 0);
+    assert(tokens_get_type(&tokens, 4) == TK_LCHAR);
+    assert(strcmp(tokens_get_string(&tokens, 4), "\\n") == 0);
+    assert(tokens_get_type(&tokens, 5) == TK_LCHAR);
+    assert(strcmp(tokens_get_string(&tokens, 5), "\\\"") == 0);
+    assert(tokens_get_type(&tokens, 6) == TK_LSTRING);
+    assert(tokens_get_type(&tokens, 7) == TK_KW_WHILE);
     tokens_free(&tokens);
 }
 
@@ -129,36 +136,49 @@ void test_tokenizer_keywords() {
     char* src =
         "unsigned.if else while do for break continue return switch case\ndefault goto typedef struct union const long short signed int float double char void hello_int int_hello _int";
     Tokens tokens = tokenize(src, false);
-    assert(tokens_get(&tokens, 0)->type == TK_KW_UNSIGNED);
-    assert(tokens_get(&tokens, 1)->type == TK_DL_DOT);
-    assert(tokens_get(&tokens, 2)->type == TK_KW_IF);
-    assert(tokens_get(&tokens, 3)->type == TK_KW_ELSE);
-    assert(tokens_get(&tokens, 4)->type == TK_KW_WHILE);
-    assert(tokens_get(&tokens, 5)->type == TK_KW_DO);
-    assert(tokens_get(&tokens, 6)->type == TK_KW_FOR);
-    assert(tokens_get(&tokens, 7)->type == TK_KW_BREAK);
-    assert(tokens_get(&tokens, 8)->type == TK_KW_CONTINUE);
-    assert(tokens_get(&tokens, 9)->type == TK_KW_RETURN);
-    assert(tokens_get(&tokens, 10)->type == TK_KW_SWITCH);
-    assert(tokens_get(&tokens, 11)->type == TK_KW_CASE);
-    assert(tokens_get(&tokens, 12)->type == TK_KW_DEFAULT);
-    assert(tokens_get(&tokens, 13)->type == TK_KW_GOTO);
-    assert(tokens_get(&tokens, 14)->type == TK_KW_TYPEDEF);
-    assert(tokens_get(&tokens, 15)->type == TK_KW_STRUCT);
-    assert(tokens_get(&tokens, 16)->type == TK_KW_UNION);
-    assert(tokens_get(&tokens, 17)->type == TK_KW_CONST);
-    assert(tokens_get(&tokens, 18)->type == TK_KW_LONG);
-    assert(tokens_get(&tokens, 19)->type == TK_KW_SHORT);
-    assert(tokens_get(&tokens, 20)->type == TK_KW_SIGNED);
-    assert(tokens_get(&tokens, 21)->type == TK_KW_INT);
-    assert(tokens_get(&tokens, 22)->type == TK_KW_FLOAT);
-    assert(tokens_get(&tokens, 23)->type == TK_KW_DOUBLE);
-    assert(tokens_get(&tokens, 24)->type == TK_KW_CHAR);
-    assert(tokens_get(&tokens, 25)->type == TK_KW_VOID);
-    //assert(tokens_get(&tokens, 26)->type == TK_IDENT);
-    //assert(tokens_get(&tokens, 27)->type == TK_IDENT);
-    //assert(tokens_get(&tokens, 28)->type == TK_IDENT);
-    //assert(tokens_get(&tokens, 29)->type == TK_EOF);
+    assert(tokens_get_type(&tokens, 0) == TK_KW_UNSIGNED);
+    assert(tokens_get_type(&tokens, 1) == TK_DL_DOT);
+    assert(tokens_get_type(&tokens, 2) == TK_KW_IF);
+    assert(tokens_get_type(&tokens, 3) == TK_KW_ELSE);
+    assert(tokens_get_type(&tokens, 4) == TK_KW_WHILE);
+    assert(tokens_get_type(&tokens, 5) == TK_KW_DO);
+    assert(tokens_get_type(&tokens, 6) == TK_KW_FOR);
+    assert(tokens_get_type(&tokens, 7) == TK_KW_BREAK);
+    assert(tokens_get_type(&tokens, 8) == TK_KW_CONTINUE);
+    assert(tokens_get_type(&tokens, 9) == TK_KW_RETURN);
+    assert(tokens_get_type(&tokens, 10) == TK_KW_SWITCH);
+    assert(tokens_get_type(&tokens, 11) == TK_KW_CASE);
+    assert(tokens_get_type(&tokens, 12) == TK_KW_DEFAULT);
+    assert(tokens_get_type(&tokens, 13) == TK_KW_GOTO);
+    assert(tokens_get_type(&tokens, 14) == TK_KW_TYPEDEF);
+    assert(tokens_get_type(&tokens, 15) == TK_KW_STRUCT);
+    assert(tokens_get_type(&tokens, 16) == TK_KW_UNION);
+    assert(tokens_get_type(&tokens, 17) == TK_KW_CONST);
+    assert(tokens_get_type(&tokens, 18) == TK_KW_LONG);
+    assert(tokens_get_type(&tokens, 19) == TK_KW_SHORT);
+    assert(tokens_get_type(&tokens, 20) == TK_KW_SIGNED);
+    assert(tokens_get_type(&tokens, 21) == TK_KW_INT);
+    assert(tokens_get_type(&tokens, 22) == TK_KW_FLOAT);
+    assert(tokens_get_type(&tokens, 23) == TK_KW_DOUBLE);
+    assert(tokens_get_type(&tokens, 24) == TK_KW_CHAR);
+    assert(tokens_get_type(&tokens, 25) == TK_KW_VOID);
+    assert(tokens_get_type(&tokens, 26) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 27) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 28) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 29) == TK_EOF);
+    tokens_free(&tokens);
+
+    // Words which are close to keywords must still be identifiers
+    src = "extern static enum sizeof in ints doubles whilst dp sizeofs structs voi s";
+    tokens = tokenize(src, false);
+    assert(tokens_get_type(&tokens, 0) == TK_KW_EXTERN);
+    assert(tokens_get_type(&tokens, 1) == TK_KW_STATIC);
+    assert(tokens_get_type(&tokens, 2) == TK_KW_ENUM);
+    assert(tokens_get_type(&tokens, 3) == TK_OP_SIZEOF);
+    for (int i = 4; i < 13; i++) {
+        assert(tokens_get_type(&tokens, i) == TK_IDENT);
+    }
+    assert(tokens_get_type(&tokens, 13) == TK_EOF);
     tokens_free(&tokens);
 }
 
@@ -167,42 +187,42 @@ void test_tokenizer_ops() {
     char* src =
         "|| && >> << == != >= <= + - * / % | & ~ ^ > < ! = ? ++ -- += -= *= /= %= <<= >>= &= |= ^= sizeof ->";
     Tokens tokens = tokenize(src, false);
-    assert(tokens_get(&tokens, 0)->type == TK_OP_OR);
-    assert(tokens_get(&tokens, 1)->type == TK_OP_AND);
-    assert(tokens_get(&tokens, 2)->type == TK_OP_RIGHTSHIFT);
-    assert(tokens_get(&tokens, 3)->type == TK_OP_LEFTSHIFT);
-    assert(tokens_get(&tokens, 4)->type == TK_OP_EQ);
-    assert(tokens_get(&tokens, 5)->type == TK_OP_NEQ);
-    assert(tokens_get(&tokens, 6)->type == TK_OP_GTE);
-    assert(tokens_get(&tokens, 7)->type == TK_OP_LTE);
-    assert(tokens_get(&tokens, 8)->type == TK_OP_PLUS);
-    assert(tokens_get(&tokens, 9)->type == TK_OP_MINUS);
-    assert(tokens_get(&tokens, 10)->type == TK_OP_MULT);
-    assert(tokens_get(&tokens, 11)->type == TK_OP_DIV);
-    assert(tokens_get(&tokens, 12)->type == TK_OP_MOD);
-    assert(tokens_get(&tokens, 13)->type == TK_OP_BITOR);
-    assert(tokens_get(&tokens, 14)->type == TK_OP_BITAND);
-    assert(tokens_get(&tokens, 15)->type == TK_OP_COMPL);
-    assert(tokens_get(&tokens, 16)->type == TK_OP_BITXOR);
-    assert(tokens_get(&tokens, 17)->type == TK_OP_GT);
-    assert(tokens_get(&tokens, 18)->type == TK_OP_LT);
-    assert(tokens_get(&tokens, 19)->type == TK_OP_NOT);
-    assert(tokens_get(&tokens, 20)->type == TK_OP_ASSIGN);
-    assert(tokens_get(&tokens, 21)->type == TK_OP_QST);
-    assert(tokens_get(&tokens, 22)->type == TK_OP_INCR);
-    assert(tokens_get(&tokens, 23)->type == TK_OP_DECR);
-    assert(tokens_get(&tokens, 24)->type == TK_OP_ASSIGN_ADD);
-    assert(tokens_get(&tokens, 25)->type == TK_OP_ASSIGN_SUB);
-    assert(tokens_get(&tokens, 26)->type == TK_OP_ASSIGN_MULT);
-    assert(tokens_get(&tokens, 27)->type == TK_OP_ASSIGN_DIV);
-    assert(tokens_get(&tokens, 28)->type == TK_OP_ASSIGN_MOD);
-    assert(tokens_get(&tokens, 29)->type == TK_OP_ASSIGN_LEFTSHIFT);
-    assert(tokens_get(&tokens, 30)->type == TK_OP_ASSIGN_RIGHTSHIFT);
-    assert(tokens_get(&tokens, 31)->type == TK_OP_ASSIGN_BITAND);
-    assert(tokens_get(&tokens, 32)->type == TK_OP_ASSIGN_BITOR);
-    assert(tokens_get(&tokens, 33)->type == TK_OP_ASSIGN_BITXOR);
-    assert(tokens_get(&tokens, 34)->type == TK_OP_SIZEOF);
-    assert(tokens_get(&tokens, 35)->type == TK_OP_PTR_MEMBER);
+    assert(tokens_get_type(&tokens, 0) == TK_OP_OR);
+    assert(tokens_get_type(&tokens, 1) == TK_OP_AND);
+    assert(tokens_get_type(&tokens, 2) == TK_OP_RIGHTSHIFT);
+    assert(tokens_get_type(&tokens, 3) == TK_OP_LEFTSHIFT);
+    assert(tokens_get_type(&tokens, 4) == TK_OP_EQ);
+    assert(tokens_get_type(&tokens, 5) == TK_OP_NEQ);
+    assert(tokens_get_type(&tokens, 6) == TK_OP_GTE);
+    assert(tokens_get_type(&tokens, 7) == TK_OP_LTE);
+    assert(tokens_get_type(&tokens, 8) == TK_OP_PLUS);
+    assert(tokens_get_type(&tokens, 9) == TK_OP_MINUS);
+    assert(tokens_get_type(&tokens, 10) == TK_OP_MULT);
+    assert(tokens_get_type(&tokens, 11) == TK_OP_DIV);
+    assert(tokens_get_type(&tokens, 12) == TK_OP_MOD);
+    assert(tokens_get_type(&tokens, 13) == TK_OP_BITOR);
+    assert(tokens_get_type(&tokens, 14) == TK_OP_BITAND);
+    assert(tokens_get_type(&tokens, 15) == TK_OP_COMPL);
+    assert(tokens_get_type(&tokens, 16) == TK_OP_BITXOR);
+    assert(tokens_get_type(&tokens, 17) == TK_OP_GT);
+    assert(tokens_get_type(&tokens, 18) == TK_OP_LT);
+    assert(tokens_get_type(&tokens, 19) == TK_OP_NOT);
+    assert(tokens_get_type(&tokens, 20) == TK_OP_ASSIGN);
+    assert(tokens_get_type(&tokens, 21) == TK_OP_QST);
+    assert(tokens_get_type(&tokens, 22) == TK_OP_INCR);
+    assert(tokens_get_type(&tokens, 23) == TK_OP_DECR);
+    assert(tokens_get_type(&tokens, 24) == TK_OP_ASSIGN_ADD);
+    assert(tokens_get_type(&tokens, 25) == TK_OP_ASSIGN_SUB);
+    assert(tokens_get_type(&tokens, 26) == TK_OP_ASSIGN_MULT);
+    assert(tokens_get_type(&tokens, 27) == TK_OP_ASSIGN_DIV);
+    assert(tokens_get_type(&tokens, 28) == TK_OP_ASSIGN_MOD);
+    assert(tokens_get_type(&tokens, 29) == TK_OP_ASSIGN_LEFTSHIFT);
+    assert(tokens_get_type(&tokens, 30) == TK_OP_ASSIGN_RIGHTSHIFT);
+    assert(tokens_get_type(&tokens, 31) == TK_OP_ASSIGN_BITAND);
+    assert(tokens_get_type(&tokens, 32) == TK_OP_ASSIGN_BITOR);
+    assert(tokens_get_type(&tokens, 33) == TK_OP_ASSIGN_BITXOR);
+    assert(tokens_get_type(&tokens, 34) == TK_OP_SIZEOF);
+    assert(tokens_get_type(&tokens, 35) == TK_OP_PTR_MEMBER);
 
     tokens_free(&tokens);
 }
@@ -211,37 +231,37 @@ void test_tokenizer_idents() {
     // Identifiers
     char* src = "int x = a; \n abc \n a \n _a \n 1a \n _ \na\nabc_efg";
     Tokens tokens = tokenize(src, true);
-    assert(tokens_get(&tokens, 0)->type == TK_KW_INT);
-    assert(tokens_get(&tokens, 1)->type == TK_IDENT);
-    assert(tokens_get(&tokens, 2)->type == TK_OP_ASSIGN);
-    assert(tokens_get(&tokens, 3)->type == TK_IDENT);
-    assert(tokens_get(&tokens, 4)->type == TK_DL_SEMICOLON);
-    assert(tokens_get(&tokens, 5)->type == TK_IDENT);
-    assert(tokens_get(&tokens, 6)->type == TK_IDENT);
-    assert(tokens_get(&tokens, 7)->type == TK_IDENT);
-    assert(strcmp(tokens_get(&tokens, 7)->string_repr, "_a") == 0);
-    assert(tokens_get(&tokens, 8)->type == TK_IDENT);
-    assert(strcmp(tokens_get(&tokens, 8)->string_repr, "_") == 0);
-    assert(tokens_get(&tokens, 9)->type == TK_IDENT);
-    assert(strcmp(tokens_get(&tokens, 10)->string_repr, "abc_efg") == 0);
-    assert(tokens_get(&tokens, 10)->type == TK_IDENT);
+    assert(tokens_get_type(&tokens, 0) == TK_KW_INT);
+    assert(tokens_get_type(&tokens, 1) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 2) == TK_OP_ASSIGN);
+    assert(tokens_get_type(&tokens, 3) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 4) == TK_DL_SEMICOLON);
+    assert(tokens_get_type(&tokens, 5) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 6) == TK_IDENT);
+    assert(tokens_get_type(&tokens, 7) == TK_IDENT);
+    assert(strcmp(tokens_get_string(&tokens, 7), "_a") == 0);
+    assert(tokens_get_type(&tokens, 8) == TK_IDENT);
+    assert(strcmp(tokens_get_string(&tokens, 8), "_") == 0);
+    assert(tokens_get_type(&tokens, 9) == TK_IDENT);
+    assert(strcmp(tokens_get_string(&tokens, 10), "abc_efg") == 0);
+    assert(tokens_get_type(&tokens, 10) == TK_IDENT);
     tokens_free(&tokens);
-    tokens_free_line_strings(&tokens);
+    source_files_free();
 }
 
 void test_tokenizer_delims() {
     char* src = "{}()[],.;:";
     Tokens tokens = tokenize(src, false);
-    assert(tokens_get(&tokens, 0)->type == TK_DL_OPENBRACE);
-    assert(tokens_get(&tokens, 1)->type == TK_DL_CLOSEBRACE);
-    assert(tokens_get(&tokens, 2)->type == TK_DL_OPENPAREN);
-    assert(tokens_get(&tokens, 3)->type == TK_DL_CLOSEPAREN);
-    assert(tokens_get(&tokens, 4)->type == TK_DL_OPENBRACKET);
-    assert(tokens_get(&tokens, 5)->type == TK_DL_CLOSEBRACKET);
-    assert(tokens_get(&tokens, 6)->type == TK_DL_COMMA);
-    assert(tokens_get(&tokens, 7)->type == TK_DL_DOT);
-    assert(tokens_get(&tokens, 8)->type == TK_DL_SEMICOLON);
-    assert(tokens_get(&tokens, 9)->type == TK_DL_COLON);
+    assert(tokens_get_type(&tokens, 0) == TK_DL_OPENBRACE);
+    assert(tokens_get_type(&tokens, 1) == TK_DL_CLOSEBRACE);
+    assert(tokens_get_type(&tokens, 2) == TK_DL_OPENPAREN);
+    assert(tokens_get_type(&tokens, 3) == TK_DL_CLOSEPAREN);
+    assert(tokens_get_type(&tokens, 4) == TK_DL_OPENBRACKET);
+    assert(tokens_get_type(&tokens, 5) == TK_DL_CLOSEBRACKET);
+    assert(tokens_get_type(&tokens, 6) == TK_DL_COMMA);
+    assert(tokens_get_type(&tokens, 7) == TK_DL_DOT);
+    assert(tokens_get_type(&tokens, 8) == TK_DL_SEMICOLON);
+    assert(tokens_get_type(&tokens, 9) == TK_DL_COLON);
     tokens_free(&tokens);
 }
 
@@ -249,18 +269,18 @@ void test_tokenizer_values() {
     char* src = "13; \n3134\n 53asd; 1.3 .3 3. 1.3b ;";
     Tokens tokens = tokenize(src, false);
     // Ints
-    assert(tokens_get(&tokens, 0)->type == TK_LINT);
-    assert(strcmp(tokens_get(&tokens, 0)->string_repr, "13") == 0);
-    assert(tokens_get(&tokens, 1)->type == TK_DL_SEMICOLON);
-    assert(tokens_get(&tokens, 2)->type == TK_LINT);
-    assert(strcmp(tokens_get(&tokens, 2)->string_repr, "3134") == 0);
-    assert(tokens_get(&tokens, 3)->type == TK_DL_SEMICOLON);
+    assert(tokens_get_type(&tokens, 0) == TK_LINT);
+    assert(strcmp(tokens_get_string(&tokens, 0), "13") == 0);
+    assert(tokens_get_type(&tokens, 1) == TK_DL_SEMICOLON);
+    assert(tokens_get_type(&tokens, 2) == TK_LINT);
+    assert(strcmp(tokens_get_string(&tokens, 2), "3134") == 0);
+    assert(tokens_get_type(&tokens, 3) == TK_DL_SEMICOLON);
     // Floats
-    assert(tokens_get(&tokens, 4)->type == TK_LFLOAT);
-    assert(tokens_get(&tokens, 5)->type == TK_LFLOAT);
-    assert(tokens_get(&tokens, 6)->type == TK_LFLOAT);
-    assert(tokens_get(&tokens, 7)->type == TK_DL_DOT);
-    assert(tokens_get(&tokens, 8)->type == TK_DL_SEMICOLON);
+    assert(tokens_get_type(&tokens, 4) == TK_LFLOAT);
+    assert(tokens_get_type(&tokens, 5) == TK_LFLOAT);
+    assert(tokens_get_type(&tokens, 6) == TK_LFLOAT);
+    assert(tokens_get_type(&tokens, 7) == TK_DL_DOT);
+    assert(tokens_get_type(&tokens, 8) == TK_DL_SEMICOLON);
     tokens_free(&tokens);
 }
 
@@ -268,51 +288,123 @@ void test_tokenizer_large_src() {
     char* src = load_file_to_string("test/unit/examples/example1.c");
     //char* src = load_file_to_string("example1.c");
 
-    // Manually tokenize
-    // We need access to the overwritten StrVector lines to ensure every token was grabbed
-    int src_length = strlen(src);
-    Tokens tokens = tokens_new(src_length);
+    Tokens tokens = tokenize(src, false);
+
+    // Check some tokens manually to make sure everything works as intended
+    assert(tokens_get_type(&tokens, 0) == TK_PREPROCESSOR);
+    assert(tokens_get_type(&tokens, 2) == TK_IDENT);
+    assert(tokens_get_type(&tokens, tokens.size - 1) == TK_EOF);
+    assert(tokens_get_type(&tokens, tokens.size - 2) == TK_DL_CLOSEBRACE);
+    assert(tokens_get_type(&tokens, tokens.size - 7) == TK_DL_SEMICOLON);
+    assert(tokens_get_type(&tokens, tokens.size - 8) == TK_IDENT);
+    assert(tokens_get_type(&tokens, tokens.size - 9) == TK_OP_PLUS);
+
+    tokens_free(&tokens);
+    free(src);
+}
+
+void test_tokenizer_mapped_src() {
+    char* src = load_file_to_string("test/unit/examples/example1.c");
+    Tokens tokens = tokenize(src, false);
+
+    // Opening the same path again shares the source file
+    int file_id = source_file_open("test/unit/examples/example1.c", false);
+    assert(source_file_open("test/unit/examples/example1.c", false) == file_id);
+    assert(strcmp(source_file_get(file_id)->src, src) == 0);
+
+    // Tokenizing the mapped file gives the same tokens as the loaded copy
+    Tokens mapped_tokens = tokenize_source_file(file_id);
+    assert(mapped_tokens.size == tokens.size);
+    for (int i = 0; i < tokens.size; i++) {
+        assert(tokens_get_type(&mapped_tokens, i) == tokens_get_type(&tokens, i));
+        assert(tokens_get_string(&mapped_tokens, i) == tokens_get_string(&tokens, i));
+    }
+
+    tokens_free(&mapped_tokens);
+    tokens_free(&tokens);
+    free(src);
+}
+
+void test_tokenizer_cache() {
+    system("mkdir -p build/token_cache_test");
+    token_cache_set_dir("build/token_cache_test");
+    int file_id = source_file_open("test/unit/examples/example1.c", false);
+    Tokens tokens = tokenize_source_file(file_id);
+
+    // The first tokenization writes an entry, which the second one reads
+    int hits = token_cache_hits();
+    Tokens written_tokens = token_cache_tokenize(file_id);
+    assert(token_cache_hits() == hits);
+    Tokens cached_tokens = token_cache_tokenize(file_id);
+    assert(token_cache_hits() == hits + 1);
+    token_cache_set_dir(NULL);
 
-    StrVector lines = str_split(src, '\n');
-    for (size_t i = 0; i < lines.size; i++) {
-        char* new_str = str_strip(lines.elems[i]);
-        free(lines.elems[i]);
-        lines.elems[i] = new_str;
+    assert(cached_tokens.size == tokens.size);
+    for (int i = 0; i < tokens.size; i++) {
+        assert(tokens_get_type(&cached_tokens, i) == tokens_get_type(&tokens, i));
+        assert(tokens_get_span(&cached_tokens, i)->offset == tokens_get_span(&tokens, i)->offset);
+        assert(tokens_get_string(&cached_tokens, i) == tokens_get_string(&tokens, i));
     }
+    // The conditional index is cached with the tokens
+    assert(cached_tokens.conditionals.size == tokens.conditionals.size);
+    int* pairs = tokens.conditionals.elems;
+    int* cached_pairs = cached_tokens.conditionals.elems;
+    for (int i = 0; i < tokens.conditionals.size; i++) {
+        assert(cached_pairs[i] == pairs[i]);
+    }
+
+    tokens_free(&cached_tokens);
+    tokens_free(&written_tokens);
+    tokens_free(&tokens);
+    system("rm -rf build/token_cache_test");
+}
 
-    tokenize_preprocessor(&tokens, &lines);
-    tokenize_comments(&tokens, &lines);
-    tokenize_strings(&tokens, &lines);
-    tokenize_keywords(&tokens, &lines);
-    tokenize_ops(&tokens, &lines);
-    tokenize_idents(&tokens, &lines);
-    tokenize_values(&tokens, &lines);
-    tokenize_delims(&tokens, &lines);
-
-    // Make sure every token was grabbed, only whitespace should be left
-    for (size_t i = 0; i < lines.size; i++) {
-        char* str = lines.elems[i];
-        while (*str != '\0') {
-            if (*str != ' ' && *str != '\t' && *str != '\n') {
-                assert(false);
-            }
-            str++;
-        }
+// Overwrite size bytes of a cache entry at offset, from the end of the entry if negative
+void token_cache_patch_entry(char* path, int offset, void* value, int size) {
+    FILE* entry_file = fopen(path, "r+b");
+    assert(entry_file != NULL);
+    if (offset < 0) {
+        fseek(entry_file, offset, SEEK_END);
     }
+    else {
+        fseek(entry_file, offset, SEEK_SET);
+    }
+    fwrite(value, 1, size, entry_file);
+    fclose(entry_file);
+}
 
-    tokens_trim(&tokens);
+void test_tokenizer_cache_corrupt() {
+    system("mkdir -p build/token_cache_test");
+    token_cache_set_dir("build/token_cache_test");
+    int file_id = source_file_open("test/unit/examples/example1.c", false);
+    SourceFile* file = source_file_get(file_id);
+    Tokens tokens = token_cache_tokenize(file_id);
+    char* path = token_cache_entry_path(file);
 
-    // Check some tokens manually to make sure everything works as intended
-    assert(tokens_get(&tokens, 0)->type == TK_PREPROCESSOR);
-    assert(tokens_get(&tokens, 2)->type == TK_IDENT);
-    assert(tokens_get(&tokens, tokens.size - 1)->type == TK_DL_CLOSEBRACE);
-    assert(tokens_get(&tokens, tokens.size - 6)->type == TK_DL_SEMICOLON);
-    assert(tokens_get(&tokens, tokens.size - 7)->type == TK_IDENT);
-    assert(tokens_get(&tokens, tokens.size - 8)->type == TK_OP_PLUS);
+    // A text offset past the cached text is rejected instead of read
+    Tokens cached_tokens = tokens_new(0);
+    assert(token_cache_read(path, file, file_id, &cached_tokens));
+    tokens_free(&cached_tokens);
+    int text_offset = 1073741824;
+    int text_offsets_offset = (TOKEN_CACHE_HEADER_INTS + 2 * tokens.size) * 4;
+    token_cache_patch_entry(path, text_offsets_offset, &text_offset, 4);
+    cached_tokens = tokens_new(0);
+    assert(!token_cache_read(path, file, file_id, &cached_tokens));
+    tokens_free(&cached_tokens);
 
+    // An entry of other content with the same hash is rejected by its source copy
     tokens_free(&tokens);
-    str_vec_free(&lines);
-    free(src);
+    tokens = token_cache_tokenize(file_id);
+    char c = file->src[file->size - 1] + 1;
+    token_cache_patch_entry(path, -1, &c, 1);
+    cached_tokens = tokens_new(0);
+    assert(!token_cache_read(path, file, file_id, &cached_tokens));
+    tokens_free(&cached_tokens);
+
+    token_cache_set_dir(NULL);
+    tokens_free(&tokens);
+    free(path);
+    system("rm -rf build/token_cache_test");
 }
 
 //int main() {
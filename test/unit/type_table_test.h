@@ -0,0 +1,49 @@
+#pragma once
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/type_table.h"
+
+void test_type_table();
+
+void test_type_table() {
+    printf("[CTEST] Running type table tests...\n");
+
+    // Id 0 is the zeroed type
+    VarType type;
+    memset(&type, 0, sizeof(VarType));
+    assert(type_intern(type) == TYPE_NONE);
+    assert(type_get(TYPE_NONE)->bytes == 0);
+
+    // Equal types share an id, any difference gives a new one
+    type.type = TY_INT;
+    type.bytes = 4;
+    int int_id = type_intern(type);
+    assert(int_id != TYPE_NONE);
+    assert(type_intern(type) == int_id);
+    type.ptr_level = 1;
+    type.ptr_value_bytes = 4;
+    int ptr_id = type_intern(type);
+    assert(ptr_id != int_id);
+    type.struct_name = intern_str("type_table_struct");
+    assert(type_intern(type) != ptr_id);
+    assert(type_get(int_id)->ptr_level == 0);
+    assert(type_get(ptr_id)->ptr_level == 1);
+
+    // Enough types to grow the table, stored types keep their address
+    VarType* int_type = type_get(int_id);
+    int count = type_count();
+    memset(&type, 0, sizeof(VarType));
+    for (int i = 0; i < 1000; i++) {
+        type.array_size = i + 1;
+        type_intern(type);
+    }
+    assert(type_count() == count + 1000);
+    type.array_size = 500;
+    assert(type_get(type_intern(type))->array_size == 500);
+    assert(type_get(int_id) == int_type);
+    assert(type_intern(*int_type) == int_id);
+
+    printf("[CTEST] Passed type table tests!\n");
+}
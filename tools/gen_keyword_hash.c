@@ -0,0 +1,102 @@
+/*
+Generates the perfect hash table used by the tokenizer to recognize keywords.
+The hash combines the first character, last character and length of a word,
+and the multipliers are searched for until every keyword gets its own slot.
+Usage: gen_keyword_hash > src/keyword_hash.h
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYWORD_COUNT 29
+#define HASH_SIZE 64
+#define MAX_MULT 64
+
+static char* keyword_strings[KEYWORD_COUNT] = {
+    "while", "do", "if", "else", "for", "break", "continue", "return", "switch", "case",
+    "default", "goto", "typedef", "const", "long", "short", "signed", "unsigned",
+    "extern", "static", "struct", "enum", "union", "int", "float", "double", "char",
+    "void", "sizeof",
+};
+static char* keyword_types[KEYWORD_COUNT] = {
+    "TK_KW_WHILE", "TK_KW_DO", "TK_KW_IF", "TK_KW_ELSE", "TK_KW_FOR", "TK_KW_BREAK",
+    "TK_KW_CONTINUE", "TK_KW_RETURN", "TK_KW_SWITCH", "TK_KW_CASE", "TK_KW_DEFAULT",
+    "TK_KW_GOTO", "TK_KW_TYPEDEF", "TK_KW_CONST", "TK_KW_LONG", "TK_KW_SHORT",
+    "TK_KW_SIGNED", "TK_KW_UNSIGNED", "TK_KW_EXTERN", "TK_KW_STATIC", "TK_KW_STRUCT",
+    "TK_KW_ENUM", "TK_KW_UNION", "TK_KW_INT", "TK_KW_FLOAT", "TK_KW_DOUBLE", "TK_KW_CHAR",
+    "TK_KW_VOID", "TK_OP_SIZEOF",
+};
+
+// Must match tokenize_keyword_hash in src/tokens.c
+int keyword_hash(char* str, int first_mult, int last_mult, int length_mult) {
+    int length = strlen(str);
+    return (str[0] * first_mult + str[length - 1] * last_mult + length * length_mult) &
+           (HASH_SIZE - 1);
+}
+
+// Try a set of multipliers, fills slots with keyword indices if there are no collisions
+int try_multipliers(int* slots, int first_mult, int last_mult, int length_mult) {
+    for (int i = 0; i < HASH_SIZE; i++) {
+        slots[i] = -1;
+    }
+    for (int i = 0; i < KEYWORD_COUNT; i++) {
+        int slot = keyword_hash(keyword_strings[i], first_mult, last_mult, length_mult);
+        if (slots[slot] != -1) {
+            return 0;
+        }
+        slots[slot] = i;
+    }
+    return 1;
+}
+
+void print_table(int* slots, int first_mult, int last_mult, int length_mult) {
+    int max_length = 0;
+    for (int i = 0; i < KEYWORD_COUNT; i++) {
+        if (strlen(keyword_strings[i]) > max_length) {
+            max_length = strlen(keyword_strings[i]);
+        }
+    }
+    printf("/*\n");
+    printf("Perfect hash table of the C keywords recognized by the tokenizer.\n");
+    printf("Generated by tools/gen_keyword_hash.c, regenerate with make keywords.\n");
+    printf("*/\n");
+    printf("#pragma once\n");
+    printf("#include \"tokens.h\"\n\n");
+    printf("#define KEYWORD_HASH_SIZE %d\n", HASH_SIZE);
+    printf("#define KEYWORD_HASH_FIRST_MULT %d\n", first_mult);
+    printf("#define KEYWORD_HASH_LAST_MULT %d\n", last_mult);
+    printf("#define KEYWORD_HASH_LENGTH_MULT %d\n", length_mult);
+    printf("#define KEYWORD_MAX_LENGTH %d\n\n", max_length);
+
+    printf("static char* keyword_hash_strings[KEYWORD_HASH_SIZE] = {\n");
+    for (int i = 0; i < HASH_SIZE; i++) {
+        printf("    \"%s\",\n", slots[i] == -1 ? "" : keyword_strings[slots[i]]);
+    }
+    printf("};\n\n");
+    printf("static int keyword_hash_lengths[KEYWORD_HASH_SIZE] = {\n");
+    for (int i = 0; i < HASH_SIZE; i++) {
+        printf("    %d,\n", slots[i] == -1 ? 0 : (int)strlen(keyword_strings[slots[i]]));
+    }
+    printf("};\n\n");
+    printf("static TokenType keyword_hash_types[KEYWORD_HASH_SIZE] = {\n");
+    for (int i = 0; i < HASH_SIZE; i++) {
+        printf("    %s,\n", slots[i] == -1 ? "TK_IDENT" : keyword_types[slots[i]]);
+    }
+    printf("};\n");
+}
+
+int main() {
+    int slots[HASH_SIZE];
+    for (int first_mult = 1; first_mult < MAX_MULT; first_mult++) {
+        for (int last_mult = 1; last_mult < MAX_MULT; last_mult++) {
+            for (int length_mult = 0; length_mult < MAX_MULT; length_mult++) {
+                if (try_multipliers(slots, first_mult, last_mult, length_mult)) {
+                    print_table(slots, first_mult, last_mult, length_mult);
+                    return 0;
+                }
+            }
+        }
+    }
+    fprintf(stderr, "No perfect hash found for a table of size %d\n", HASH_SIZE);
+    return 1;
+}